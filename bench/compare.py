@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+# 두 벤치마크 결과(bench_micro -j, run_e2e.py -o)를 비교한다.
+# 지표마다 좋아지는 방향이 정해져 있고, 기준보다 threshold % 넘게 나빠진 항목이 있으면 1 로 끝난다.
+# 기준에 있던 벤치마크나 지표가 현재 결과에 없어도 (이름이 바뀌었거나 중간에 죽었거나) 실패로 친다.
+import argparse
+import json
+import sys
+
+# True 면 클수록 좋다
+HIGHER_IS_BETTER = {
+    "ns_per_op": False,
+    "msgs_per_sec": True,
+    "mb_per_sec": True,
+    "p50_us": False,
+    "p99_us": False,
+}
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    return {b["name"]: b["metrics"] for b in data["benchmarks"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare two benchmark result files")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="allowed regression in percent (default: 5)")
+    parser.add_argument("--metric-threshold", action="append", default=[], metavar="METRIC=PCT",
+                        help="per-metric threshold, e.g. p99_us=20 (repeatable)")
+    parser.add_argument("--allow-missing", action="store_true",
+                        help="do not fail when a baseline benchmark or metric is missing from the current run")
+    args = parser.parse_args()
+
+    thresholds = {}
+    for item in args.metric_threshold:
+        metric, _, pct = item.partition("=")
+        thresholds[metric] = float(pct)
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+
+    regressions = 0
+    missing = 0
+    print("%-40s %-14s %14s %14s %9s" % ("benchmark", "metric", "baseline", "current", "change"))
+    for name in sorted(set(baseline) | set(current)):
+        if name not in baseline:
+            print("%-40s only in current" % name)
+            continue
+        if name not in current:
+            print("%-40s only in baseline%s" % (name, "" if args.allow_missing else "  MISSING"))
+            missing += 1
+            continue
+        for metric, base in sorted(baseline[name].items()):
+            if metric not in HIGHER_IS_BETTER:
+                continue
+            if metric not in current[name]:
+                print("%-40s %-14s %14.2f %14s%s" % (name, metric, base, "-", "" if args.allow_missing else "  MISSING"))
+                missing += 1
+                continue
+            cur = current[name][metric]
+            if base == 0:
+                continue
+            change = (cur - base) / base * 100.0
+            worse = -change if HIGHER_IS_BETTER[metric] else change
+            limit = thresholds.get(metric, args.threshold)
+            flag = ""
+            if worse > limit:
+                flag = "  REGRESSION"
+                regressions += 1
+            elif worse < -limit:
+                flag = "  improved"
+            print("%-40s %-14s %14.2f %14.2f %+8.1f%%%s" % (name, metric, base, cur, change, flag))
+
+    failed = regressions > 0
+    if regressions:
+        print("\n%d regression(s) beyond threshold" % regressions)
+    if missing and not args.allow_missing:
+        print("%s%d baseline result(s) missing from the current run (--allow-missing to permit)"
+              % ("" if regressions else "\n", missing))
+        failed = True
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
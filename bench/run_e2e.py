@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+# 루프백 end-to-end 벤치마크
+# 서버를 하위 프로세스로 띄우고, 연결 수 x 메시지 크기 조합마다 loadgen 을 돌려서
+# 결과를 bench_micro 와 같은 형식의 JSON 으로 모은다. compare.py 로 두 결과를 비교한다.
+import argparse
+import json
+import os
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+SERVER_PORT = 12345
+
+
+def wait_for_port(host, port, timeout):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        try:
+            with socket.create_connection((host, port), timeout=0.2):
+                return True
+        except OSError:
+            time.sleep(0.05)
+    return False
+
+
+def port_in_use(host, port):
+    try:
+        with socket.create_connection((host, port), timeout=0.2):
+            return True
+    except OSError:
+        return False
+
+
+def run_case(args, connections, size, json_path):
+    cmd = [args.loadgen, "-c", str(connections), "-t", str(args.threads), "-d", str(args.duration),
+           "-s", str(size), "-D", str(args.depth), "-j", json_path]
+    result = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    if result.returncode != 0:
+        sys.stderr.write(result.stdout)
+        raise RuntimeError("loadgen failed: %s" % " ".join(cmd))
+    with open(json_path) as f:
+        return json.load(f)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Loopback end-to-end benchmark")
+    parser.add_argument("--server", required=True, help="server binary")
+    parser.add_argument("--loadgen", required=True, help="loadgen binary")
+    parser.add_argument("--server-args", default="", help="extra server arguments, e.g. \"-t 2 -F\"")
+    parser.add_argument("-c", "--connections", default="1,100,1000", help="comma separated connection counts")
+    parser.add_argument("-s", "--sizes", default="64,1024,16384", help="comma separated payload sizes")
+    parser.add_argument("-d", "--duration", type=int, default=3, help="seconds per case")
+    parser.add_argument("-t", "--threads", type=int, default=1, help="loadgen threads")
+    parser.add_argument("-D", "--depth", type=int, default=1, help="messages in flight per connection")
+    parser.add_argument("-o", "--output", default="-", help="JSON output file (- for stdout)")
+    args = parser.parse_args()
+
+    if port_in_use("127.0.0.1", SERVER_PORT):
+        sys.exit("port %d is already in use; stop the running server first" % SERVER_PORT)
+
+    server = subprocess.Popen([args.server] + args.server_args.split(), stdout=subprocess.DEVNULL,
+                              stderr=subprocess.DEVNULL)
+    results = []
+    try:
+        if not wait_for_port("127.0.0.1", SERVER_PORT, 5):
+            sys.exit("server did not start listening on port %d" % SERVER_PORT)
+
+        with tempfile.TemporaryDirectory() as tmp:
+            json_path = os.path.join(tmp, "loadgen.json")
+            for connections in [int(c) for c in args.connections.split(",")]:
+                for size in [int(s) for s in args.sizes.split(",")]:
+                    name = "e2e/c%d/s%d" % (connections, size)
+                    report = run_case(args, connections, size, json_path)
+                    latency = report["latency_us"] or {}
+                    errors = sum(report["errors"].values())
+                    metrics = {
+                        "msgs_per_sec": report["msgs_per_sec"],
+                        "mb_per_sec": report["mb_per_sec"],
+                        "p50_us": latency.get("p50", 0.0),
+                        "p99_us": latency.get("p99", 0.0),
+                    }
+                    results.append({"name": name, "metrics": metrics, "errors": errors})
+                    print("%-24s %12.0f msg/s %10.2f MB/s  p50 %8.1f us  p99 %8.1f us%s" %
+                          (name, metrics["msgs_per_sec"], metrics["mb_per_sec"], metrics["p50_us"],
+                           metrics["p99_us"], "  (%d errors)" % errors if errors else ""), flush=True)
+                    if server.poll() is not None:
+                        sys.exit("server exited during %s" % name)
+    finally:
+        server.terminate()
+        try:
+            server.wait(timeout=5)
+        except subprocess.TimeoutExpired:
+            server.kill()
+
+    output = {"benchmarks": results}
+    if args.output == "-":
+        json.dump(output, sys.stdout, indent=2)
+        sys.stdout.write("\n")
+    else:
+        with open(args.output, "w") as f:
+            json.dump(output, f, indent=2)
+            f.write("\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,43 @@
+#ifndef __BUFFER_POOL_H__
+#define __BUFFER_POOL_H__
+#include <stdio.h>
+#include <stddef.h>
+
+// 링 버퍼용 미러 매핑 풀
+// 크기 등급(size class)별로 스레드 로컬 free list 를 두고, 반환된 블록을 다음 할당에 재사용한다.
+// 연결이 생기고 사라져도 hot path 에서 mmap/munmap 을 부르지 않는다.
+// 모든 등급은 2의 거듭제곱이고, 블록은 같은 메모리가 두 번 이어서 매핑된 형태다.
+#define BUFFER_POOL_CLASS_COUNT 6 // 4K, 16K, 64K, 256K, 1M, 4M
+#define BUFFER_POOL_MIN_SIZE 4096
+
+struct buffer_pool_stats {
+    size_t class_size[BUFFER_POOL_CLASS_COUNT];
+    size_t in_use[BUFFER_POOL_CLASS_COUNT];  // 연결이 사용 중인 블록 수
+    size_t cached[BUFFER_POOL_CLASS_COUNT];  // free list 에 있는 블록 수 (모든 스레드 합계)
+    size_t large_in_use;                     // 최대 등급보다 커서 풀을 거치지 않는 블록 수
+    size_t reserved_bytes;                   // 매핑된 전체 바이트 (사용 중 + 캐시)
+    size_t budget_bytes;                     // 0 이면 무제한
+};
+
+// 전체 메모리 예산 설정. 0 이면 무제한.
+void buffer_pool_set_budget(size_t budget_bytes);
+
+// size 를 담을 수 있는 가장 작은 블록 크기
+size_t buffer_pool_block_size(size_t size);
+
+// buffer_pool_block_size(size) 크기의 미러 매핑 블록을 할당. 예산을 넘거나 실패하면 NULL.
+char *buffer_pool_alloc(size_t size);
+
+// buffer_pool_alloc() 에서 받은 블록을 반환. size 는 블록 크기 그대로 넘긴다.
+void buffer_pool_free(char *block, size_t size);
+
+// 예산 안에서 size 바이트를 더 매핑할 여유가 있는지
+int buffer_pool_has_room(size_t size);
+
+// 현재 스레드의 free list 를 모두 해제. 워커 스레드가 끝날 때 부른다.
+void buffer_pool_thread_release(void);
+
+void buffer_pool_get_stats(struct buffer_pool_stats *stats);
+void buffer_pool_report(FILE *out);
+
+#endif // __BUFFER_POOL_H__
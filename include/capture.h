@@ -0,0 +1,71 @@
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+#include <stdint.h>
+#include <stddef.h>
+
+// 트래픽 캡처 (옵션)
+// 연결이 열리고, 데이터를 받고, 닫힌 시각과 크기(원하면 받은 바이트까지)를 기록해서 replay 로 같은 모양의
+// 트래픽을 다시 만든다. 이벤트 루프는 워커별 lock-free 바이트 링에 레코드를 복사만 하고, write() 는
+// 백그라운드 스레드가 모아서 한다 (log.c 와 같은 구조). 링이 차면 루프를 막지 않고 payload 를 빼고
+// 크기만 남기거나, 그것도 안 들어가면 레코드를 버린다.
+//
+// 파일은 struct capture_file_header 뒤에 레코드가 이어지는 append-only 형식이다 (host byte order).
+// 레코드는 struct capture_record 와 stored 바이트의 payload 이고, 다음 레코드는 8바이트 경계에서 시작하므로
+// 파일을 mmap 해서 그대로 훑을 수 있다. 한 워커의 레코드는 시간 순서지만 워커끼리는 섞여 있다.
+#define CAPTURE_FILE_MAGIC "SRVCAPTR"
+#define CAPTURE_FILE_VERSION 1
+#define CAPTURE_RING_SIZE (8 * 1024 * 1024) // 워커별 링 크기, 2의 거듭제곱
+
+enum capture_event {
+    CAPTURE_OPEN,  // 연결 수락. flags 에 CAPTURE_FLAG_UNIX
+    CAPTURE_DATA,  // recv 한 번. len 은 받은 바이트
+    CAPTURE_CLOSE,
+};
+
+#define CAPTURE_FLAG_UNIX 0x01 // AF_UNIX 리스너로 들어온 연결
+
+struct capture_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t start_realtime_ns; // time_ns 0 에 해당하는 벽시계 시각
+};
+
+struct capture_record {
+    uint64_t time_ns; // 캡처 시작 이후 (CLOCK_MONOTONIC)
+    uint32_t conn;    // 워커 안에서 연결마다 붙인 번호. (worker, conn) 으로 연결을 구분한다
+    uint16_t worker;
+    uint8_t type;     // enum capture_event
+    uint8_t flags;
+    uint32_t len;     // 받은 바이트
+    uint32_t stored;  // 뒤따르는 payload 바이트. 크기만 기록했거나 링이 차서 뺐으면 len 보다 작다
+};
+
+// 다음 레코드의 위치
+static inline size_t capture_record_span(const struct capture_record *rec) {
+    return (sizeof(struct capture_record) + rec->stored + 7) & ~(size_t) 7;
+}
+
+// 워커 하나의 링. 생산자는 워커, 소비자는 캡처 스레드다.
+struct capture_ring;
+
+// 파일을 만들고 헤더를 쓴 뒤 캡처 스레드를 시작한다. payload 가 0 이 아니면 받은 바이트도 기록한다.
+int capture_start(const char *path, int payload);
+
+// 남은 레코드를 모두 쓰고 돌아온다
+void capture_stop(void);
+
+// 호출한 워커용 링을 만들어 등록한다. 프로세스가 끝날 때까지 해제하지 않는다. 실패하면 NULL.
+struct capture_ring *capture_register(int worker);
+
+enum capture_result {
+    CAPTURE_DROPPED,   // 링이 가득 차서 버렸다
+    CAPTURE_TRUNCATED, // payload 를 빼고 크기만 남겼다
+    CAPTURE_RECORDED,
+};
+
+// 레코드 하나를 링에 넣는다. data 가 NULL 이거나 payload 기록을 끈 경우 크기만 남긴다.
+enum capture_result capture_event(struct capture_ring *ring, enum capture_event type, uint32_t conn, uint8_t flags,
+                                  const char *data, size_t len);
+
+#endif // __CAPTURE_H__
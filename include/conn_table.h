@@ -0,0 +1,52 @@
+#ifndef __CONN_TABLE_H__
+#define __CONN_TABLE_H__
+#include <stddef.h>
+#include <stdint.h>
+
+// 연결 테이블 (slab)
+// 고정 크기 슬롯을 CONN_TABLE_CHUNK 개씩 묶은 청크 단위로 늘린다. 청크는 옮기지 않으므로
+// 슬롯 포인터는 해제될 때까지 그대로 유효하다. 해제된 슬롯은 free list 로 재사용한다.
+// 연결은 fd 번호가 아니라 핸들(세대 << 32 | 인덱스)로 식별한다. 슬롯을 해제할 때마다
+// 세대가 바뀌므로 이미 닫힌 연결의 핸들로 조회하면 NULL 이 나온다.
+#define CONN_TABLE_CHUNK 4096 // 2의 거듭제곱이어야 함
+
+// 유효한 핸들은 세대가 홀수이므로 0 이 될 수 없다
+#define CONN_HANDLE_NONE 0ULL
+
+struct conn_table_chunk;
+
+struct conn_table {
+    struct conn_table_chunk **chunks;
+    size_t chunk_count;
+    size_t chunk_capacity;
+    size_t slot_size;   // 8바이트 정렬로 올린 원소 크기
+    size_t max_entries; // 0 이면 무제한 (인덱스는 32비트)
+    size_t count;       // 사용 중인 슬롯 수
+    uint32_t free_head; // 해제된 슬롯 목록. 없으면 UINT32_MAX
+    uint32_t next_unused; // 한 번도 쓰지 않은 다음 인덱스
+};
+
+void conn_table_init(struct conn_table *table, size_t elem_size, size_t max_entries);
+void conn_table_destroy(struct conn_table *table);
+
+// 0 으로 채운 슬롯 하나를 잡고 핸들을 *handle 에 넣는다. 한도에 닿았거나 메모리가 없으면 NULL.
+void *conn_table_alloc(struct conn_table *table, uint64_t *handle);
+
+// 핸들이 가리키는 슬롯. 이미 해제된(세대가 다른) 핸들이면 NULL.
+void *conn_table_get(const struct conn_table *table, uint64_t handle);
+
+// 세대 확인 없이 인덱스로 바로 찾는다. 슬롯이 살아 있음을 호출자가 보장할 때만 쓴다.
+void *conn_table_at(const struct conn_table *table, uint32_t index);
+
+// 슬롯을 해제하고 세대를 올린다. 이전 핸들은 더 이상 조회되지 않는다.
+void conn_table_free(struct conn_table *table, uint64_t handle);
+
+static inline uint32_t conn_handle_index(uint64_t handle) {
+    return (uint32_t) handle;
+}
+
+static inline size_t conn_table_count(const struct conn_table *table) {
+    return table->count;
+}
+
+#endif // __CONN_TABLE_H__
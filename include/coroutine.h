@@ -0,0 +1,105 @@
+#ifndef __COROUTINE_H__
+#define __COROUTINE_H__
+#include <stddef.h>
+#include <stdint.h>
+
+struct ring_buffer;
+struct stats_shard;
+
+// 스택 없는 코루틴 (switch 기반, protothread 방식)
+// 핸들러 함수는 CO_BEGIN 과 CO_END 사이에 순서대로 쓰고, 읽기/쓰기가 EAGAIN 에 걸리거나 잠들 때는
+// 재개할 위치(__LINE__)만 저장하고 이벤트 루프로 돌아간다. 다시 부르면 switch 가 그 줄로 바로 뛴다.
+// 전환 비용은 함수 호출과 간접 분기 하나이고, 코루틴마다 필요한 메모리는 struct co 뿐이다.
+//
+// 제약: 스택이 없으므로 yield 를 넘어 살아야 하는 값은 지역 변수가 아니라 핸들러 상태 구조체에 둔다.
+// CO_ 매크로가 case 라벨을 쓰므로 CO_BEGIN 안에서 switch 문을 쓸 수 없고, 한 줄에 하나만 쓴다.
+enum co_status {
+    CO_DONE,       // 핸들러가 끝났다
+    CO_ERROR,      // 상대가 닫았거나 오류. 연결을 닫는다
+    CO_WAIT_READ,  // 읽을 데이터를 기다린다 (EAGAIN)
+    CO_WAIT_WRITE, // 송신 버퍼에 자리가 나기를 기다린다 (EAGAIN)
+    CO_WAIT_TIMER, // wake_ms 까지 잠든다
+    CO_YIELD,      // 다른 연결에 양보한다. 다음 바퀴에 바로 이어서 실행한다
+};
+
+struct co {
+    int line;         // 재개할 위치. 0 이면 처음부터
+    uint32_t done;    // 진행 중인 co_read_exact/co_write_all 이 처리한 바이트
+    uint64_t wake_ms; // co_sleep 이 끝나는 시각
+};
+
+// 코루틴이 읽고 쓰는 논블로킹 스트림. 재개할 때마다 호출자가 만들어 넘긴다.
+// 남은 양이 작은 읽기는 readahead 에 크게 받아 두고 나눠 주므로 헤더 같은 작은 읽기가 시스템 콜을 늘리지 않는다.
+struct co_stream {
+    int fd;
+    struct ring_buffer *readahead; // 처음 쓸 때 블록을 잡고, 다 꺼내면 풀에 돌려준다
+    size_t read_size;              // readahead 에 한 번에 받는 크기. 이보다 많이 남은 읽기는 목적지로 바로 받는다
+    struct stats_shard *stats;
+};
+
+static inline void co_init(struct co *co) {
+    co->line = 0;
+    co->done = 0;
+    co->wake_ms = 0;
+}
+
+// len 바이트를 채울 때까지 읽는다. 다 읽었으면 1, EAGAIN 이면 0 (*done 에 진행을 남긴다), 끝/오류면 -1.
+int co_stream_read(struct co_stream *stream, char *buf, size_t len, uint32_t *done);
+
+// len 바이트를 모두 보낼 때까지 쓴다. 반환값은 co_stream_read() 와 같다.
+int co_stream_write(struct co_stream *stream, const char *buf, size_t len, uint32_t *done);
+
+#define CO_BEGIN(co) \
+    switch ((co)->line) { \
+        case 0:
+
+#define CO_END(co) \
+    } \
+    (co)->line = 0; \
+    return CO_DONE
+
+// 재개 위치를 남기고 status 를 돌려준다. 다시 부르면 바로 다음 문장부터 이어진다.
+#define CO_YIELD_STATUS(co, status) \
+    do { \
+        (co)->line = __LINE__; \
+        return (status); \
+        case __LINE__:; \
+    } while (0)
+
+// step 이 1 을 돌려줄 때까지 wait 로 멈췄다가 재개될 때마다 다시 시도한다. step 은 재개할 때마다 다시 평가된다.
+// 처음 실행할 때는 재개 지점의 case 라벨로 그대로 흘러 들어가므로 fallthrough 로 표시한다 (-Wimplicit-fallthrough).
+#define CO_AWAIT_STEP_(co, step, wait) \
+    do { \
+        (co)->done = 0; \
+        (co)->line = __LINE__; \
+        __attribute__((fallthrough)); \
+        case __LINE__: { \
+            int co_rc_ = (step); \
+            if (co_rc_ == 0) { \
+                return (wait); \
+            } \
+            if (co_rc_ < 0) { \
+                return CO_ERROR; \
+            } \
+        } \
+    } while (0)
+
+#define co_read_exact(co, stream, buf, len) \
+    CO_AWAIT_STEP_(co, co_stream_read((stream), (char *) (buf), (len), &(co)->done), CO_WAIT_READ)
+
+#define co_write_all(co, stream, buf, len) \
+    CO_AWAIT_STEP_(co, co_stream_write((stream), (const char *) (buf), (len), &(co)->done), CO_WAIT_WRITE)
+
+// now_ms 는 재개할 때마다 다시 평가되는 현재 시각 식이다 (이벤트 루프의 시계). 다른 이벤트로 일찍 재개돼도 다시 잠든다.
+#define co_sleep(co, now_ms, ms) \
+    do { \
+        (co)->wake_ms = (now_ms) + (ms); \
+        (co)->line = __LINE__; \
+        __attribute__((fallthrough)); \
+        case __LINE__: \
+        if ((now_ms) < (co)->wake_ms) { \
+            return CO_WAIT_TIMER; \
+        } \
+    } while (0)
+
+#endif // __COROUTINE_H__
@@ -8,9 +8,15 @@ int handle_setsockopt_error();
 int handle_bind_error();
 int handle_listen_error();
 int handle_poll_error();
+int handle_epoll_error();
+int handle_io_uring_error();
 int handle_accept_error();
 int handle_receive_error();
 int handle_send_error();
+int handle_splice_error();
 int handle_connect_error();
+// UDP 용. 상대 하나 때문에 생긴 오류(ICMP 거부, 경로 없음 등)는 1 을 반환해서 소켓을 계속 쓴다.
+int handle_recvmmsg_error();
+int handle_sendmmsg_error();
 
 #endif // __ERR_HANDLE_H__
\ No newline at end of file
@@ -0,0 +1,62 @@
+#ifndef __FILE_CACHE_H__
+#define __FILE_CACHE_H__
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+// 정적 파일 캐시
+// 자주 받아 가는 파일을 열린 fd 와 읽기 전용 MAP_SHARED 매핑으로 들고 있는다. 매핑은 페이지 캐시를 그대로
+// 가리키므로 같은 파일을 몇 천 연결이 동시에 받아도 디스크를 다시 읽거나 메모리를 따로 잡지 않는다.
+// 보낼 때는 매핑을 직접 읽지 않는다: 소켓으로는 fd 를 sendfile() 로, 공유 메모리 링으로는 pread() 로 보낸다.
+// 보내는 중에 파일이 잘리면 매핑을 읽는 순간 SIGBUS 로 서버 전체가 죽지만, 이 둘은 짧게 끝나므로 그 연결만 닫으면 된다.
+// 캐시는 매핑 크기의 합을 limit 안으로 유지하며 가장 오래 안 쓴 것부터 내보낸다. 보내는 중인 연결은
+// 참조를 들고 있으므로 캐시에서 빠진 항목도 마지막 참조가 놓일 때까지 살아 있다.
+// 워커마다 하나씩 쓰므로 lock 이나 atomic 참조 카운트가 없다.
+//
+// 파일은 제자리에서 고치지 말고 rename() 으로 바꿔야 한다. 보내는 중에 잘리면 보내던 연결은 끊긴다.
+#define FILE_CACHE_DEFAULT_SIZE (64 * 1024 * 1024)
+#define FILE_CACHE_MAX_NAME 255
+#define FILE_CACHE_REVALIDATE_MS 1000 // 캐시에 든 파일이 바뀌었는지 이 간격으로만 stat 한다
+
+struct file_entry {
+    struct file_entry *hash_next;
+    struct file_entry *lru_prev; // 더 최근에 쓴 쪽
+    struct file_entry *lru_next;
+    uint32_t refs;   // 보내는 중인 연결 수 + 캐시에 들어 있으면 1
+    int cached;
+    int fd;          // sendfile()/pread() 원본
+    const char *data; // 파일 전체의 읽기 전용 매핑. 페이지를 붙잡아 두는 용도로만 쓴다. 빈 파일이면 NULL
+    size_t size;
+    ino_t ino;       // 바뀌었는지 확인하는 데 쓴다
+    struct timespec mtime;
+    uint64_t checked_ms;
+    uint8_t name_len;
+    char name[FILE_CACHE_MAX_NAME];
+};
+
+struct file_cache {
+    int root_fd; // 이 디렉터리 아래 파일만 연다. 여러 캐시가 같이 쓸 수 있고 닫지 않는다
+    struct file_entry **buckets;
+    size_t bucket_count; // 2의 거듭제곱
+    struct file_entry *lru_head; // 가장 최근에 쓴 항목
+    struct file_entry *lru_tail;
+    size_t bytes; // 캐시에 든 항목의 매핑 크기 합
+    size_t limit;
+    size_t count;
+};
+
+int file_cache_init(struct file_cache *cache, int root_fd, size_t limit);
+
+// 캐시에 든 항목의 참조를 놓는다. 보내는 중인 항목은 마지막 참조가 놓일 때 해제된다.
+void file_cache_destroy(struct file_cache *cache);
+
+// root 아래의 name 을 연다. 캐시에 있고 바뀌지 않았으면 그것을, 아니면 새로 열어 매핑하고 limit 안에 들면
+// 캐시에 넣는다. 참조를 하나 늘려서 돌려주고, 캐시에서 찾았으면 *hit 에 1 을 넣는다.
+// 이름이 root 밖을 가리키거나, 없거나, 정규 파일이 아니면 NULL.
+struct file_entry *file_cache_open(struct file_cache *cache, const char *name, size_t name_len, uint64_t now_ms,
+                                   int *hit);
+
+void file_entry_unref(struct file_entry *entry);
+
+#endif // __FILE_CACHE_H__
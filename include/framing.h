@@ -0,0 +1,68 @@
+#ifndef __FRAMING_H__
+#define __FRAMING_H__
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// 길이 접두 프레임
+// [길이 4바이트, big endian][타입 1바이트][payload 길이 바이트]
+// 길이는 payload 만 센다. 프레임은 수신 버퍼 안에서 그대로 파싱하고, 핸들러에는
+// 버퍼를 가리키는 view 를 넘긴다 (복사 없음). view 는 핸들러가 돌아오면 더 이상 유효하지 않다.
+#define FRAME_HEADER_SIZE 5
+#define FRAME_TYPE_COUNT 256
+#define FRAME_DEFAULT_MAX_PAYLOAD (1024 * 1024)
+
+// 서버가 기본으로 등록하는 타입
+#define FRAME_TYPE_ECHO 1 // payload 를 같은 타입으로 돌려준다
+#define FRAME_TYPE_PING 2 // 빈 PONG 으로 응답한다
+#define FRAME_TYPE_PONG 3
+#define FRAME_TYPE_SUBSCRIBE 4   // payload 는 토픽 이름
+#define FRAME_TYPE_UNSUBSCRIBE 5 // payload 는 토픽 이름
+#define FRAME_TYPE_PUBLISH 6     // payload 는 [토픽 길이 1바이트][토픽][메시지]
+#define FRAME_TYPE_MESSAGE 7     // 구독자에게 가는 프레임. payload 는 PUBLISH 와 같다
+#define FRAME_TYPE_SHM_ATTACH 8  // AF_UNIX 에서 memfd 와 eventfd 를 함께 보내 공유 메모리 링으로 옮긴다. 빈 SHM_ATTACH 가 수락 응답
+#define FRAME_TYPE_GET 9         // payload 는 파일 이름 (-R 디렉터리 기준 상대 경로)
+#define FRAME_TYPE_FILE 10       // GET 응답. payload 가 파일 내용이다
+#define FRAME_TYPE_NOT_FOUND 11  // GET 한 파일을 보낼 수 없다. payload 는 요청한 이름
+
+struct frame {
+    uint8_t type;
+    uint32_t len;
+    const char *payload;
+};
+
+// 1 이면 계속, 0 이면 연결을 닫는다
+typedef int (*frame_handler)(void *ctx, const struct frame *frame);
+
+struct frame_dispatcher {
+    frame_handler handlers[FRAME_TYPE_COUNT];
+    size_t max_payload; // 이보다 긴 프레임은 프로토콜 오류
+};
+
+void frame_dispatcher_init(struct frame_dispatcher *dispatcher, size_t max_payload);
+
+// 타입별 핸들러 등록. 등록되지 않은 타입이 오면 프로토콜 오류로 본다.
+void frame_register(struct frame_dispatcher *dispatcher, uint8_t type, frame_handler handler);
+
+// data 안의 완성된 프레임을 모두 순서대로 핸들러에 넘긴다.
+// 처리한 바이트 수를 반환하고, 끝에 남은 미완성 프레임을 마저 받으려면 몇 바이트가 더 필요한지를
+// *need 에 넣는다 (남은 게 없으면 0). 프로토콜 오류나 핸들러가 0 을 반환하면 -1.
+ssize_t frame_dispatch(const struct frame_dispatcher *dispatcher, void *ctx, const char *data, size_t len,
+                       size_t *need);
+
+// out 에 FRAME_HEADER_SIZE 바이트 헤더를 쓴다
+static inline void frame_encode_header(char *out, uint8_t type, uint32_t len) {
+    out[0] = (char) (len >> 24);
+    out[1] = (char) (len >> 16);
+    out[2] = (char) (len >> 8);
+    out[3] = (char) len;
+    out[4] = (char) type;
+}
+
+// 헤더의 payload 길이. 타입은 p[4] 다.
+static inline uint32_t frame_decode_length(const char *p) {
+    const unsigned char *u = (const unsigned char *) p;
+    return ((uint32_t) u[0] << 24) | ((uint32_t) u[1] << 16) | ((uint32_t) u[2] << 8) | (uint32_t) u[3];
+}
+
+#endif // __FRAMING_H__
@@ -0,0 +1,32 @@
+#ifndef __HISTOGRAM_H__
+#define __HISTOGRAM_H__
+#include <stdio.h>
+#include <stdint.h>
+
+// HDR 스타일 로그-선형 히스토그램
+// 2의 거듭제곱 구간마다 HISTOGRAM_SUB_COUNT / 2 개의 균등 버킷을 둬서
+// 0 부터 UINT64_MAX 까지 상대 오차 1% 미만으로 기록한다. 기록은 O(1) 이고 할당이 없다.
+#define HISTOGRAM_SUB_BITS 7
+#define HISTOGRAM_SUB_COUNT (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BITS + 1) * (HISTOGRAM_SUB_COUNT / 2) + HISTOGRAM_SUB_COUNT / 2)
+
+struct histogram {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+};
+
+void histogram_init(struct histogram *h);
+void histogram_record(struct histogram *h, uint64_t value);
+void histogram_merge(struct histogram *dst, const struct histogram *src);
+
+// percentile 은 0 ~ 100. 해당 버킷의 상한값을 반환한다 (max 를 넘지 않음).
+uint64_t histogram_percentile(const struct histogram *h, double percentile);
+double histogram_mean(const struct histogram *h);
+
+// "label: n=... min=... p50=... p99=... p99.9=... max=..." 한 줄. 값은 나노초를 마이크로초로 출력한다.
+void histogram_print_ns(FILE *out, const char *label, const struct histogram *h);
+
+#endif // __HISTOGRAM_H__
@@ -0,0 +1,105 @@
+#ifndef __LOG_H__
+#define __LOG_H__
+#include <errno.h>
+
+// 비동기 레벨 로그
+// 이벤트 루프는 고정 크기 바이너리 레코드(포맷 문자열 포인터 + 정수 인자)를 스레드별
+// lock-free 링에 넣기만 하고, 문자열 포맷과 write() 는 백그라운드 스레드가 모아서 한다.
+// log_start() 를 부르지 않은 프로그램(client, loadgen)에서는 그 자리에서 바로 출력한다.
+//
+// 제약: 포맷 문자열은 정적 문자열이어야 하고, 인자는 최대 LOG_MAX_ARGS 개의 정수로
+// long long 으로 변환되어 저장된다. 포맷에는 %lld / %llu / %llx 만 쓴다.
+//
+// 레벨은 아래 #if 에서 LOG_COMPILE_LEVEL 과 비교하므로 enum 이 아니라 매크로여야 한다
+// (전처리기는 enum 이름을 0 으로 본다).
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_WARN 3
+#define LOG_LEVEL_ERROR 4
+#define LOG_LEVEL_OFF 5
+
+// 이 레벨보다 낮은 로그는 컴파일되지 않는다. Debug 빌드는 CMake 에서 TRACE 로 낮춘다.
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_MAX_ARGS 4
+
+extern int log_runtime_level;
+
+void log_set_level(int level);
+// "trace", "debug", "info", "warn", "error", "off". 모르는 이름이면 -1.
+int log_parse_level(const char *name);
+
+// 백그라운드 출력 스레드 시작/종료. log_stop() 은 남은 레코드를 모두 쓰고 돌아온다.
+int log_start(void);
+void log_stop(void);
+
+// 매크로를 통해서만 부른다. err 가 0 이 아니면 strerror(err) 를 덧붙인다.
+void log_write(int level, int err, const char *fmt, int nargs, ...);
+
+#define LOG_CAST_(x) ((long long) (x))
+#define LOG_NARGS_(_0, _1, _2, _3, _4, N, ...) N
+#define LOG_NARGS(...) LOG_NARGS_(_0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+#define LOG_MAP_0()
+#define LOG_MAP_1(a) , LOG_CAST_(a)
+#define LOG_MAP_2(a, b) , LOG_CAST_(a), LOG_CAST_(b)
+#define LOG_MAP_3(a, b, c) , LOG_CAST_(a), LOG_CAST_(b), LOG_CAST_(c)
+#define LOG_MAP_4(a, b, c, d) , LOG_CAST_(a), LOG_CAST_(b), LOG_CAST_(c), LOG_CAST_(d)
+#define LOG_CAT_(a, b) a##b
+#define LOG_CAT(a, b) LOG_CAT_(a, b)
+#define LOG_MAP(...) LOG_CAT(LOG_MAP_, LOG_NARGS(__VA_ARGS__))(__VA_ARGS__)
+
+#define LOG_AT(level, err, fmt, ...) \
+    do { \
+        if ((level) >= log_runtime_level) { \
+            log_write((level), (err), (fmt), LOG_NARGS(__VA_ARGS__) LOG_MAP(__VA_ARGS__)); \
+        } \
+    } while (0)
+
+// 컴파일에서 뺀 레벨. if (0) 안에 두어 인자를 평가하지도, 문자열을 남기지도 않지만
+// 로그에만 쓰는 변수가 "unused" 경고를 내지 않고 포맷/인자 개수도 계속 검사된다.
+#define LOG_DISABLED_(level, fmt, ...) \
+    do { \
+        if (0) { \
+            log_write((level), 0, (fmt), LOG_NARGS(__VA_ARGS__) LOG_MAP(__VA_ARGS__)); \
+        } \
+    } while (0)
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_TRACE
+#define LOG_TRACE(fmt, ...) LOG_AT(LOG_LEVEL_TRACE, 0, fmt, ##__VA_ARGS__)
+#else
+#define LOG_TRACE(fmt, ...) LOG_DISABLED_(LOG_LEVEL_TRACE, fmt, ##__VA_ARGS__)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, 0, fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(fmt, ...) LOG_DISABLED_(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(fmt, ...) LOG_AT(LOG_LEVEL_INFO, 0, fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(fmt, ...) LOG_DISABLED_(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(fmt, ...) LOG_AT(LOG_LEVEL_WARN, 0, fmt, ##__VA_ARGS__)
+#define LOG_SYSWARN(fmt, ...) LOG_AT(LOG_LEVEL_WARN, errno, fmt, ##__VA_ARGS__)
+#else
+#define LOG_WARN(fmt, ...) LOG_DISABLED_(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define LOG_SYSWARN(fmt, ...) LOG_DISABLED_(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, 0, fmt, ##__VA_ARGS__)
+// perror() 대신 쓴다: 메시지 뒤에 ": strerror(errno)" 가 붙는다
+#define LOG_SYSERR(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, errno, fmt, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...) LOG_DISABLED_(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#define LOG_SYSERR(fmt, ...) LOG_DISABLED_(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#endif
+
+#endif // __LOG_H__
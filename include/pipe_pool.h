@@ -0,0 +1,29 @@
+#ifndef __PIPE_POOL_H__
+#define __PIPE_POOL_H__
+#include <stddef.h>
+
+// splice() 에코 모드에서 연결마다 빌려 쓰는 파이프 쌍
+// 파이프가 비면 풀에 돌려주고 다른 연결이 재사용한다. 워커 스레드마다 하나씩 둔다.
+struct pipe_pair {
+    int read_fd;
+    int write_fd;
+};
+
+struct pipe_pool {
+    struct pipe_pair *pairs;
+    size_t count;
+    size_t max_cached;
+    int pipe_size;  // F_SETPIPE_SZ 로 요청할 크기 (0 이면 커널 기본값)
+    int warned;
+};
+
+void pipe_pool_init(struct pipe_pool *pool, size_t max_cached, int pipe_size);
+void pipe_pool_destroy(struct pipe_pool *pool);
+
+// 파이프 쌍을 하나 빌린다. 실패하면 0 을 반환한다.
+int pipe_pool_get(struct pipe_pool *pool, struct pipe_pair *pair);
+
+// 빈 파이프는 풀에 돌려주고, 데이터가 남아 있거나 풀이 가득 차면 닫는다.
+void pipe_pool_put(struct pipe_pool *pool, struct pipe_pair *pair, int empty);
+
+#endif // __PIPE_POOL_H__
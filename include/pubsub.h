@@ -0,0 +1,118 @@
+#ifndef __PUBSUB_H__
+#define __PUBSUB_H__
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+// 브로드캐스트용 공유 메시지와 구독자별 송신 대기열, 토픽 테이블
+// 발행된 메시지는 송신할 프레임 그대로 한 번만 만들어 두고, 구독자 대기열은 참조만 든다.
+// 마지막 구독자가 다 보내면 해제된다. 워커 스레드 하나 안에서만 쓰므로 참조 카운트는 atomic 이 아니다.
+#define PUBSUB_MAX_TOPIC 255
+
+struct pubsub_msg {
+    uint32_t refs;
+    uint32_t len; // data 의 바이트 수 (프레임 헤더 포함)
+    char data[];
+};
+
+// 헤더를 붙인 프레임 하나를 담은 메시지를 만든다. refs 는 1 로 시작한다. 실패하면 NULL.
+struct pubsub_msg *pubsub_msg_create(uint8_t type, const char *payload, uint32_t len);
+
+static inline void pubsub_msg_ref(struct pubsub_msg *msg) {
+    msg->refs++;
+}
+
+void pubsub_msg_unref(struct pubsub_msg *msg);
+
+// 메시지 참조의 FIFO. 맨 앞 메시지는 offset 바이트까지 이미 보낸 상태일 수 있다.
+struct msg_queue {
+    struct pubsub_msg **msgs;
+    size_t capacity; // 2의 거듭제곱
+    size_t head;
+    size_t tail;
+    size_t offset;
+    size_t bytes; // 아직 보내지 않은 바이트
+};
+
+void msg_queue_init(struct msg_queue *queue);
+void msg_queue_free(struct msg_queue *queue);
+
+static inline size_t msg_queue_count(const struct msg_queue *queue) {
+    return queue->tail - queue->head;
+}
+
+// 참조를 하나 늘려서 넣는다. 메모리가 없으면 0.
+int msg_queue_push(struct msg_queue *queue, struct pubsub_msg *msg);
+
+// 앞에서부터 최대 max_iov 개의 iovec 을 채운다. 채운 개수를 반환한다.
+int msg_queue_fill_iov(const struct msg_queue *queue, struct iovec *iov, int max_iov);
+
+// 보낸 바이트만큼 앞에서 제거한다
+void msg_queue_consume(struct msg_queue *queue, size_t bytes);
+
+// 보내기 시작한 맨 앞 메시지는 두고, 그 뒤의 오래된 메시지부터 bytes 가 limit 이하가 될 때까지 버린다.
+// 버린 메시지 수를 반환한다.
+size_t msg_queue_drop_oldest(struct msg_queue *queue, size_t limit);
+
+struct topic;
+
+// 구독자 하나가 구독 중인 토픽들. 항목마다 토픽의 구독자 배열 안 자기 위치를 기억하고, 토픽 쪽 항목도
+// 이 목록 안의 위치를 기억한다. 그래서 구독 해제는 양쪽 모두 마지막 항목과 바꾸기만 하면 된다 (O(1)).
+struct subscription {
+    struct topic *topic;
+    size_t index; // topic->members 안의 위치
+};
+
+struct subscription_list {
+    struct subscription *items;
+    size_t count;
+    size_t capacity;
+};
+
+struct topic_member {
+    void *subscriber;
+    struct subscription_list *list; // 구독자의 목록. 구독자와 함께 움직이지 않는 주소여야 한다
+    size_t slot;                    // list->items 안의 위치
+};
+
+struct topic {
+    struct topic *next;
+    struct topic_member *members;
+    size_t count;
+    size_t capacity;
+    uint8_t name_len;
+    char name[PUBSUB_MAX_TOPIC];
+};
+
+struct topic_table {
+    struct topic **buckets;
+    size_t bucket_count; // 2의 거듭제곱
+    size_t topic_count;
+};
+
+int topic_table_init(struct topic_table *table);
+void topic_table_destroy(struct topic_table *table);
+
+// 토픽을 찾는다. create 가 0 이 아니면 없을 때 만든다. 없거나 만들지 못하면 NULL.
+struct topic *topic_table_find(struct topic_table *table, const char *name, size_t name_len, int create);
+
+static inline void subscription_list_init(struct subscription_list *list) {
+    list->items = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+// 목록에서 topic 의 위치. 구독하지 않았으면 list->count. 구독자 자신의 토픽 수만큼만 훑는다.
+size_t subscription_find(const struct subscription_list *list, const struct topic *topic);
+
+// 구독을 추가한다. 이미 구독 중이면 아무것도 하지 않는다.
+// 메모리가 없으면 0 이고, 그때 topic 이 비어 있으면 테이블에서 지운다.
+int topic_subscribe(struct topic_table *table, struct topic *topic, void *subscriber, struct subscription_list *list);
+
+// list->items[slot] 의 구독을 해제한다. 구독자가 없어진 토픽은 테이블에서 지운다.
+void topic_unsubscribe(struct topic_table *table, struct subscription_list *list, size_t slot);
+
+// 모든 구독을 해제하고 목록을 비운다
+void subscription_list_clear(struct topic_table *table, struct subscription_list *list);
+
+#endif // __PUBSUB_H__
@@ -0,0 +1,58 @@
+#ifndef __RING_BUFFER_H__
+#define __RING_BUFFER_H__
+#include <stddef.h>
+#include "buffer_pool.h"
+
+// 2의 거듭제곱 크기의 링 버퍼
+// 같은 memfd 를 연속된 두 가상 주소 영역에 매핑(mirrored mapping)해서
+// data[i] 와 data[i + capacity] 가 같은 바이트를 가리킨다.
+// 따라서 읽기/쓰기 영역은 경계를 넘어가도 항상 연속된 포인터 하나로 다룰 수 있다.
+// 메모리는 buffer_pool 의 크기 등급 블록에서 가져온다.
+#define RING_BUFFER_MIN_CAPACITY BUFFER_POOL_MIN_SIZE
+
+struct ring_buffer {
+    char *data;
+    size_t capacity; // 0 이면 아직 메모리를 잡지 않은 상태
+    size_t head;     // 읽기 위치 (단조 증가, capacity 로 나눈 나머지가 실제 위치)
+    size_t tail;     // 쓰기 위치 (단조 증가)
+};
+
+void ring_buffer_init(struct ring_buffer *rb);
+void ring_buffer_free(struct ring_buffer *rb);
+
+static inline size_t ring_buffer_length(const struct ring_buffer *rb) {
+    return rb->tail - rb->head;
+}
+
+static inline size_t ring_buffer_space(const struct ring_buffer *rb) {
+    return rb->capacity - (rb->tail - rb->head);
+}
+
+// 읽을 데이터의 시작 위치. ring_buffer_length() 바이트가 연속되어 있다.
+static inline char *ring_buffer_read_ptr(const struct ring_buffer *rb) {
+    return rb->data + (rb->head & (rb->capacity - 1));
+}
+
+// 쓸 수 있는 빈 공간의 시작 위치. ring_buffer_space() 바이트가 연속되어 있다.
+static inline char *ring_buffer_write_ptr(const struct ring_buffer *rb) {
+    return rb->data + (rb->tail & (rb->capacity - 1));
+}
+
+static inline void ring_buffer_consume(struct ring_buffer *rb, size_t len) {
+    rb->head += len;
+}
+
+static inline void ring_buffer_commit(struct ring_buffer *rb, size_t len) {
+    rb->tail += len;
+}
+
+// 빈 공간이 최소 len 바이트가 되도록 필요하면 다음 크기 등급으로 키운다. 실패하면 0 을 반환한다.
+int ring_buffer_reserve(struct ring_buffer *rb, size_t len);
+
+// 데이터를 버퍼 끝에 복사한다. 실패하면 0 을 반환한다.
+int ring_buffer_append(struct ring_buffer *rb, const char *data, size_t len);
+
+// 버퍼가 비어 있고 capacity 가 max_idle_capacity 보다 크면 블록을 풀에 반환한다.
+void ring_buffer_shrink(struct ring_buffer *rb, size_t max_idle_capacity);
+
+#endif // __RING_BUFFER_H__
@@ -0,0 +1,98 @@
+#ifndef __SHM_RING_H__
+#define __SHM_RING_H__
+#include <stddef.h>
+#include <stdint.h>
+
+// 같은 호스트의 클라이언트용 공유 메모리 전송
+// 클라이언트가 memfd 하나에 방향별 SPSC 링 두 개를 만들고, AF_UNIX 연결로 memfd 와 eventfd 두 개를
+// SCM_RIGHTS 로 넘긴다. 그 뒤로 바이트 스트림(프레임)은 링으로만 오가고 소켓은 수명 관리에만 쓴다.
+// 링은 누적 인덱스(head/tail)만 주고받는 lock-free 구조이고, 상대가 잠들었다고 표시했을 때만
+// eventfd 에 써서 깨운다. 둘 다 바쁘게 돌고 있으면 시스템 콜이 전혀 없다.
+//
+// memfd 배치: [헤더 SHM_HEADER_SIZE][클라이언트 -> 서버 링 size][서버 -> 클라이언트 링 size]
+// 링 데이터는 양쪽 모두 두 번 이어서 매핑하므로 경계를 넘는 프레임도 연속된 메모리로 보인다.
+#define SHM_RING_MAGIC 0x53484d52u // "SHMR"
+#define SHM_RING_VERSION 1
+#define SHM_HEADER_SIZE 4096
+#define SHM_RING_MIN_SIZE (64 * 1024)
+#define SHM_RING_MAX_SIZE (64 * 1024 * 1024)
+#define SHM_RING_DEFAULT_SIZE (1024 * 1024)
+
+// SCM_RIGHTS 로 넘기는 fd 순서
+enum shm_fd {
+    SHM_FD_MEMORY,      // 링이 들어 있는 memfd (F_SEAL_SHRINK 필수)
+    SHM_FD_SERVER_WAKE, // 서버가 epoll 로 기다리는 eventfd
+    SHM_FD_CLIENT_WAKE, // 클라이언트가 기다리는 eventfd
+    SHM_FD_COUNT,
+};
+
+enum shm_side {
+    SHM_SIDE_CLIENT,
+    SHM_SIDE_SERVER,
+};
+
+// 한 방향 링의 공유 제어 블록. 생산자와 소비자가 쓰는 필드를 다른 캐시 라인에 둔다.
+struct shm_ring_ctrl {
+    _Alignas(64) uint64_t tail;  // 생산자가 쓴 누적 바이트
+    uint32_t producer_parked;    // 링이 가득 차서 생산자가 잠들었다
+    _Alignas(64) uint64_t head;  // 소비자가 읽은 누적 바이트
+    uint32_t consumer_parked;    // 읽을 게 없어서 소비자가 잠들었다
+};
+
+struct shm_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t ring_size; // 링 하나의 데이터 크기 (2의 거듭제곱, 페이지 배수)
+    struct shm_ring_ctrl rings[2]; // [0] 클라이언트 -> 서버, [1] 서버 -> 클라이언트
+};
+
+// 한 방향 링의 로컬 뷰. 내 쪽 인덱스는 로컬 값만 믿는다 (상대가 공유 메모리를 덮어써도 영향이 없다).
+struct shm_ring {
+    struct shm_ring_ctrl *ctrl;
+    char *data;         // 미러링된 2 * size 매핑
+    uint64_t pos;       // 생산자면 tail, 소비자면 head
+    uint64_t peer_pos;  // 마지막으로 본 상대 인덱스. 생산자는 공간이 모자랄 때만 다시 읽는다
+};
+
+struct shm_channel {
+    struct shm_header *header;
+    uint64_t size;
+    struct shm_ring rx; // 내가 소비자
+    struct shm_ring tx; // 내가 생산자
+    int wait_fd;  // 내가 잠들 때 기다리는 eventfd
+    int peer_fd;  // 상대를 깨울 때 쓰는 eventfd
+    int sleeping; // 잠든다고 표시한 뒤 아직 wait_fd 를 비우지 않았다
+};
+
+// 클라이언트 쪽. ring_size 짜리 링 두 개를 만들고 서버에 넘길 fd 를 fds 에 넣는다.
+// fds[SHM_FD_MEMORY] 는 보낸 뒤 호출자가 닫는다. eventfd 들은 채널이 갖는다.
+int shm_channel_create(struct shm_channel *channel, size_t ring_size, int fds[SHM_FD_COUNT]);
+
+// 서버 쪽. 받은 fd 를 검증하고 매핑한다. 성공하든 실패하든 fd 는 모두 가져간다 (memfd 는 매핑 후 닫는다).
+int shm_channel_attach(struct shm_channel *channel, const int fds[SHM_FD_COUNT]);
+
+void shm_channel_close(struct shm_channel *channel);
+
+// 읽을 수 있는 연속된 데이터. *len 에 길이를 넣는다. 상대가 인덱스를 망가뜨렸으면 NULL.
+const char *shm_channel_read_ptr(struct shm_channel *channel, size_t *len);
+
+// 읽은 만큼 공간을 돌려준다. 생산자가 공간을 기다리며 잠들어 있으면 깨우고 1 을 반환한다.
+int shm_channel_consume(struct shm_channel *channel, size_t len);
+
+// 쓸 수 있는 연속된 공간. 공간이 want 보다 작을 때만 상대 인덱스를 다시 읽는다. 망가졌으면 NULL.
+char *shm_channel_write_ptr(struct shm_channel *channel, size_t want, size_t *space);
+
+// 쓴 만큼 내보낸다. 소비자가 잠들어 있으면 깨우고 1 을 반환한다.
+int shm_channel_commit(struct shm_channel *channel, size_t len);
+
+// 읽을 데이터가 아직 seen 바이트뿐이면 잠든다고 표시하고 1 을 반환한다 (wait_fd 를 기다려도 된다).
+// 그 사이 데이터가 더 왔으면 표시를 거두고 0 을 반환한다.
+int shm_channel_park_reader(struct shm_channel *channel, size_t seen);
+
+// 쓸 공간이 여전히 없으면 잠든다고 표시하고 1, 그 사이 공간이 생겼으면 0.
+int shm_channel_park_writer(struct shm_channel *channel);
+
+// 깨어난 뒤 wait_fd 의 카운터를 비운다. 잠든 적이 없으면 시스템 콜을 하지 않는다.
+void shm_channel_clear_wakeup(struct shm_channel *channel);
+
+#endif // __SHM_RING_H__
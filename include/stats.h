@@ -0,0 +1,105 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+#include <stdio.h>
+#include <stdint.h>
+
+// 서버 통계
+// 워커마다 캐시 라인 단위로 정렬된 shard 를 하나씩 갖고, 자기 shard 에만 쓴다.
+// 쓰는 스레드가 하나뿐이므로 lock 이나 atomic RMW 없이 더하고, 읽는 쪽(stats 소켓 스레드)이
+// 모든 shard 를 합산한다. 값이 찢어지지 않도록 relaxed load/store 만 쓴다 (x86 에서는 일반 mov).
+enum stat_counter {
+    STAT_CONN_ACCEPTED,
+    STAT_CONN_REFUSED,   // 연결 수/메모리/fd 한도로 수락하자마자 끊은 연결
+    STAT_CONN_CLOSED,
+    STAT_CONN_EVICTED,   // 느린 구독자, 송신 기한 초과
+    STAT_CONN_TIMED_OUT, // idle, keepalive
+    STAT_RECV_CALLS,
+    STAT_RECV_BYTES,
+    STAT_RECV_EAGAIN,
+    STAT_SEND_CALLS,
+    STAT_SEND_BYTES,
+    STAT_SEND_EAGAIN,
+    STAT_ACCEPT_ERRORS,
+    STAT_RECV_ERRORS,
+    STAT_SEND_ERRORS,
+    STAT_EPOLL_ERRORS,
+    STAT_MESSAGES_PUBLISHED,
+    STAT_MESSAGES_DROPPED,
+    STAT_DATAGRAMS_RECEIVED, // UDP. GRO 로 뭉쳐 받은 것도 원래 datagram 수로 센다
+    STAT_DATAGRAMS_SENT,
+    STAT_DATAGRAMS_DROPPED,  // 송신 버퍼가 차거나 상대 쪽 오류로 버린 응답
+    STAT_SHM_ATTACHED, // 공유 메모리 링으로 옮긴 연결
+    STAT_SHM_WAKEUPS,  // 잠든 링 클라이언트를 eventfd 로 깨운 횟수
+    STAT_FILE_CACHE_HITS,   // 캐시에 든 매핑으로 응답한 GET
+    STAT_FILE_CACHE_MISSES, // 파일을 새로 열어 매핑한 GET
+    STAT_FILE_NOT_FOUND,    // NOT_FOUND 로 응답한 GET
+    STAT_FILE_BYTES,        // sendfile() 이나 매핑 복사로 보낸 파일 바이트 (send_bytes 에도 들어 있다)
+    STAT_CAPTURE_TRUNCATED, // 캡처 링이 차서 payload 없이 크기만 남긴 레코드
+    STAT_CAPTURE_DROPPED,   // 캡처 링이 차서 버린 레코드
+    STAT_LOOP_ITERATIONS,
+    STAT_LOOP_BUSY_NS, // epoll_wait() 에서 돌아와서 다시 들어갈 때까지 걸린 시간의 합
+    STAT_LOOP_SPIN_HITS, // 잠들기 전 바쁜 대기 중에 이벤트가 와서 잠들지 않은 횟수
+    STAT_LOOP_SLEEPS,    // epoll_wait() 에서 실제로 잠든 횟수
+    STAT_LOOP_SPIN_NS,   // 바쁜 대기에 쓴 시간의 합
+    STAT_COUNTER_COUNT,
+};
+
+enum stat_gauge {
+    STAT_GAUGE_CONNECTIONS,
+    STAT_GAUGE_TIMERS,
+    STAT_GAUGE_TOPICS,
+    STAT_GAUGE_FILE_CACHE_BYTES,
+    STAT_GAUGE_COUNT,
+};
+
+// 루프 한 바퀴 처리 시간 히스토그램. i 번째 칸은 2^i us 이하, 마지막 칸은 그보다 긴 것.
+#define STATS_LOOP_BUCKETS 16
+
+struct stats_shard {
+    uint64_t counters[STAT_COUNTER_COUNT];
+    int64_t gauges[STAT_GAUGE_COUNT];
+    uint64_t loop_buckets[STATS_LOOP_BUCKETS + 1];
+    struct stats_shard *next;
+    int worker;
+} __attribute__((aligned(64)));
+
+// 호출한 워커용 shard 를 만들어 등록한다. 프로세스가 끝날 때까지 해제하지 않는다. 실패하면 NULL.
+struct stats_shard *stats_register(int worker);
+
+static inline void stats_add(struct stats_shard *shard, enum stat_counter id, uint64_t n) {
+    __atomic_store_n(&shard->counters[id], shard->counters[id] + n, __ATOMIC_RELAXED);
+}
+
+static inline void stats_inc(struct stats_shard *shard, enum stat_counter id) {
+    stats_add(shard, id, 1);
+}
+
+static inline void stats_gauge_add(struct stats_shard *shard, enum stat_gauge id, int64_t n) {
+    __atomic_store_n(&shard->gauges[id], shard->gauges[id] + n, __ATOMIC_RELAXED);
+}
+
+static inline void stats_gauge_set(struct stats_shard *shard, enum stat_gauge id, int64_t value) {
+    __atomic_store_n(&shard->gauges[id], value, __ATOMIC_RELAXED);
+}
+
+// 루프 한 바퀴의 처리 시간을 기록한다
+static inline void stats_observe_loop(struct stats_shard *shard, uint64_t busy_ns) {
+    uint64_t us = busy_ns / 1000;
+    int bucket = us <= 1 ? 0 : 64 - __builtin_clzll(us - 1);
+    if (bucket > STATS_LOOP_BUCKETS) {
+        bucket = STATS_LOOP_BUCKETS;
+    }
+    __atomic_store_n(&shard->loop_buckets[bucket], shard->loop_buckets[bucket] + 1, __ATOMIC_RELAXED);
+    stats_inc(shard, STAT_LOOP_ITERATIONS);
+    stats_add(shard, STAT_LOOP_BUSY_NS, busy_ns);
+}
+
+// 모든 shard 를 합산한 스냅샷을 Prometheus text 형식으로 쓴다 (버퍼 풀 사용량 포함)
+void stats_write(FILE *out);
+
+// path 에 Unix 도메인 소켓을 열고, 연결이 올 때마다 스냅샷을 써 주고 닫는 스레드를 띄운다.
+// '@' 로 시작하면 abstract namespace 를 쓴다. 실패하면 0.
+int stats_start(const char *path);
+void stats_stop(void);
+
+#endif // __STATS_H__
@@ -0,0 +1,54 @@
+#ifndef __TIMER_WHEEL_H__
+#define __TIMER_WHEEL_H__
+#include <stddef.h>
+#include <stdint.h>
+
+// 계층형 타이머 휠
+// 64칸짜리 휠 4단. 0단 한 칸이 tick 하나이고, 위 단으로 갈수록 한 칸이 64배씩 길어진다.
+// 만료 tick 과 현재 tick 이 처음 달라지는 6비트 묶음의 단에 넣고, 현재 tick 이 그 칸에 도달하면
+// 아래 단으로 내려보낸다(cascade). 등록/취소는 O(1) 이다.
+// 타이머는 호출자의 구조체 안에 넣어 두고 TIMER_ENTRY() 로 바깥 구조체를 찾는다.
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+
+#define TIMER_ENTRY(ptr, type, member) ((type *) ((char *) (ptr) - offsetof(type, member)))
+
+struct timer;
+typedef void (*timer_fn)(struct timer *timer, void *arg);
+
+struct timer {
+    struct timer *next;
+    struct timer **pprev; // 등록되지 않았으면 NULL
+    uint64_t expires;     // tick
+    timer_fn fn;
+};
+
+struct timer_wheel {
+    struct timer *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint64_t current; // 마지막으로 처리한 tick
+    uint64_t tick_ms;
+    size_t count;
+};
+
+void timer_wheel_init(struct timer_wheel *wheel, uint64_t now_ms, uint64_t tick_ms);
+
+void timer_init(struct timer *timer, timer_fn fn);
+
+static inline int timer_pending(const struct timer *timer) {
+    return timer->pprev != NULL;
+}
+
+// expires_ms (단조 시계 기준) 이후 첫 tick 에 만료되도록 등록한다. 이미 등록되어 있으면 옮긴다.
+// 휠 범위(대략 tick 2^24 개)를 넘는 시각은 범위 끝에서 만료되므로 콜백에서 다시 확인해야 한다.
+void timer_arm(struct timer_wheel *wheel, struct timer *timer, uint64_t expires_ms);
+
+void timer_cancel(struct timer_wheel *wheel, struct timer *timer);
+
+// now_ms 까지 만료된 타이머의 콜백을 부른다. 콜백 안에서 타이머를 등록/취소해도 된다.
+void timer_wheel_advance(struct timer_wheel *wheel, uint64_t now_ms, void *arg);
+
+// 다음에 처리할 일이 있는 시각까지 남은 ms. 타이머가 없으면 -1.
+int timer_wheel_timeout_ms(const struct timer_wheel *wheel, uint64_t now_ms);
+
+#endif // __TIMER_WHEEL_H__
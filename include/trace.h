@@ -0,0 +1,102 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include "histogram.h"
+
+// 메시지 단위 지연 추적 (옵션)
+// 표본으로 고른 수신 하나에 대해 다음 시각을 모아서 구간별 히스토그램에 넣는다.
+//   rx      커널이 패킷을 받은 시각 (SO_TIMESTAMPING 소프트웨어 RX)
+//   wake    이벤트 루프가 epoll_wait() 에서 돌아온 시각
+//   dispatch 그 연결의 recv 가 돌아온 시각
+//   send    응답을 보내는 sendmsg() 직전
+//   tx      커널이 응답을 장치로 넘긴 시각 (SO_TIMESTAMPING 소프트웨어 TX, 에러 큐로 돌아온다)
+// 커널 타임스탬프가 CLOCK_REALTIME 이므로 루프 쪽 시각도 CLOCK_REALTIME 으로 잰다.
+//
+// 트레이스 파일은 struct trace_file_header 하나 뒤에 struct trace_record 가 이어진다 (host byte order).
+#define TRACE_FILE_MAGIC "SRVTRACE"
+#define TRACE_FILE_VERSION 1
+
+enum trace_stage {
+    TRACE_RX_TO_WAKE,       // 커널 수신 큐 + epoll_wait() 가 돌아오기까지
+    TRACE_WAKE_TO_DISPATCH, // 같은 바퀴에서 앞선 연결들을 처리하는 시간 + recv
+    TRACE_DISPATCH_TO_SEND, // 파싱/핸들러/송신 대기
+    TRACE_SEND_TO_TX,       // sendmsg() 부터 커널 송신까지
+    TRACE_TOTAL,
+    TRACE_STAGE_COUNT,
+};
+
+struct trace_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+};
+
+struct trace_record {
+    uint64_t rx_ns;
+    uint64_t wake_ns;
+    uint64_t dispatch_ns;
+    uint64_t send_ns;
+    uint64_t tx_ns;
+    uint32_t worker;
+    uint32_t conn; // 연결 테이블 인덱스
+};
+
+// 워커 하나의 추적 상태
+struct tracer {
+    struct histogram stages[TRACE_STAGE_COUNT];
+    struct trace_record *records; // 파일에 쓰기 전에 모아 두는 버퍼
+    size_t record_count;
+    int fd;                       // 트레이스 파일 (-1 이면 히스토그램만)
+    int worker;
+    uint32_t sample_every;
+    uint32_t countdown;
+    uint64_t completed;
+};
+
+uint64_t realtime_ns(void);
+
+// 트레이스 파일을 만들고 헤더를 쓴다. 워커들이 O_APPEND 로 함께 쓴다. 실패하면 -1.
+int trace_open_file(const char *path);
+
+// fd 가 -1 이면 파일에는 쓰지 않는다. 메모리가 없으면 0.
+int tracer_init(struct tracer *tracer, int worker, uint32_t sample_every, int fd);
+void tracer_destroy(struct tracer *tracer);
+
+// sample_every 번에 한 번 1
+static inline int tracer_should_sample(struct tracer *tracer) {
+    if (--tracer->countdown > 0) {
+        return 0;
+    }
+    tracer->countdown = tracer->sample_every;
+    return 1;
+}
+
+// 표본으로 고른 수신이 데이터를 못 받았을 때. 다음 수신을 표본으로 삼는다.
+static inline void tracer_defer_sample(struct tracer *tracer) {
+    tracer->countdown = 1;
+}
+
+// 다 모인 기록 하나를 히스토그램과 파일 버퍼에 넣는다
+void tracer_complete(struct tracer *tracer, const struct trace_record *record);
+
+// 모아 둔 기록을 파일에 쓴다
+void tracer_flush(struct tracer *tracer);
+
+void tracer_report(FILE *out, const struct tracer *tracer);
+
+// 소켓에 소프트웨어 RX 타임스탬프를 켠다. TX 는 trace_sendmsg() 로 보낼 때만 요청한다.
+int trace_enable_socket(int fd);
+
+// recv() 와 같지만 커널 RX 타임스탬프를 *rx_ns 에 넣는다 (없으면 0)
+ssize_t trace_recv(int fd, void *buf, size_t len, uint64_t *rx_ns);
+
+// sendmsg() 와 같지만 이 호출의 마지막 바이트에 대해 TX 타임스탬프를 요청한다
+ssize_t trace_sendmsg(int fd, struct msghdr *msg, int flags);
+
+// 에러 큐에서 TX 타임스탬프 하나를 꺼낸다. 꺼냈으면 1, 큐가 비었으면 0, 오류면 -1.
+int trace_read_tx(int fd, uint64_t *tx_ns);
+
+#endif // __TRACE_H__
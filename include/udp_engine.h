@@ -0,0 +1,20 @@
+#ifndef __UDP_ENGINE_H__
+#define __UDP_ENGINE_H__
+
+struct stats_shard;
+
+#define UDP_DEFAULT_BATCH 64
+#define UDP_MAX_BATCH 1024
+
+struct udp_options {
+    int batch; // recvmmsg() 한 번에 받는 최대 datagram 수
+    int gro;   // UDP_GRO 로 뭉쳐 받고, 뭉친 그대로 UDP_SEGMENT 로 돌려준다
+};
+
+// UDP datagram 에코 엔진
+// recvmmsg() 로 한 번에 여러 datagram 을 받아서 같은 버퍼를 그대로 sendmmsg() 로 보낸 곳에 돌려준다.
+// 손실을 허용하는 트래픽이므로 송신 버퍼가 차면 기다리지 않고 응답을 버린다.
+// 카운터는 stats 에 쌓는다. 소켓을 더 쓸 수 없어 끝나면 1, 초기화에 실패하면 0 을 반환한다.
+int run_udp_engine(int server_fd, struct stats_shard *stats, const struct udp_options *options);
+
+#endif // __UDP_ENGINE_H__
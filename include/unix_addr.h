@@ -0,0 +1,30 @@
+#ifndef __UNIX_ADDR_H__
+#define __UNIX_ADDR_H__
+#include <string.h>
+#include <stddef.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// path 를 AF_UNIX 주소로 만든다. '@' 로 시작하면 abstract namespace (파일이 생기지 않는다).
+// 비었거나 sun_path 보다 길면 0.
+static inline int unix_addr_init(const char *path, struct sockaddr_un *addr, socklen_t *addr_len) {
+    size_t path_len = strlen(path);
+    memset(addr, 0, sizeof(*addr));
+    if (path_len == 0 || path_len >= sizeof(addr->sun_path)) {
+        return 0;
+    }
+    addr->sun_family = AF_UNIX;
+    memcpy(addr->sun_path, path, path_len);
+    if (path[0] == '@') {
+        addr->sun_path[0] = '\0';
+    }
+    // abstract 주소는 길이로 끝을 정하므로 NUL 을 포함하지 않는다
+    *addr_len = (socklen_t) (offsetof(struct sockaddr_un, sun_path) + path_len + (path[0] == '@' ? 0 : 1));
+    return 1;
+}
+
+static inline int unix_addr_is_abstract(const char *path) {
+    return path[0] == '@';
+}
+
+#endif // __UNIX_ADDR_H__
@@ -0,0 +1,12 @@
+#ifndef __URING_ENGINE_H__
+#define __URING_ENGINE_H__
+
+struct stats_shard;
+
+// io_uring 기반 에코 엔진
+// multishot accept, 커널 제공 버퍼 링(provided buffer ring)에 대한 multishot recv,
+// 연결 단위로 버퍼를 묶은 sendmsg 를 루프 한 바퀴당 io_uring_enter() 한 번으로 처리한다.
+// 카운터는 stats 에 쌓는다. 성공적으로 종료하면 1, 초기화에 실패하면 0 을 반환한다.
+int run_uring_engine(int server_fd, struct stats_shard *stats);
+
+#endif // __URING_ENGINE_H__
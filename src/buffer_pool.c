@@ -0,0 +1,205 @@
+#define _GNU_SOURCE
+#include "../include/buffer_pool.h"
+#include "../include/log.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// 스레드마다 등급별로 이만큼까지만 캐시하고 나머지는 커널에 돌려준다
+#define BUFFER_POOL_CACHE_BYTES (8 * 1024 * 1024)
+
+// free list 노드는 반환된 블록의 첫 바이트에 그대로 둔다
+struct pool_block {
+    struct pool_block *next;
+};
+
+struct pool_cache {
+    struct pool_block *head[BUFFER_POOL_CLASS_COUNT];
+    size_t count[BUFFER_POOL_CLASS_COUNT];
+};
+
+static __thread struct pool_cache thread_cache;
+
+// 통계용 전역 카운터. 모두 relaxed atomic 이다.
+static size_t pool_budget = 0;
+static size_t pool_reserved = 0;
+static size_t pool_in_use[BUFFER_POOL_CLASS_COUNT];
+static size_t pool_cached[BUFFER_POOL_CLASS_COUNT];
+static size_t pool_large_in_use = 0;
+
+static size_t class_size(int cls) {
+    return (size_t) BUFFER_POOL_MIN_SIZE << (2 * cls);
+}
+
+// 등급 번호. 최대 등급보다 크면 -1.
+static int size_class(size_t size) {
+    for (int cls = 0; cls < BUFFER_POOL_CLASS_COUNT; cls++) {
+        if (size <= class_size(cls)) {
+            return cls;
+        }
+    }
+    return -1;
+}
+
+// size 크기의 memfd 를 두 번 이어서 매핑한다. 실패하면 NULL.
+static char *mirror_map(size_t size) {
+    int fd = memfd_create("ring_buffer", MFD_CLOEXEC);
+    if (fd == -1) {
+        LOG_SYSERR("memfd_create() failed");
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t) size) == -1) {
+        LOG_SYSERR("ftruncate() failed");
+        close(fd);
+        return NULL;
+    }
+
+    // 2 * size 의 연속된 주소 공간을 먼저 예약한 뒤 두 절반에 같은 파일을 덮어쓴다
+    char *base = mmap(NULL, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        LOG_SYSERR("mmap() failed: ring buffer reservation");
+        close(fd);
+        return NULL;
+    }
+    if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        LOG_SYSERR("mmap() failed: ring buffer mirror");
+        munmap(base, size * 2);
+        close(fd);
+        return NULL;
+    }
+
+    // 매핑이 파일을 참조하고 있으므로 fd 는 바로 닫아도 된다
+    close(fd);
+    return base;
+}
+
+static void mirror_unmap(char *block, size_t size) {
+    munmap(block, size * 2);
+    __atomic_fetch_sub(&pool_reserved, size, __ATOMIC_RELAXED);
+}
+
+void buffer_pool_set_budget(size_t budget_bytes) {
+    __atomic_store_n(&pool_budget, budget_bytes, __ATOMIC_RELAXED);
+}
+
+size_t buffer_pool_block_size(size_t size) {
+    int cls = size_class(size);
+    if (cls >= 0) {
+        return class_size(cls);
+    }
+    size_t block = class_size(BUFFER_POOL_CLASS_COUNT - 1);
+    while (block < size) {
+        block *= 2;
+    }
+    return block;
+}
+
+int buffer_pool_has_room(size_t size) {
+    size_t budget = __atomic_load_n(&pool_budget, __ATOMIC_RELAXED);
+    return budget == 0 || __atomic_load_n(&pool_reserved, __ATOMIC_RELAXED) + size <= budget;
+}
+
+// 예산 안에서 size 바이트를 예약한다
+static int reserve_bytes(size_t size) {
+    size_t budget = __atomic_load_n(&pool_budget, __ATOMIC_RELAXED);
+    size_t reserved = __atomic_add_fetch(&pool_reserved, size, __ATOMIC_RELAXED);
+    if (budget != 0 && reserved > budget) {
+        __atomic_fetch_sub(&pool_reserved, size, __ATOMIC_RELAXED);
+        return 0;
+    }
+    return 1;
+}
+
+char *buffer_pool_alloc(size_t size) {
+    size_t block_size = buffer_pool_block_size(size);
+    int cls = size_class(block_size);
+
+    if (cls >= 0 && thread_cache.head[cls]) {
+        struct pool_block *block = thread_cache.head[cls];
+        thread_cache.head[cls] = block->next;
+        thread_cache.count[cls]--;
+        __atomic_fetch_sub(&pool_cached[cls], 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&pool_in_use[cls], 1, __ATOMIC_RELAXED);
+        return (char *) block;
+    }
+
+    if (!reserve_bytes(block_size)) {
+        return NULL; // 메모리 예산 초과
+    }
+    char *block = mirror_map(block_size);
+    if (!block) {
+        __atomic_fetch_sub(&pool_reserved, block_size, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    if (cls >= 0) {
+        __atomic_fetch_add(&pool_in_use[cls], 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&pool_large_in_use, 1, __ATOMIC_RELAXED);
+    }
+    return block;
+}
+
+void buffer_pool_free(char *block, size_t size) {
+    int cls = size_class(size);
+
+    if (cls < 0) {
+        __atomic_fetch_sub(&pool_large_in_use, 1, __ATOMIC_RELAXED);
+        mirror_unmap(block, size);
+        return;
+    }
+
+    __atomic_fetch_sub(&pool_in_use[cls], 1, __ATOMIC_RELAXED);
+    if ((thread_cache.count[cls] + 1) * size > BUFFER_POOL_CACHE_BYTES && thread_cache.count[cls] > 0) {
+        mirror_unmap(block, size);
+        return;
+    }
+
+    struct pool_block *node = (struct pool_block *) block;
+    node->next = thread_cache.head[cls];
+    thread_cache.head[cls] = node;
+    thread_cache.count[cls]++;
+    __atomic_fetch_add(&pool_cached[cls], 1, __ATOMIC_RELAXED);
+}
+
+void buffer_pool_thread_release(void) {
+    for (int cls = 0; cls < BUFFER_POOL_CLASS_COUNT; cls++) {
+        while (thread_cache.head[cls]) {
+            struct pool_block *block = thread_cache.head[cls];
+            thread_cache.head[cls] = block->next;
+            mirror_unmap((char *) block, class_size(cls));
+            __atomic_fetch_sub(&pool_cached[cls], 1, __ATOMIC_RELAXED);
+        }
+        thread_cache.count[cls] = 0;
+    }
+}
+
+void buffer_pool_get_stats(struct buffer_pool_stats *stats) {
+    for (int cls = 0; cls < BUFFER_POOL_CLASS_COUNT; cls++) {
+        stats->class_size[cls] = class_size(cls);
+        stats->in_use[cls] = __atomic_load_n(&pool_in_use[cls], __ATOMIC_RELAXED);
+        stats->cached[cls] = __atomic_load_n(&pool_cached[cls], __ATOMIC_RELAXED);
+    }
+    stats->large_in_use = __atomic_load_n(&pool_large_in_use, __ATOMIC_RELAXED);
+    stats->reserved_bytes = __atomic_load_n(&pool_reserved, __ATOMIC_RELAXED);
+    stats->budget_bytes = __atomic_load_n(&pool_budget, __ATOMIC_RELAXED);
+}
+
+void buffer_pool_report(FILE *out) {
+    struct buffer_pool_stats stats;
+    buffer_pool_get_stats(&stats);
+
+    fprintf(out, "[pool] class     in_use   cached\n");
+    for (int cls = 0; cls < BUFFER_POOL_CLASS_COUNT; cls++) {
+        fprintf(out, "[pool] %5zuK %9zu %8zu\n", stats.class_size[cls] / 1024, stats.in_use[cls], stats.cached[cls]);
+    }
+    fprintf(out, "[pool] large  %9zu\n", stats.large_in_use);
+    if (stats.budget_bytes) {
+        fprintf(out, "[pool] reserved %zu KiB / budget %zu KiB\n", stats.reserved_bytes / 1024, stats.budget_bytes / 1024);
+    } else {
+        fprintf(out, "[pool] reserved %zu KiB / budget unlimited\n", stats.reserved_bytes / 1024);
+    }
+    fflush(out);
+}
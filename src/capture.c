@@ -0,0 +1,209 @@
+#define _GNU_SOURCE
+#include "../include/capture.h"
+#include "../include/log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+
+#define CAPTURE_IDLE_SLEEP_NS (1000 * 1000)
+
+// 생산자 하나(워커), 소비자 하나(캡처 스레드)인 바이트 링. 레코드는 링 경계를 넘어 이어질 수 있고,
+// 캡처 스레드는 [head, tail) 를 그대로 파일에 이어 쓴다. tail 은 레코드 단위로만 움직인다.
+struct capture_ring {
+    size_t head __attribute__((aligned(64))); // 캡처 스레드가 다음에 쓸 위치
+    size_t tail __attribute__((aligned(64))); // 워커가 다음에 넣을 위치
+    uint16_t worker;
+    struct capture_ring *next;
+    char *data;
+};
+
+static struct capture_ring *rings = NULL;
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t writer_thread;
+static int writer_running = 0;
+static int writer_stop = 0;
+static int capture_fd = -1;
+static int capture_payload = 0;
+static uint64_t start_ns = 0;
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+// 파일에 쓴다. 실패하면 한 번만 알리고 그 뒤로는 링을 비우기만 한다 (워커가 막히지 않게).
+static void write_all(const char *data, size_t len) {
+    static int failed = 0;
+    while (len > 0 && !failed) {
+        ssize_t written = write(capture_fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_SYSERR("Failed to write capture file, discarding further records");
+            failed = 1;
+            return;
+        }
+        data += written;
+        len -= (size_t) written;
+    }
+}
+
+// 모든 워커의 링을 비운다. 쓴 바이트 수를 반환한다.
+static size_t drain_rings(void) {
+    size_t drained = 0;
+
+    for (struct capture_ring *ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+        size_t head = ring->head;
+        size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            continue;
+        }
+        size_t offset = head & (CAPTURE_RING_SIZE - 1);
+        size_t len = tail - head;
+        size_t first = len < CAPTURE_RING_SIZE - offset ? len : CAPTURE_RING_SIZE - offset;
+        write_all(ring->data + offset, first);
+        if (first < len) {
+            write_all(ring->data, len - first);
+        }
+        __atomic_store_n(&ring->head, tail, __ATOMIC_RELEASE);
+        drained += len;
+    }
+    return drained;
+}
+
+static void *writer_main(void *arg) {
+    (void) arg;
+    while (1) {
+        int stop = __atomic_load_n(&writer_stop, __ATOMIC_ACQUIRE);
+        size_t drained = drain_rings();
+        if (stop && drained == 0) {
+            break;
+        }
+        if (drained == 0) {
+            struct timespec ts = {0, CAPTURE_IDLE_SLEEP_NS};
+            nanosleep(&ts, NULL);
+        }
+    }
+    return NULL;
+}
+
+int capture_start(const char *path, int payload) {
+    capture_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (capture_fd == -1) {
+        LOG_SYSERR("Failed to open capture file");
+        return 0;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    start_ns = monotonic_ns();
+
+    struct capture_file_header header = {0};
+    memcpy(header.magic, CAPTURE_FILE_MAGIC, sizeof(header.magic));
+    header.version = CAPTURE_FILE_VERSION;
+    header.record_size = sizeof(struct capture_record);
+    header.start_realtime_ns = (uint64_t) now.tv_sec * 1000000000 + (uint64_t) now.tv_nsec;
+    if (write(capture_fd, &header, sizeof(header)) != (ssize_t) sizeof(header)) {
+        LOG_SYSERR("Failed to write capture file header");
+        close(capture_fd);
+        capture_fd = -1;
+        return 0;
+    }
+
+    capture_payload = payload;
+    writer_stop = 0;
+    int rc = pthread_create(&writer_thread, NULL, writer_main, NULL);
+    if (rc != 0) {
+        errno = rc;
+        LOG_SYSERR("pthread_create() failed for capture writer");
+        close(capture_fd);
+        capture_fd = -1;
+        return 0;
+    }
+    writer_running = 1;
+    return 1;
+}
+
+void capture_stop(void) {
+    if (!writer_running) {
+        return;
+    }
+    __atomic_store_n(&writer_stop, 1, __ATOMIC_RELEASE);
+    pthread_join(writer_thread, NULL);
+    writer_running = 0;
+    close(capture_fd);
+    capture_fd = -1;
+}
+
+struct capture_ring *capture_register(int worker) {
+    struct capture_ring *ring = (struct capture_ring *) aligned_alloc(64, sizeof(struct capture_ring));
+    if (!ring) {
+        LOG_SYSERR("Memory allocation failed: capture ring");
+        return NULL;
+    }
+    memset(ring, 0, sizeof(*ring));
+    ring->data = (char *) malloc(CAPTURE_RING_SIZE);
+    if (!ring->data) {
+        LOG_SYSERR("Memory allocation failed: capture ring");
+        free(ring);
+        return NULL;
+    }
+    ring->worker = (uint16_t) worker;
+
+    pthread_mutex_lock(&rings_lock);
+    ring->next = rings;
+    __atomic_store_n(&rings, ring, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&rings_lock);
+    return ring;
+}
+
+static void ring_copy(struct capture_ring *ring, size_t pos, const void *src, size_t len) {
+    size_t offset = pos & (CAPTURE_RING_SIZE - 1);
+    size_t first = len < CAPTURE_RING_SIZE - offset ? len : CAPTURE_RING_SIZE - offset;
+    memcpy(ring->data + offset, src, first);
+    if (first < len) {
+        memcpy(ring->data, (const char *) src + first, len - first);
+    }
+}
+
+enum capture_result capture_event(struct capture_ring *ring, enum capture_event type, uint32_t conn, uint8_t flags,
+                                  const char *data, size_t len) {
+    static const char padding[8] = {0};
+    struct capture_record rec;
+    rec.time_ns = monotonic_ns() - start_ns;
+    rec.conn = conn;
+    rec.worker = ring->worker;
+    rec.type = (uint8_t) type;
+    rec.flags = flags;
+    rec.len = (uint32_t) len;
+    rec.stored = capture_payload && data ? (uint32_t) len : 0;
+
+    size_t tail = ring->tail;
+    size_t space = CAPTURE_RING_SIZE - (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE));
+    enum capture_result result = CAPTURE_RECORDED;
+    if (capture_record_span(&rec) > space) {
+        // 캡처 스레드가 따라오지 못한다. 루프를 막지 않고 크기라도 남긴다
+        rec.stored = 0;
+        result = CAPTURE_TRUNCATED;
+        if (capture_record_span(&rec) > space) {
+            return CAPTURE_DROPPED;
+        }
+    }
+
+    size_t span = capture_record_span(&rec);
+    ring_copy(ring, tail, &rec, sizeof(rec));
+    if (rec.stored > 0) {
+        ring_copy(ring, tail + sizeof(rec), data, rec.stored);
+    }
+    size_t pad = span - sizeof(rec) - rec.stored;
+    if (pad > 0) {
+        ring_copy(ring, tail + sizeof(rec) + rec.stored, padding, pad);
+    }
+    __atomic_store_n(&ring->tail, tail + span, __ATOMIC_RELEASE);
+    return result;
+}
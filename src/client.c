@@ -6,14 +6,19 @@
 #include <errno.h>
 #include <poll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <arpa/inet.h>
 #include "../include/err_handle.h"
+#include "../include/framing.h"
+#include "../include/unix_addr.h"
+#include "../include/shm_ring.h"
 
 #define SERVER_IP "127.0.0.1"  // 서버 주소
 #define SERVER_PORT 12345       // 서버 포트
 #define BUFFER_SIZE 1024
 #define TIMEOUT 5000            // 5초 타임아웃
 #define MAX_RETRIES 5           // 최대 재시도 횟수
+#define FRAME_BUFFER_SIZE (64 * 1024) // 프레임 모드 수신 버퍼
 
 void set_nonblocking(int fd) {
     int flags = fcntl(fd, F_GETFL, 0);
@@ -27,15 +32,258 @@ void set_nonblocking(int fd) {
     }
 }
 
-int main() {
+// 프레임 핸들러에 넘기는 문맥. 공유 메모리 링으로 옮긴 뒤에는 링으로 주고받는다.
+struct client_ctx {
+    int sockfd;
+    struct frame_dispatcher *dispatcher;
+    char *frame_buffer; // 소켓에서 받은 미완성 프레임
+    size_t frame_length;
+    struct shm_channel *shm; // 링으로 옮기기로 했으면 있다
+    int attached;            // 서버가 SHM_ATTACH 를 수락했다
+};
+
+// 프레임 모드: 받은 프레임을 하나씩 출력
+int print_frame(void *ctx, const struct frame *frame) {
+    (void) ctx;
+    if (frame->type == FRAME_TYPE_PONG) {
+        printf("서버: [pong]\n");
+    } else if (frame->type == FRAME_TYPE_FILE) {
+        printf("서버: [file, %u bytes]\n", frame->len);
+    } else if (frame->type == FRAME_TYPE_NOT_FOUND) {
+        printf("서버: [not found] %.*s\n", (int) frame->len, frame->payload);
+    } else {
+        printf("서버: [type %u, %u bytes] %.*s", frame->type, frame->len, (int) frame->len, frame->payload);
+    }
+    return 1;
+}
+
+void send_frame(struct client_ctx *ctx, uint8_t type, const char *payload, size_t len);
+
+// 서버의 keepalive PING 에 PONG 으로 답한다
+int reply_ping(void *ctx, const struct frame *frame) {
+    (void) frame;
+    send_frame((struct client_ctx *) ctx, FRAME_TYPE_PONG, NULL, 0);
+    return 1;
+}
+
+// 서버가 링을 붙였다. 이제부터 프레임은 링으로만 보낸다.
+int handle_attach_ack(void *ctx, const struct frame *frame) {
+    (void) frame;
+    struct client_ctx *client = (struct client_ctx *) ctx;
+    if (!client->shm) {
+        return 0;
+    }
+    client->attached = 1;
+    printf("공유 메모리 링으로 전환했습니다.\n");
+    return 1;
+}
+
+void send_all(int sockfd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t sent = send(sockfd, data, len, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                struct pollfd pfd = {sockfd, POLLOUT, 0};
+                poll(&pfd, 1, TIMEOUT);
+                continue;
+            }
+            perror("send() 실패");
+            return;
+        }
+        data += sent;
+        len -= (size_t) sent;
+    }
+}
+
+// 소켓에서 받은 만큼 프레임을 처리한다. 서버가 닫았거나 잘못된 프레임이면 0.
+int receive_frames(struct client_ctx *ctx) {
+    ssize_t bytes_received = recv(ctx->sockfd, ctx->frame_buffer + ctx->frame_length,
+                                  FRAME_BUFFER_SIZE - ctx->frame_length, 0);
+    if (bytes_received == 0) {
+        printf("서버가 연결을 종료했습니다.\n");
+        return 0;
+    }
+    if (bytes_received < 0) {
+        return errno == EAGAIN || errno == EINTR;
+    }
+    ctx->frame_length += (size_t) bytes_received;
+    size_t need;
+    ssize_t used = frame_dispatch(ctx->dispatcher, ctx, ctx->frame_buffer, ctx->frame_length, &need);
+    if (used < 0) {
+        fprintf(stderr, "잘못된 프레임을 받았습니다.\n");
+        return 0;
+    }
+    // 남은 미완성 프레임을 앞으로 당긴다
+    memmove(ctx->frame_buffer, ctx->frame_buffer + used, ctx->frame_length - (size_t) used);
+    ctx->frame_length -= (size_t) used;
+    return 1;
+}
+
+// 링에 온 프레임을 모두 처리하고, 더 올 게 없으면 잠든다고 표시한다 (그러면 서버가 eventfd 로 깨운다).
+// 링이 망가졌거나 잘못된 프레임이면 0.
+int receive_shm_frames(struct client_ctx *ctx) {
+    shm_channel_clear_wakeup(ctx->shm);
+    while (1) {
+        size_t len;
+        const char *data = shm_channel_read_ptr(ctx->shm, &len);
+        if (!data) {
+            fprintf(stderr, "공유 메모리 링이 망가졌습니다.\n");
+            return 0;
+        }
+        size_t need = 0;
+        ssize_t used = len > 0 ? frame_dispatch(ctx->dispatcher, ctx, data, len, &need) : 0;
+        if (used < 0) {
+            fprintf(stderr, "잘못된 프레임을 받았습니다.\n");
+            return 0;
+        }
+        if (used == 0) {
+            if (shm_channel_park_reader(ctx->shm, len)) {
+                return 1;
+            }
+            continue; // 그 사이 더 왔다
+        }
+        shm_channel_consume(ctx->shm, (size_t) used);
+    }
+}
+
+// 링에 모두 쓴다. 링이 가득 차면 서버가 읽을 때까지 잠드는데, 그동안 서버 쪽 링도 비워 줘야
+// 서로 기다리다 멈추지 않는다.
+void shm_write_all(struct client_ctx *ctx, const char *data, size_t len) {
+    while (len > 0) {
+        size_t space;
+        char *out = shm_channel_write_ptr(ctx->shm, len, &space);
+        if (!out) {
+            fprintf(stderr, "공유 메모리 링이 망가졌습니다.\n");
+            return;
+        }
+        if (space == 0) {
+            if (!receive_shm_frames(ctx)) {
+                return;
+            }
+            if (shm_channel_park_writer(ctx->shm)) {
+                struct pollfd pfd = {ctx->shm->wait_fd, POLLIN, 0};
+                poll(&pfd, 1, TIMEOUT);
+            }
+            continue;
+        }
+        size_t n = len < space ? len : space;
+        memcpy(out, data, n);
+        shm_channel_commit(ctx->shm, n);
+        data += n;
+        len -= n;
+    }
+}
+
+// 프레임 하나를 보낸다. 링으로 옮겼으면 링으로, 아니면 소켓으로.
+void send_frame(struct client_ctx *ctx, uint8_t type, const char *payload, size_t len) {
+    char header[FRAME_HEADER_SIZE];
+    frame_encode_header(header, type, (uint32_t) len);
+    if (ctx->attached) {
+        shm_write_all(ctx, header, FRAME_HEADER_SIZE);
+        shm_write_all(ctx, payload, len);
+    } else {
+        send_all(ctx->sockfd, header, FRAME_HEADER_SIZE);
+        send_all(ctx->sockfd, payload, len);
+    }
+}
+
+// 공유 메모리 링을 만들어 memfd 와 eventfd 를 SHM_ATTACH 프레임에 실어 보내고 수락 응답을 기다린다
+int attach_shm(struct client_ctx *ctx, struct shm_channel *shm) {
+    int fds[SHM_FD_COUNT];
+    if (!shm_channel_create(shm, SHM_RING_DEFAULT_SIZE, fds)) {
+        return 0;
+    }
+    ctx->shm = shm;
+
+    char header[FRAME_HEADER_SIZE];
+    frame_encode_header(header, FRAME_TYPE_SHM_ATTACH, 0);
+    union {
+        char buf[CMSG_SPACE(sizeof(fds))];
+        struct cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct iovec iov = {header, FRAME_HEADER_SIZE};
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    // 헤더 5바이트는 빈 소켓 버퍼에 한 번에 들어간다
+    ssize_t sent = sendmsg(ctx->sockfd, &msg, MSG_NOSIGNAL);
+    close(fds[SHM_FD_MEMORY]); // 매핑이 파일을 잡고 있다
+    if (sent != FRAME_HEADER_SIZE) {
+        perror("sendmsg() 실패");
+        return 0;
+    }
+
+    while (!ctx->attached) {
+        struct pollfd pfd = {ctx->sockfd, POLLIN, 0};
+        if (poll(&pfd, 1, TIMEOUT) <= 0) {
+            fprintf(stderr, "서버가 공유 메모리 링을 수락하지 않았습니다.\n");
+            return 0;
+        }
+        if (!receive_frames(ctx)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    // -f: 입력 한 줄을 ECHO 프레임 하나로 보낸다. "ping" 은 PING, "get 이름" 은 GET 프레임으로 보낸다.
+    // -U: TCP 대신 서버의 AF_UNIX 리스너(-U)에 붙는다. '@' 로 시작하면 abstract namespace.
+    // -m: 연결한 뒤 공유 메모리 링으로 옮긴다 (-U 필요, 프레임 모드로 동작).
+    int framed = 0;
+    int use_shm = 0;
+    const char *unix_path = NULL;
+    int opt_ch;
+    while ((opt_ch = getopt(argc, argv, "fU:m")) != -1) {
+        if (opt_ch == 'f') {
+            framed = 1;
+        } else if (opt_ch == 'U') {
+            unix_path = optarg;
+        } else if (opt_ch == 'm') {
+            use_shm = 1;
+            framed = 1;
+        } else {
+            fprintf(stderr, "Usage: %s [-f] [-U path [-m]]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (use_shm && !unix_path) {
+        fprintf(stderr, "공유 메모리 링은 AF_UNIX 연결(-U)로만 넘길 수 있습니다.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    struct frame_dispatcher dispatcher;
+    frame_dispatcher_init(&dispatcher, FRAME_BUFFER_SIZE - FRAME_HEADER_SIZE);
+    frame_register(&dispatcher, FRAME_TYPE_ECHO, print_frame);
+    frame_register(&dispatcher, FRAME_TYPE_PONG, print_frame);
+    frame_register(&dispatcher, FRAME_TYPE_PING, reply_ping);
+    frame_register(&dispatcher, FRAME_TYPE_SHM_ATTACH, handle_attach_ack);
+    frame_register(&dispatcher, FRAME_TYPE_FILE, print_frame);
+    frame_register(&dispatcher, FRAME_TYPE_NOT_FOUND, print_frame);
+    static char frame_buffer[FRAME_BUFFER_SIZE];
+    struct client_ctx ctx = {0};
+    ctx.dispatcher = &dispatcher;
+    ctx.frame_buffer = frame_buffer;
+    struct shm_channel shm;
+
     int sockfd = -1;
-    struct sockaddr_in server_addr = {0};
+    struct sockaddr_storage server_addr = {0};
+    socklen_t server_addr_len = 0;
     char buffer[BUFFER_SIZE] = {0};
     int socket_create_ok = 0;
 
     do {
         // 소켓 생성
-        sockfd = socket(AF_INET, SOCK_STREAM | O_NONBLOCK | O_CLOEXEC, 0);
+        sockfd = socket(unix_path ? AF_UNIX : AF_INET, SOCK_STREAM | O_NONBLOCK | O_CLOEXEC, 0);
         if (sockfd == -1) {
             if (handle_socket_error()) {
                 continue;
@@ -45,12 +293,22 @@ int main() {
 
         // 서버 주소 설정
         memset(&server_addr, 0, sizeof(server_addr));
-        server_addr.sin_family = AF_INET;
-        server_addr.sin_port = htons(SERVER_PORT);
-        if (inet_pton(AF_INET, SERVER_IP, &server_addr.sin_addr) <= 0) {
-            perror("inet_pton() 실패");
-            close(sockfd);
-            exit(EXIT_FAILURE);
+        if (unix_path) {
+            if (!unix_addr_init(unix_path, (struct sockaddr_un *) &server_addr, &server_addr_len)) {
+                fprintf(stderr, "소켓 경로가 너무 깁니다: %s\n", unix_path);
+                close(sockfd);
+                exit(EXIT_FAILURE);
+            }
+        } else {
+            struct sockaddr_in *in_addr = (struct sockaddr_in *) &server_addr;
+            in_addr->sin_family = AF_INET;
+            in_addr->sin_port = htons(SERVER_PORT);
+            if (inet_pton(AF_INET, SERVER_IP, &in_addr->sin_addr) <= 0) {
+                perror("inet_pton() 실패");
+                close(sockfd);
+                exit(EXIT_FAILURE);
+            }
+            server_addr_len = sizeof(*in_addr);
         }
 
         // 소켓을 논블로킹 모드로 설정
@@ -61,7 +319,7 @@ int main() {
     } while (!socket_create_ok);
 
     int retries = 0;
-    while (connect(sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
+    while (connect(sockfd, (struct sockaddr *)&server_addr, server_addr_len) == -1) {
 //        if (handle_connect_error()) {
 //            continue;
 //        }
@@ -96,14 +354,27 @@ int main() {
 
     printf("서버에 성공적으로 연결되었습니다.\n");
 
-    struct pollfd poll_fds[2];
+    ctx.sockfd = sockfd;
+    if (use_shm && !attach_shm(&ctx, &shm)) {
+        close(sockfd);
+        exit(EXIT_FAILURE);
+    }
+
+    // 링으로 옮겼으면 소켓은 서버가 닫는 것만 지켜보고, 응답은 링 쪽 eventfd 로 기다린다
+    struct pollfd poll_fds[3];
     poll_fds[0].fd = STDIN_FILENO;
     poll_fds[0].events = POLLIN;
     poll_fds[1].fd = sockfd;
-    poll_fds[1].events = POLLIN | POLLOUT;
+    poll_fds[1].events = ctx.attached ? POLLIN : POLLIN | POLLOUT;
+    poll_fds[2].fd = ctx.attached ? shm.wait_fd : -1;
+    poll_fds[2].events = POLLIN;
 
     while (1) {
-        int poll_count = poll(poll_fds, 2, TIMEOUT);
+        // 링에 와 있는 응답을 처리하고 잠든다고 표시한 뒤에 기다린다
+        if (ctx.attached && !receive_shm_frames(&ctx)) {
+            break;
+        }
+        int poll_count = poll(poll_fds, 3, TIMEOUT);
 
         if (poll_count == -1) {
             if (errno == EINTR) {
@@ -118,12 +389,25 @@ int main() {
 
         if (poll_fds[0].revents & POLLIN) {
             ssize_t bytes_read = read(STDIN_FILENO, buffer, BUFFER_SIZE);
-            if (bytes_read > 0) {
+            if (bytes_read > 0 && framed) {
+                if (bytes_read == 5 && memcmp(buffer, "ping\n", 5) == 0) {
+                    send_frame(&ctx, FRAME_TYPE_PING, NULL, 0);
+                } else if (bytes_read > 5 && memcmp(buffer, "get ", 4) == 0 && buffer[bytes_read - 1] == '\n') {
+                    // 받은 파일은 크기만 출력한다 (수신 버퍼보다 큰 파일은 받지 못한다)
+                    send_frame(&ctx, FRAME_TYPE_GET, buffer + 4, (size_t) bytes_read - 5);
+                } else {
+                    send_frame(&ctx, FRAME_TYPE_ECHO, buffer, (size_t) bytes_read);
+                }
+            } else if (bytes_read > 0) {
                 send(sockfd, buffer, bytes_read, 0);
             }
         }
 
-        if (poll_fds[1].revents & POLLIN) {
+        if ((poll_fds[1].revents & POLLIN) && framed) {
+            if (!receive_frames(&ctx)) {
+                break;
+            }
+        } else if (poll_fds[1].revents & POLLIN) {
             ssize_t bytes_received = recv(sockfd, buffer, BUFFER_SIZE - 1, 0);
             if (bytes_received > 0) {
                 buffer[bytes_received] = '\0';
@@ -140,6 +424,9 @@ int main() {
         }
     }
 
+    if (ctx.shm) {
+        shm_channel_close(ctx.shm);
+    }
     close(sockfd);
     return 0;
 }
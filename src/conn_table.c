@@ -0,0 +1,124 @@
+#include "../include/conn_table.h"
+#include "../include/log.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define CHUNK_MASK (CONN_TABLE_CHUNK - 1)
+#define CHUNK_SHIFT __builtin_ctz(CONN_TABLE_CHUNK)
+#define FREE_NONE UINT32_MAX
+
+// 세대는 슬롯을 잡을 때와 놓을 때 한 번씩 올린다. 홀수면 사용 중이다.
+struct conn_table_chunk {
+    uint32_t generation[CONN_TABLE_CHUNK];
+    char slots[] __attribute__((aligned(64)));
+};
+
+void conn_table_init(struct conn_table *table, size_t elem_size, size_t max_entries) {
+    memset(table, 0, sizeof(*table));
+    // 해제된 슬롯에는 다음 free 인덱스를 넣어 두므로 최소 4바이트
+    if (elem_size < sizeof(uint32_t)) {
+        elem_size = sizeof(uint32_t);
+    }
+    table->slot_size = (elem_size + 7) & ~(size_t) 7;
+    table->max_entries = max_entries;
+    table->free_head = FREE_NONE;
+}
+
+void conn_table_destroy(struct conn_table *table) {
+    for (size_t i = 0; i < table->chunk_count; i++) {
+        free(table->chunks[i]);
+    }
+    free(table->chunks);
+    table->chunks = NULL;
+    table->chunk_count = 0;
+    table->chunk_capacity = 0;
+    table->count = 0;
+    table->free_head = FREE_NONE;
+    table->next_unused = 0;
+}
+
+static inline char *slot_ptr(const struct conn_table *table, uint32_t index) {
+    return table->chunks[index >> CHUNK_SHIFT]->slots + (size_t) (index & CHUNK_MASK) * table->slot_size;
+}
+
+static inline uint32_t *generation_ptr(const struct conn_table *table, uint32_t index) {
+    return &table->chunks[index >> CHUNK_SHIFT]->generation[index & CHUNK_MASK];
+}
+
+// 청크 하나를 더 붙인다
+static int add_chunk(struct conn_table *table) {
+    if (table->chunk_count == table->chunk_capacity) {
+        size_t new_capacity = table->chunk_capacity ? table->chunk_capacity * 2 : 16;
+        struct conn_table_chunk **new_chunks = realloc(table->chunks, new_capacity * sizeof(*table->chunks));
+        if (!new_chunks) {
+            LOG_SYSERR("Memory allocation failed: connection table");
+            return 0;
+        }
+        table->chunks = new_chunks;
+        table->chunk_capacity = new_capacity;
+    }
+
+    size_t size = sizeof(struct conn_table_chunk) + CONN_TABLE_CHUNK * table->slot_size;
+    struct conn_table_chunk *chunk = (struct conn_table_chunk *) aligned_alloc(64, (size + 63) & ~(size_t) 63);
+    if (!chunk) {
+        LOG_SYSERR("Memory allocation failed: connection table");
+        return 0;
+    }
+    memset(chunk->generation, 0, sizeof(chunk->generation));
+    table->chunks[table->chunk_count++] = chunk;
+    return 1;
+}
+
+void *conn_table_alloc(struct conn_table *table, uint64_t *handle) {
+    if (table->max_entries != 0 && table->count >= table->max_entries) {
+        return NULL;
+    }
+
+    uint32_t index;
+    if (table->free_head != FREE_NONE) {
+        index = table->free_head;
+        memcpy(&table->free_head, slot_ptr(table, index), sizeof(uint32_t));
+    } else {
+        if (table->next_unused == FREE_NONE) {
+            return NULL; // 인덱스 공간을 다 씀
+        }
+        if ((table->next_unused >> CHUNK_SHIFT) == table->chunk_count && !add_chunk(table)) {
+            return NULL;
+        }
+        index = table->next_unused++;
+    }
+
+    uint32_t *generation = generation_ptr(table, index);
+    (*generation)++;
+    table->count++;
+
+    char *slot = slot_ptr(table, index);
+    memset(slot, 0, table->slot_size);
+    *handle = ((uint64_t) *generation << 32) | index;
+    return slot;
+}
+
+void *conn_table_get(const struct conn_table *table, uint64_t handle) {
+    uint32_t index = conn_handle_index(handle);
+    if (index >= table->next_unused || *generation_ptr(table, index) != (uint32_t) (handle >> 32)) {
+        return NULL;
+    }
+    return slot_ptr(table, index);
+}
+
+void *conn_table_at(const struct conn_table *table, uint32_t index) {
+    return slot_ptr(table, index);
+}
+
+void conn_table_free(struct conn_table *table, uint64_t handle) {
+    uint32_t index = conn_handle_index(handle);
+    uint32_t *generation = generation_ptr(table, index);
+    if (*generation != (uint32_t) (handle >> 32)) {
+        return; // 이미 해제됨
+    }
+    (*generation)++;
+    table->count--;
+
+    memcpy(slot_ptr(table, index), &table->free_head, sizeof(uint32_t));
+    table->free_head = index;
+}
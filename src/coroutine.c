@@ -0,0 +1,85 @@
+#include "../include/coroutine.h"
+#include "../include/ring_buffer.h"
+#include "../include/err_handle.h"
+#include "../include/stats.h"
+#include <string.h>
+#include <sys/socket.h>
+
+int co_stream_read(struct co_stream *stream, char *buf, size_t len, uint32_t *done) {
+    struct ring_buffer *ra = stream->readahead;
+
+    while (*done < len) {
+        size_t need = len - *done;
+
+        // 앞서 넉넉히 받아 둔 데이터부터 꺼낸다
+        size_t buffered = ring_buffer_length(ra);
+        if (buffered > 0) {
+            size_t n = buffered < need ? buffered : need;
+            memcpy(buf + *done, ring_buffer_read_ptr(ra), n);
+            ring_buffer_consume(ra, n);
+            *done += (uint32_t) n;
+            continue;
+        }
+
+        // 큰 payload 는 목적지로 바로 받고, 헤더처럼 작은 읽기는 뒤따르는 데이터까지 readahead 에 받는다
+        ssize_t bytes;
+        if (need >= stream->read_size) {
+            bytes = recv(stream->fd, buf + *done, need, 0);
+            if (bytes > 0) {
+                *done += (uint32_t) bytes;
+            }
+        } else {
+            if (!ring_buffer_reserve(ra, stream->read_size)) {
+                return -1; // 메모리 부족
+            }
+            bytes = recv(stream->fd, ring_buffer_write_ptr(ra), ring_buffer_space(ra), 0);
+            if (bytes > 0) {
+                ring_buffer_commit(ra, (size_t) bytes);
+            }
+        }
+        stats_inc(stream->stats, STAT_RECV_CALLS);
+
+        if (bytes > 0) {
+            stats_add(stream->stats, STAT_RECV_BYTES, (uint64_t) bytes);
+        } else if (bytes == 0) {
+            return -1; // 상대가 닫았다
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            stats_inc(stream->stats, STAT_RECV_EAGAIN);
+            ring_buffer_shrink(ra, 0); // 기다리는 동안 빈 블록을 잡고 있지 않는다
+            return 0;
+        } else {
+            stats_inc(stream->stats, STAT_RECV_ERRORS);
+            if (!handle_receive_error()) {
+                return -1;
+            }
+            // 재시도
+        }
+    }
+
+    ring_buffer_shrink(ra, 0);
+    return 1;
+}
+
+int co_stream_write(struct co_stream *stream, const char *buf, size_t len, uint32_t *done) {
+    while (*done < len) {
+        ssize_t bytes = send(stream->fd, buf + *done, len - *done, MSG_NOSIGNAL);
+        stats_inc(stream->stats, STAT_SEND_CALLS);
+
+        if (bytes > 0) {
+            stats_add(stream->stats, STAT_SEND_BYTES, (uint64_t) bytes);
+            *done += (uint32_t) bytes;
+        } else if (bytes == 0) {
+            return -1;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            stats_inc(stream->stats, STAT_SEND_EAGAIN);
+            return 0;
+        } else {
+            stats_inc(stream->stats, STAT_SEND_ERRORS);
+            if (!handle_send_error()) {
+                return -1;
+            }
+            // 재시도
+        }
+    }
+    return 1;
+}
@@ -1,35 +1,36 @@
 #include "../include/err_handle.h"
+#include "../include/log.h"
 #include <errno.h>
 #include <stdio.h>
 
 int handle_socket_error() {
     switch (errno) {
         case EACCES:
-            perror("[Error] socket() failed: Permission denied");
+            LOG_SYSERR("socket() failed: Permission denied");
             return 0;
         case EAFNOSUPPORT:
-            perror("[Error] socket() failed: Address family not supported");
+            LOG_SYSERR("socket() failed: Address family not supported");
             return 0;
         case EINVAL:
-            perror("[Error] socket() failed: Invalid domain or type");
+            LOG_SYSERR("socket() failed: Invalid domain or type");
             return 0;
         case EMFILE:
-            perror("[Error] socket() failed: Process file descriptor limit reached");
+            LOG_SYSERR("socket() failed: Process file descriptor limit reached");
             return 0;
         case ENFILE:
-            perror("[Error] socket() failed: System file descriptor limit reached");
+            LOG_SYSERR("socket() failed: System file descriptor limit reached");
             return 0;
         case ENOBUFS:
-            perror("[Error] socket() failed: Insufficient buffer space available");
+            LOG_SYSERR("socket() failed: Insufficient buffer space available");
             return 1; // retry
         case ENOMEM:
-            perror("[Error] socket() failed: Not enough memory");
+            LOG_SYSERR("socket() failed: Not enough memory");
             return 1; // retry
         case EPROTONOSUPPORT:
-            perror("[Error] socket() failed: Protocol not supported");
+            LOG_SYSERR("socket() failed: Protocol not supported");
             return 1;
         default:
-            perror("[Error] socket() failed");
+            LOG_SYSERR("socket() failed");
             return 0;
     }
 }
@@ -37,37 +38,37 @@ int handle_socket_error() {
 int handle_setsockopt_error() {
     switch (errno) {
         case EBADF:
-            perror("[Error] setsockopt() failed: Invalid socket descriptor");
+            LOG_SYSERR("setsockopt() failed: Invalid socket descriptor");
             return 0;
         case EFAULT:
-            perror("[Error] setsockopt() failed: Invalid option value pointer");
+            LOG_SYSERR("setsockopt() failed: Invalid option value pointer");
             return 0;
         case EINVAL:
-            perror("[Error] setsockopt() failed: Invalid option length");
+            LOG_SYSERR("setsockopt() failed: Invalid option length");
             return 0;
         case ENOBUFS:
-            perror("[Error] setsockopt() failed: Insufficient buffer space available");
+            LOG_SYSERR("setsockopt() failed: Insufficient buffer space available");
             return 1; // retry
         case ENOMEM:
-            perror("[Error] setsockopt() failed: Not enough memory");
+            LOG_SYSERR("setsockopt() failed: Not enough memory");
             return 1; // retry
         case ENOPROTOOPT:
-            perror("[Error] setsockopt() failed: Protocol not available");
+            LOG_SYSERR("setsockopt() failed: Protocol not available");
             return 0;
         case ENOTSOCK:
-            perror("[Error] setsockopt() failed: Socket descriptor is not valid");
+            LOG_SYSERR("setsockopt() failed: Socket descriptor is not valid");
             return 0;
         case EDOM:
-            perror("[Error] setsockopt() failed: Invalid option name");
+            LOG_SYSERR("setsockopt() failed: Invalid option name");
             return 0;
         case EISCONN:
-            perror("[Error] setsockopt() failed: Socket is already connected");
+            LOG_SYSERR("setsockopt() failed: Socket is already connected");
             return 0;
         case EOPNOTSUPP:
-            perror("[Error] setsockopt() failed: Socket is not of type SOCK_STREAM");
+            LOG_SYSERR("setsockopt() failed: Socket is not of type SOCK_STREAM");
             return 0;
         default:
-            perror("[Error] setsockopt() failed");
+            LOG_SYSERR("setsockopt() failed");
             return 0;
     }
 }
@@ -75,46 +76,46 @@ int handle_setsockopt_error() {
 int handle_bind_error() {
     switch (errno) {
         case EACCES:
-            perror("[Error] bind() failed: Permission denied");
+            LOG_SYSERR("bind() failed: Permission denied");
             return 0;
         case EADDRINUSE:
-            perror("[Error] bind() failed: Address already in use");
+            LOG_SYSERR("bind() failed: Address already in use");
             return 1; // retry
         case EBADF:
-            perror("[Error] bind() failed: Invalid socket descriptor");
+            LOG_SYSERR("bind() failed: Invalid socket descriptor");
             return 0;
         case EINVAL:
-            perror("[Error] bind() failed: Invalid address length");
+            LOG_SYSERR("bind() failed: Invalid address length");
             return 0;
         case ENOTSOCK:
-            perror("[Error] bind() failed: Socket descriptor is not valid");
+            LOG_SYSERR("bind() failed: Socket descriptor is not valid");
             return 0;
         case EADDRNOTAVAIL:
-            perror("[Error] bind() failed: Address not available");
+            LOG_SYSERR("bind() failed: Address not available");
             return 0;
         case EFAULT:
-            perror("[Error] bind() failed: Invalid address pointer");
+            LOG_SYSERR("bind() failed: Invalid address pointer");
             return 0;
         case ELOOP:
-            perror("[Error] bind() failed: Too many symbolic links in resolving address");
+            LOG_SYSERR("bind() failed: Too many symbolic links in resolving address");
             return 0;
         case ENAMETOOLONG:
-            perror("[Error] bind() failed: Address too long");
+            LOG_SYSERR("bind() failed: Address too long");
             return 0;
         case ENOENT:
-            perror("[Error] bind() failed: Address does not exist");
+            LOG_SYSERR("bind() failed: Address does not exist");
             return 0;
         case ENOMEM:
-            perror("[Error] bind() failed: Not enough memory");
+            LOG_SYSERR("bind() failed: Not enough memory");
             return 1; // retry
         case ENOTDIR:
-            perror("[Error] bind() failed: Not a valid directory");
+            LOG_SYSERR("bind() failed: Not a valid directory");
             return 0;
         case EROFS:
-            perror("[Error] bind() failed: Read-only file system");
+            LOG_SYSERR("bind() failed: Read-only file system");
             return 0;
         default:
-            perror("[Error] bind() failed");
+            LOG_SYSERR("bind() failed");
             return 0;
     }
 }
@@ -122,22 +123,22 @@ int handle_bind_error() {
 int handle_listen_error() {
     switch (errno) {
         case EBADF:
-            perror("[Error] listen() failed: Invalid socket descriptor");
+            LOG_SYSERR("listen() failed: Invalid socket descriptor");
             return 0;
         case EDESTADDRREQ:
-            perror("[Error] listen() failed: Destination address required");
+            LOG_SYSERR("listen() failed: Destination address required");
             return 1; // retry
         case EINVAL:
-            perror("[Error] listen() failed: Socket is not bound");
+            LOG_SYSERR("listen() failed: Socket is not bound");
             return 0;
         case ENOTSOCK:
-            perror("[Error] listen() failed: Socket descriptor is not valid");
+            LOG_SYSERR("listen() failed: Socket descriptor is not valid");
             return 0;
         case EOPNOTSUPP:
-            perror("[Error] listen() failed: Socket is not of type SOCK_STREAM");
+            LOG_SYSERR("listen() failed: Socket is not of type SOCK_STREAM");
             return 0;
         default:
-            perror("[Error] listen() failed");
+            LOG_SYSERR("listen() failed");
             return 0;
     }
 }
@@ -145,19 +146,104 @@ int handle_listen_error() {
 int handle_poll_error() {
     switch (errno) {
         case EAGAIN:
-            printf("[Error] poll() failed: Temporary resource shortage, retrying...\n");
+            LOG_ERROR("poll() failed: Temporary resource shortage, retrying...");
             return 1; // retry
         case EFAULT:
-            perror("[Error] poll() failed: Invalid fds pointer");
+            LOG_SYSERR("poll() failed: Invalid fds pointer");
             return 0;
         case EINTR:
-            printf("[Warning] poll() interrupted by signal, retrying...\n");
+            LOG_WARN("poll() interrupted by signal, retrying...");
             return 1; // retry
         case EINVAL:
-            perror("[Error] poll() failed: Invalid nfds or timeout value");
+            LOG_SYSERR("poll() failed: Invalid nfds or timeout value");
             return 0;
         default:
-            perror("[Error] poll() failed");
+            LOG_SYSERR("poll() failed");
+            return 0;
+    }
+}
+
+int handle_epoll_error() {
+    switch (errno) {
+        case EBADF:
+            LOG_SYSERR("epoll failed: Invalid epoll or target descriptor");
+            return 0;
+        case EEXIST:
+            LOG_SYSERR("epoll_ctl() failed: Descriptor already registered");
+            return 0;
+        case EFAULT:
+            LOG_SYSERR("epoll_wait() failed: Invalid events pointer");
+            return 0;
+        case EINTR:
+            LOG_WARN("epoll_wait() interrupted by signal, retrying...");
+            return 1; // retry
+        case EINVAL:
+            LOG_SYSERR("epoll failed: Invalid descriptor or arguments");
+            return 0;
+        case EMFILE:
+            LOG_SYSERR("epoll_create1() failed: Process file descriptor limit reached");
+            return 0;
+        case ENFILE:
+            LOG_SYSERR("epoll_create1() failed: System file descriptor limit reached");
+            return 0;
+        case ENOENT:
+            LOG_SYSERR("epoll_ctl() failed: Descriptor not registered");
+            return 0;
+        case ENOMEM:
+            LOG_SYSERR("epoll failed: Not enough memory");
+            return 0;
+        case ENOSPC:
+            LOG_SYSERR("epoll_ctl() failed: max_user_watches limit reached");
+            return 0;
+        case EPERM:
+            LOG_SYSERR("epoll_ctl() failed: Target does not support epoll");
+            return 0;
+        default:
+            LOG_SYSERR("epoll failed");
+            return 0;
+    }
+}
+
+int handle_io_uring_error() {
+    switch (errno) {
+        case EAGAIN:
+            LOG_ERROR("io_uring failed: Temporary resource shortage, retrying...");
+            return 1; // retry
+        case EBADF:
+            LOG_SYSERR("io_uring failed: Invalid ring descriptor");
+            return 0;
+        case EBUSY:
+            LOG_WARN("io_uring_enter() failed: Completion queue overflowed, retrying...");
+            return 1; // retry
+        case EEXIST:
+            LOG_SYSERR("io_uring_register() failed: Buffer group already registered");
+            return 0;
+        case EFAULT:
+            LOG_SYSERR("io_uring failed: Invalid parameter pointer");
+            return 0;
+        case EINTR:
+            LOG_WARN("io_uring_enter() interrupted by signal, retrying...");
+            return 1; // retry
+        case EINVAL:
+            LOG_SYSERR("io_uring failed: Invalid flags or entries (kernel too old?)");
+            return 0;
+        case EMFILE:
+            LOG_SYSERR("io_uring_setup() failed: Process file descriptor limit reached");
+            return 0;
+        case ENFILE:
+            LOG_SYSERR("io_uring_setup() failed: System file descriptor limit reached");
+            return 0;
+        case ENOMEM:
+            LOG_SYSERR("io_uring failed: Not enough memory (RLIMIT_MEMLOCK?)");
+            return 0;
+        case ENOSYS:
+            LOG_SYSERR("io_uring failed: Not supported by this kernel");
+            return 0;
+        case EPERM:
+            LOG_SYSERR("io_uring failed: Permission denied (kernel.io_uring_disabled?)");
+            return 0;
+        default:
+            LOG_SYSERR("io_uring failed");
             return 0;
     }
 }
@@ -165,40 +251,40 @@ int handle_poll_error() {
 int handle_accept_error() {
     switch (errno) {
         case EBADF:
-            perror("[Error] accept() failed: Invalid socket descriptor");
+            LOG_SYSERR("accept() failed: Invalid socket descriptor");
             return 0;
         case ECONNABORTED:
-            printf("[Warning] accept() failed: Connection aborted, retrying...\n");
+            LOG_WARN("accept() failed: Connection aborted, retrying...");
             return 1; // retry
         case EFAULT:
-            perror("[Error] accept() failed: Invalid address pointer");
+            LOG_SYSERR("accept() failed: Invalid address pointer");
             return 0;
         case EINTR:
-            printf("[Warning] accept() interrupted by signal, retrying...\n");
+            LOG_WARN("accept() interrupted by signal, retrying...");
             return 1; // retry
         case EINVAL:
-            perror("[Error] accept() failed: Socket is not listening");
+            LOG_SYSERR("accept() failed: Socket is not listening");
             return 0;
         case EMFILE:
-            perror("[Error] accept() failed: Process file descriptor limit reached");
+            LOG_SYSERR("accept() failed: Process file descriptor limit reached");
             return 0;
         case ENFILE:
-            perror("[Error] accept() failed: System file descriptor limit reached");
+            LOG_SYSERR("accept() failed: System file descriptor limit reached");
             return 0;
         case ENOMEM:
-            perror("[Error] accept() failed: Not enough memory");
+            LOG_SYSERR("accept() failed: Not enough memory");
             return 0;
         case ENOTSOCK:
-            perror("[Error] accept() failed: Socket descriptor is not valid");
+            LOG_SYSERR("accept() failed: Socket descriptor is not valid");
             return 0;
         case EOPNOTSUPP:
-            perror("[Error] accept() failed: Socket is not of type SOCK_STREAM");
+            LOG_SYSERR("accept() failed: Socket is not of type SOCK_STREAM");
             return 0;
         case EWOULDBLOCK:
-            printf("[Error] accept() failed: No pending connections, retrying...\n");
+            LOG_ERROR("accept() failed: No pending connections, retrying...");
             return 1; // retry
         default:
-            perror("[Error] accept() failed");
+            LOG_SYSERR("accept() failed");
             return 0;
     }
 }
@@ -208,31 +294,31 @@ int handle_receive_error() {
         case EAGAIN: // EWOULDBLOCK
             return 1; // retry
         case EBADF:
-            perror("[Error] recv() failed: Invalid socket descriptor");
+            LOG_SYSERR("recv() failed: Invalid socket descriptor");
             return 0;
         case ECONNREFUSED:
-            printf("[Warning] recv() failed: Connection refused, closing...\n");
+            LOG_WARN("recv() failed: Connection refused, closing...");
             return 0;
         case EFAULT:
-            perror("[Error] recv() failed: Invalid buffer pointer");
+            LOG_SYSERR("recv() failed: Invalid buffer pointer");
             return 0;
         case EINTR:
-            printf("[Warning] recv() interrupted by signal, retrying...\n");
+            LOG_WARN("recv() interrupted by signal, retrying...");
             return 1; // retry
         case EINVAL:
-            perror("[Error] recv() failed: Invalid buffer length");
+            LOG_SYSERR("recv() failed: Invalid buffer length");
             return 0;
         case ENOMEM:
-            perror("[Error] recv() failed: Not enough memory");
+            LOG_SYSERR("recv() failed: Not enough memory");
             return 0;
         case ENOTCONN:
-            perror("[Error] recv() failed: Socket is not connected");
+            LOG_SYSERR("recv() failed: Socket is not connected");
             return 0;
         case ENOTSOCK:
-            perror("[Error] recv() failed: Socket descriptor is not valid");
+            LOG_SYSERR("recv() failed: Socket descriptor is not valid");
             return 0;
         default:
-            perror("[Error] recv() failed");
+            LOG_SYSERR("recv() failed");
             return 0;
     }
 }
@@ -240,57 +326,88 @@ int handle_receive_error() {
 int handle_send_error() {
     switch (errno) {
         case EACCES:
-            perror("[Error] send() failed: Permission denied");
+            LOG_SYSERR("send() failed: Permission denied");
             return 0;
         case EAGAIN: // EWOULDBLOCK
             return 1; // retry
         case EALREADY:
-            perror("[Error] send() failed: Operation already in progress");
+            LOG_SYSERR("send() failed: Operation already in progress");
             return 0;
         case EBADF:
-            perror("[Error] send() failed: Invalid socket descriptor");
+            LOG_SYSERR("send() failed: Invalid socket descriptor");
             return 0;
         case ECONNRESET:
-            perror("[Error] send() failed: Connection reset by peer");
+            LOG_SYSERR("send() failed: Connection reset by peer");
             return 0;
         case EDESTADDRREQ:
-            perror("[Error] send() failed: Destination address required");
+            LOG_SYSERR("send() failed: Destination address required");
             return 0;
         case EFAULT:
-            perror("[Error] send() failed: Invalid buffer pointer");
+            LOG_SYSERR("send() failed: Invalid buffer pointer");
             return 0;
         case EINTR:
-            printf("[Warning] send() interrupted by signal, retrying...\n");
+            LOG_WARN("send() interrupted by signal, retrying...");
             return 1; // retry
         case EINVAL:
-            perror("[Error] send() failed: Invalid buffer length");
+            LOG_SYSERR("send() failed: Invalid buffer length");
             return 0;
         case EISCONN:
-            perror("[Error] send() failed: Socket is already connected");
+            LOG_SYSERR("send() failed: Socket is already connected");
             return 0;
         case EMSGSIZE:
-            perror("[Error] send() failed: Message too long");
+            LOG_SYSERR("send() failed: Message too long");
             return 0;
         case ENOBUFS:
-            perror("[Error] send() failed: Insufficient buffer space available");
+            LOG_SYSERR("send() failed: Insufficient buffer space available");
             return 1; // retry
         case ENOMEM:
-            perror("[Error] send() failed: Not enough memory");
+            LOG_SYSERR("send() failed: Not enough memory");
             return 0;
         case ENOTCONN:
-            perror("[Error] send() failed: Socket is not connected");
+            LOG_SYSERR("send() failed: Socket is not connected");
             return 0;
         case ENOTSOCK:
-            perror("[Error] send() failed: Socket descriptor is not valid");
+            LOG_SYSERR("send() failed: Socket descriptor is not valid");
             return 0;
         case EOPNOTSUPP:
-            perror("[Error] send() failed: Operation not supported on socket");
+            LOG_SYSERR("send() failed: Operation not supported on socket");
+            return 0;
+        case EPIPE:
+            LOG_SYSERR("send() failed: Broken pipe");
+            return 0;
+        default:
+            LOG_SYSERR("send() failed");
+            return 0;
+    }
+}
+
+int handle_splice_error() {
+    switch (errno) {
+        case EAGAIN: // EWOULDBLOCK
+            return 1; // retry
+        case EBADF:
+            LOG_SYSERR("splice() failed: Invalid descriptor");
+            return 0;
+        case ECONNRESET:
+            LOG_SYSERR("splice() failed: Connection reset by peer");
+            return 0;
+        case EINTR:
+            LOG_WARN("splice() interrupted by signal, retrying...");
+            return 1; // retry
+        case EINVAL:
+            LOG_SYSERR("splice() failed: Descriptor does not support splicing");
+            return 0;
+        case ENOMEM:
+            LOG_SYSERR("splice() failed: Not enough memory");
             return 0;
         case EPIPE:
-            perror("[Error] send() failed: Broken pipe");
+            LOG_SYSERR("splice() failed: Broken pipe");
+            return 0;
+        case ESPIPE:
+            LOG_SYSERR("splice() failed: Offset given for a pipe or socket");
             return 0;
         default:
-            perror("[Error] send() failed");
+            LOG_SYSERR("splice() failed");
             return 0;
     }
 }
@@ -298,52 +415,137 @@ int handle_send_error() {
 int handle_connect_error() {
     switch (errno) {
         case EACCES:
-            perror("[Error] connect() failed: Permission denied");
+            LOG_SYSERR("connect() failed: Permission denied");
             return 0;
         case EADDRINUSE:
-            perror("[Error] connect() failed: Address already in use");
+            LOG_SYSERR("connect() failed: Address already in use");
             return 0;
         case EADDRNOTAVAIL:
-            perror("[Error] connect() failed: Address not available");
+            LOG_SYSERR("connect() failed: Address not available");
             return 0;
         case EAFNOSUPPORT:
-            perror("[Error] connect() failed: Address family not supported");
+            LOG_SYSERR("connect() failed: Address family not supported");
             return 0;
         case EALREADY:
-            perror("[Error] connect() failed: Operation already in progress");
+            LOG_SYSERR("connect() failed: Operation already in progress");
             return 0;
         case EBADF:
-            perror("[Error] connect() failed: Invalid socket descriptor");
+            LOG_SYSERR("connect() failed: Invalid socket descriptor");
             return 0;
         case ECONNREFUSED:
-            perror("[Error] connect() failed: Connection refused");
+            LOG_SYSERR("connect() failed: Connection refused");
             return 0;
         case EFAULT:
-            perror("[Error] connect() failed: Invalid address pointer");
+            LOG_SYSERR("connect() failed: Invalid address pointer");
             return 0;
         case EINPROGRESS:
-            perror("[Error] connect() failed: Operation in progress");
+            LOG_SYSERR("connect() failed: Operation in progress");
             return 1; // retry
         case EINTR:
-            perror("[Error] connect() failed: Interrupted by signal");
+            LOG_SYSERR("connect() failed: Interrupted by signal");
             return 0;
         case EISCONN:
-            perror("[Error] connect() failed: Socket is already connected");
+            LOG_SYSERR("connect() failed: Socket is already connected");
             return 0;
         case ENETUNREACH:
-            perror("[Error] connect() failed: Network is unreachable");
+            LOG_SYSERR("connect() failed: Network is unreachable");
             return 0;
         case ENOTSOCK:
-            perror("[Error] connect() failed: Socket descriptor is not valid");
+            LOG_SYSERR("connect() failed: Socket descriptor is not valid");
             return 0;
         case EPROTOTYPE:
-            perror("[Error] connect() failed: Protocol type not supported");
+            LOG_SYSERR("connect() failed: Protocol type not supported");
             return 0;
         case ETIMEDOUT:
-            perror("[Error] connect() failed: Connection timed out");
+            LOG_SYSERR("connect() failed: Connection timed out");
+            return 0;
+        default:
+            LOG_SYSERR("connect() failed");
+            return 0;
+    }
+}
+// 비연결 소켓이라 상대마다 생길 수 있는 오류는 debug 로만 남기고 계속한다
+int handle_recvmmsg_error() {
+    switch (errno) {
+        case EAGAIN: // EWOULDBLOCK
+            return 1; // retry
+        case EBADF:
+            LOG_SYSERR("recvmmsg() failed: Invalid socket descriptor");
+            return 0;
+        case ECONNREFUSED:
+            LOG_DEBUG("recvmmsg() failed: Connection refused by peer (ICMP)");
+            return 1;
+        case EFAULT:
+            LOG_SYSERR("recvmmsg() failed: Invalid buffer pointer");
+            return 0;
+        case EHOSTUNREACH:
+        case ENETUNREACH:
+            LOG_DEBUG("recvmmsg() failed: Peer unreachable (ICMP)");
+            return 1;
+        case EINTR:
+            LOG_WARN("recvmmsg() interrupted by signal, retrying...");
+            return 1; // retry
+        case EINVAL:
+            LOG_SYSERR("recvmmsg() failed: Invalid argument");
+            return 0;
+        case ENOMEM:
+            LOG_SYSERR("recvmmsg() failed: Not enough memory");
+            return 1; // retry
+        case ENOTSOCK:
+            LOG_SYSERR("recvmmsg() failed: Socket descriptor is not valid");
+            return 0;
+        default:
+            LOG_SYSERR("recvmmsg() failed");
+            return 0;
+    }
+}
+
+int handle_sendmmsg_error() {
+    switch (errno) {
+        case EAGAIN: // EWOULDBLOCK
+            return 1; // retry
+        case EBADF:
+            LOG_SYSERR("sendmmsg() failed: Invalid socket descriptor");
+            return 0;
+        case ECONNREFUSED:
+            LOG_DEBUG("sendmmsg() failed: Connection refused by peer (ICMP)");
+            return 1;
+        case EDESTADDRREQ:
+            LOG_SYSERR("sendmmsg() failed: Destination address required");
+            return 0;
+        case EFAULT:
+            LOG_SYSERR("sendmmsg() failed: Invalid buffer pointer");
+            return 0;
+        case EHOSTUNREACH:
+        case ENETUNREACH:
+            LOG_DEBUG("sendmmsg() failed: Peer unreachable");
+            return 1;
+        case EINTR:
+            LOG_WARN("sendmmsg() interrupted by signal, retrying...");
+            return 1; // retry
+        case EINVAL:
+            LOG_SYSERR("sendmmsg() failed: Invalid message or segment size");
+            return 0;
+        case EIO:
+            LOG_SYSERR("sendmmsg() failed: Segmentation offload not supported by device");
+            return 0;
+        case EMSGSIZE:
+            LOG_DEBUG("sendmmsg() failed: Datagram too long");
+            return 1;
+        case ENOBUFS:
+            LOG_DEBUG("sendmmsg() failed: Insufficient buffer space available");
+            return 1; // retry
+        case ENOMEM:
+            LOG_SYSERR("sendmmsg() failed: Not enough memory");
+            return 1; // retry
+        case ENOTSOCK:
+            LOG_SYSERR("sendmmsg() failed: Socket descriptor is not valid");
             return 0;
+        case EPERM:
+            LOG_DEBUG("sendmmsg() failed: Blocked by firewall rule");
+            return 1;
         default:
-            perror("[Error] connect() failed");
+            LOG_SYSERR("sendmmsg() failed");
             return 0;
     }
-}
\ No newline at end of file
+}
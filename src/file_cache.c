@@ -0,0 +1,233 @@
+#define _GNU_SOURCE
+#include "../include/file_cache.h"
+#include "../include/log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#ifdef SYS_openat2
+#include <linux/openat2.h>
+#endif
+
+#define FILE_CACHE_BUCKETS 1024
+
+// FNV-1a
+static size_t name_hash(const char *name, size_t len) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char) name[i];
+        hash *= 1099511628211ULL;
+    }
+    return (size_t) hash;
+}
+
+int file_cache_init(struct file_cache *cache, int root_fd, size_t limit) {
+    memset(cache, 0, sizeof(*cache));
+    cache->buckets = (struct file_entry **) calloc(FILE_CACHE_BUCKETS, sizeof(struct file_entry *));
+    if (!cache->buckets) {
+        LOG_SYSERR("Memory allocation failed: file cache");
+        return 0;
+    }
+    cache->bucket_count = FILE_CACHE_BUCKETS;
+    cache->root_fd = root_fd;
+    cache->limit = limit;
+    return 1;
+}
+
+void file_entry_unref(struct file_entry *entry) {
+    if (--entry->refs > 0) {
+        return;
+    }
+    if (entry->data) {
+        munmap((void *) entry->data, entry->size);
+    }
+    close(entry->fd);
+    free(entry);
+}
+
+static void lru_unlink(struct file_cache *cache, struct file_entry *entry) {
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        cache->lru_head = entry->lru_next;
+    }
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        cache->lru_tail = entry->lru_prev;
+    }
+    entry->lru_prev = NULL;
+    entry->lru_next = NULL;
+}
+
+static void lru_push_front(struct file_cache *cache, struct file_entry *entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head) {
+        cache->lru_head->lru_prev = entry;
+    } else {
+        cache->lru_tail = entry;
+    }
+    cache->lru_head = entry;
+}
+
+// 캐시에서 빼고 캐시가 든 참조를 놓는다
+static void cache_remove(struct file_cache *cache, struct file_entry *entry) {
+    struct file_entry **link = &cache->buckets[name_hash(entry->name, entry->name_len) & (cache->bucket_count - 1)];
+    while (*link != entry) {
+        link = &(*link)->hash_next;
+    }
+    *link = entry->hash_next;
+    lru_unlink(cache, entry);
+    cache->bytes -= entry->size;
+    cache->count--;
+    entry->cached = 0;
+    file_entry_unref(entry);
+}
+
+void file_cache_destroy(struct file_cache *cache) {
+    while (cache->lru_tail) {
+        cache_remove(cache, cache->lru_tail);
+    }
+    free(cache->buckets);
+    cache->buckets = NULL;
+}
+
+// 절대 경로, 빈 이름, ".." 이 든 이름은 받지 않는다. openat2() 가 있으면 심볼릭 링크로 빠져나가는 것도 막는다.
+static int name_is_safe(const char *name, size_t len) {
+    if (len == 0 || len > FILE_CACHE_MAX_NAME || name[0] == '/' || memchr(name, '\0', len)) {
+        return 0;
+    }
+    for (size_t start = 0; start < len; ) {
+        const char *slash = memchr(name + start, '/', len - start);
+        size_t end = slash ? (size_t) (slash - name) : len;
+        if (end - start == 2 && name[start] == '.' && name[start + 1] == '.') {
+            return 0;
+        }
+        start = end + 1;
+    }
+    return 1;
+}
+
+static int open_beneath(int root_fd, const char *path) {
+#ifdef SYS_openat2
+    struct open_how how = {0};
+    how.flags = O_RDONLY | O_CLOEXEC;
+    how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+    int fd = (int) syscall(SYS_openat2, root_fd, path, &how, sizeof(how));
+    if (fd >= 0 || errno != ENOSYS) {
+        return fd;
+    }
+#endif
+    return openat(root_fd, path, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+}
+
+// 열어서 매핑한 새 항목. 참조는 1 (호출자 몫) 이다.
+static struct file_entry *load_entry(struct file_cache *cache, const char *name, size_t name_len, uint64_t now_ms) {
+    char path[FILE_CACHE_MAX_NAME + 1];
+    memcpy(path, name, name_len);
+    path[name_len] = '\0';
+
+    int fd = open_beneath(cache->root_fd, path);
+    if (fd == -1) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return NULL;
+    }
+
+    struct file_entry *entry = (struct file_entry *) calloc(1, sizeof(struct file_entry));
+    if (!entry) {
+        LOG_SYSERR("Memory allocation failed: file entry");
+        close(fd);
+        return NULL;
+    }
+    entry->refs = 1;
+    entry->fd = fd;
+    entry->size = (size_t) st.st_size;
+    entry->ino = st.st_ino;
+    entry->mtime = st.st_mtim;
+    entry->checked_ms = now_ms;
+    entry->name_len = (uint8_t) name_len;
+    memcpy(entry->name, name, name_len);
+
+    if (entry->size > 0) {
+        void *data = mmap(NULL, entry->size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            LOG_SYSWARN("mmap() of a served file failed");
+            close(fd);
+            free(entry);
+            return NULL;
+        }
+        entry->data = (const char *) data;
+    }
+    return entry;
+}
+
+// 캐시한 뒤로 파일이 바뀌었거나 (rename 으로 갈아 끼웠거나) 사라졌는지
+static int entry_is_stale(struct file_cache *cache, struct file_entry *entry, uint64_t now_ms) {
+    if (now_ms - entry->checked_ms < FILE_CACHE_REVALIDATE_MS) {
+        return 0;
+    }
+    entry->checked_ms = now_ms;
+
+    char path[FILE_CACHE_MAX_NAME + 1];
+    memcpy(path, entry->name, entry->name_len);
+    path[entry->name_len] = '\0';
+    struct stat st;
+    if (fstatat(cache->root_fd, path, &st, AT_SYMLINK_NOFOLLOW) == -1) {
+        return 1;
+    }
+    return st.st_ino != entry->ino || (size_t) st.st_size != entry->size ||
+           st.st_mtim.tv_sec != entry->mtime.tv_sec || st.st_mtim.tv_nsec != entry->mtime.tv_nsec;
+}
+
+struct file_entry *file_cache_open(struct file_cache *cache, const char *name, size_t name_len, uint64_t now_ms,
+                                   int *hit) {
+    *hit = 0;
+    if (!name_is_safe(name, name_len)) {
+        return NULL;
+    }
+
+    struct file_entry **bucket = &cache->buckets[name_hash(name, name_len) & (cache->bucket_count - 1)];
+    for (struct file_entry *entry = *bucket; entry; entry = entry->hash_next) {
+        if (entry->name_len != name_len || memcmp(entry->name, name, name_len) != 0) {
+            continue;
+        }
+        if (entry_is_stale(cache, entry, now_ms)) {
+            cache_remove(cache, entry); // 보내는 중인 연결은 이전 내용을 끝까지 보낸다
+            break;
+        }
+        lru_unlink(cache, entry);
+        lru_push_front(cache, entry);
+        entry->refs++;
+        *hit = 1;
+        return entry;
+    }
+
+    struct file_entry *entry = load_entry(cache, name, name_len, now_ms);
+    if (!entry || entry->size > cache->limit) {
+        return entry; // 캐시보다 큰 파일은 이번 요청만 매핑한다
+    }
+
+    while (cache->bytes + entry->size > cache->limit) {
+        cache_remove(cache, cache->lru_tail);
+    }
+    if (entry->data) {
+        madvise((void *) entry->data, entry->size, MADV_WILLNEED); // 자주 받아 갈 파일이니 미리 읽어 둔다
+    }
+    entry->refs++;
+    entry->cached = 1;
+    entry->hash_next = *bucket;
+    *bucket = entry;
+    lru_push_front(cache, entry);
+    cache->bytes += entry->size;
+    cache->count++;
+    return entry;
+}
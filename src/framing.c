@@ -0,0 +1,51 @@
+#include "../include/framing.h"
+#include "../include/log.h"
+#include <string.h>
+
+void frame_dispatcher_init(struct frame_dispatcher *dispatcher, size_t max_payload) {
+    memset(dispatcher->handlers, 0, sizeof(dispatcher->handlers));
+    dispatcher->max_payload = max_payload;
+}
+
+void frame_register(struct frame_dispatcher *dispatcher, uint8_t type, frame_handler handler) {
+    dispatcher->handlers[type] = handler;
+}
+
+ssize_t frame_dispatch(const struct frame_dispatcher *dispatcher, void *ctx, const char *data, size_t len,
+                       size_t *need) {
+    size_t offset = 0;
+    *need = 0;
+
+    // 한 번 읽은 데이터 안의 완성된 프레임은 한꺼번에 처리한다
+    while (len - offset >= FRAME_HEADER_SIZE) {
+        const char *header = data + offset;
+        uint32_t payload_len = frame_decode_length(header);
+        uint8_t type = (uint8_t) header[4];
+
+        if (payload_len > dispatcher->max_payload) {
+            LOG_DEBUG("Frame too large: %lld bytes (type %lld)", payload_len, type);
+            return -1;
+        }
+        size_t frame_len = FRAME_HEADER_SIZE + (size_t) payload_len;
+        if (len - offset < frame_len) {
+            *need = frame_len - (len - offset);
+            break;
+        }
+
+        frame_handler handler = dispatcher->handlers[type];
+        if (!handler) {
+            LOG_DEBUG("Unknown frame type: %lld", type);
+            return -1;
+        }
+        struct frame frame = {type, payload_len, header + FRAME_HEADER_SIZE};
+        if (!handler(ctx, &frame)) {
+            return -1;
+        }
+        offset += frame_len;
+    }
+
+    if (*need == 0 && len > offset) {
+        *need = FRAME_HEADER_SIZE - (len - offset); // 헤더도 다 오지 않음
+    }
+    return (ssize_t) offset;
+}
@@ -0,0 +1,95 @@
+#include "../include/histogram.h"
+#include <string.h>
+
+#define HALF_SUB (HISTOGRAM_SUB_COUNT / 2)
+
+static int bucket_index(uint64_t value) {
+    if (value < HISTOGRAM_SUB_COUNT) {
+        return (int) value;
+    }
+    // value 의 최상위 비트가 msb 이면 하위 (msb - SUB_BITS + 1) 비트를 버린다
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - HISTOGRAM_SUB_BITS + 1;
+    return shift * HALF_SUB + (int) (value >> shift);
+}
+
+// 버킷에 들어가는 가장 작은 값
+static uint64_t bucket_lower(int index) {
+    if (index < HISTOGRAM_SUB_COUNT) {
+        return (uint64_t) index;
+    }
+    int shift = index / HALF_SUB - 1;
+    uint64_t sub = (uint64_t) (index - shift * HALF_SUB);
+    return sub << shift;
+}
+
+void histogram_init(struct histogram *h) {
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+void histogram_record(struct histogram *h, uint64_t value) {
+    h->counts[bucket_index(value)]++;
+    h->total++;
+    h->sum += value;
+    if (value < h->min) {
+        h->min = value;
+    }
+    if (value > h->max) {
+        h->max = value;
+    }
+}
+
+void histogram_merge(struct histogram *dst, const struct histogram *src) {
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        dst->counts[i] += src->counts[i];
+    }
+    dst->total += src->total;
+    dst->sum += src->sum;
+    if (src->min < dst->min) {
+        dst->min = src->min;
+    }
+    if (src->max > dst->max) {
+        dst->max = src->max;
+    }
+}
+
+uint64_t histogram_percentile(const struct histogram *h, double percentile) {
+    if (h->total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t) (percentile / 100.0 * (double) h->total + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t upper = i + 1 < HISTOGRAM_BUCKETS ? bucket_lower(i + 1) - 1 : UINT64_MAX;
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+double histogram_mean(const struct histogram *h) {
+    return h->total ? (double) h->sum / (double) h->total : 0.0;
+}
+
+void histogram_print_ns(FILE *out, const char *label, const struct histogram *h) {
+    if (h->total == 0) {
+        fprintf(out, "%s: no samples\n", label);
+        return;
+    }
+    fprintf(out, "%s (us): n=%llu min=%.1f mean=%.1f p50=%.1f p90=%.1f p99=%.1f p99.9=%.1f max=%.1f\n",
+            label, (unsigned long long) h->total,
+            h->min / 1000.0, histogram_mean(h) / 1000.0,
+            histogram_percentile(h, 50.0) / 1000.0,
+            histogram_percentile(h, 90.0) / 1000.0,
+            histogram_percentile(h, 99.0) / 1000.0,
+            histogram_percentile(h, 99.9) / 1000.0,
+            h->max / 1000.0);
+}
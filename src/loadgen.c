@@ -0,0 +1,1161 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netinet/udp.h>
+#include "../include/err_handle.h"
+#include "../include/histogram.h"
+#include "../include/unix_addr.h"
+
+#define SERVER_IP "127.0.0.1"  // 서버 주소
+#define SERVER_PORT 12345       // 서버 포트
+#define BUFFER_SIZE (64 * 1024)
+#define PATTERN_SIZE (64 * 1024) // 메시지 내용은 이 크기의 패턴을 반복한다
+#define MAX_EVENTS 256
+#define MAX_THREADS 256
+#define DRAIN_TIMEOUT_NS (2 * 1000000000ULL) // 종료 후 응답을 기다리는 시간
+#define UDP_MAX_DATAGRAM 65507
+#define UDP_RX_BATCH 64
+#define UDP_TX_BATCH 64
+#define UDP_MAX_SEGMENTS 64                      // 커널이 UDP_SEGMENT 한 번에 허용하는 datagram 수
+#define UDP_LOSS_TIMEOUT_NS (200 * 1000000ULL)  // closed-loop 에서 이만큼 응답이 없으면 보낸 것을 손실로 친다
+#define UDP_LOSS_CHECK_NS (50 * 1000000ULL)
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+// 에코 서버는 바이트를 순서대로 돌려주므로, 연결마다 보낸 바이트 위치(stream offset)로
+// 메시지 경계와 기대값을 계산한다. 메시지마다 헤더를 붙이지 않는다.
+struct lg_msg {
+    uint64_t end_offset; // 이 메시지의 마지막 바이트 다음 위치
+    uint64_t start_ns;   // open-loop 에서는 의도한 전송 시각 (coordinated omission 보정)
+};
+
+struct lg_conn {
+    int fd;
+    int id;
+    int connected;
+    int closed;
+    uint32_t phase;       // 연결마다 패턴 시작 위치를 다르게 해서 뒤섞인 바이트를 잡는다
+    uint64_t tx_offset;   // send() 로 넘긴 바이트
+    uint64_t tx_target;   // 보내려고 쌓아둔 바이트
+    uint64_t rx_offset;   // 받은 바이트
+    struct lg_msg *msgs;  // 응답을 기다리는 메시지 (FIFO)
+    uint32_t msg_head;
+    uint32_t msg_count;
+    uint32_t msg_capacity;
+    int want_write;
+    // UDP 모드. datagram 마다 헤더가 붙으므로 stream offset 대신 순번으로 확인한다.
+    uint64_t next_seq;
+    uint64_t lost_below;  // 이보다 앞선 datagram 은 손실로 처리했다 (늦게 와도 세지 않는다)
+    uint32_t inflight;
+    uint64_t progress_ns; // 마지막으로 응답을 받은 시각
+};
+
+// UDP datagram 앞에 붙이는 헤더. 나머지는 순번 위치의 패턴이다.
+struct lg_dgram_header {
+    uint64_t seq;
+    uint64_t start_ns;
+};
+
+union lg_udp_control {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+};
+
+// 스레드마다 recvmmsg()/sendmmsg() 에 쓰는 배열
+struct lg_udp {
+    struct mmsghdr rx[UDP_RX_BATCH];
+    struct iovec rx_iov[UDP_RX_BATCH];
+    union lg_udp_control rx_control[UDP_RX_BATCH];
+    char *rx_buffer;
+    struct mmsghdr tx[UDP_TX_BATCH];
+    struct iovec tx_iov[UDP_TX_BATCH];
+    union lg_udp_control tx_control[UDP_TX_BATCH];
+    int tx_segments[UDP_TX_BATCH];
+    char *tx_buffer;
+    int train; // GSO 한 번에 보내는 datagram 수
+};
+
+struct lg_config {
+    const char *host;
+    int port;
+    int connections;
+    int threads;
+    int duration;         // 초
+    size_t min_size;
+    size_t max_size;
+    int depth;            // closed-loop 에서 연결당 동시에 보내 둘 메시지 수
+    double rate;          // 초당 메시지 수 (0 이면 closed-loop)
+    int nodelay;
+    const char *json_path; // 결과를 JSON 으로도 쓸 파일 (NULL 이면 안 씀, "-" 는 stdout)
+    const char *unix_path; // TCP 대신 서버의 AF_UNIX 리스너에 붙는다 (NULL 이면 TCP)
+    int udp;              // 연결마다 connect() 한 UDP 소켓으로 datagram 을 주고받는다
+    int gso;              // UDP_SEGMENT 로 한 번에 보내는 datagram 수 (0 = 끔). 켜면 UDP_GRO 로 받는다
+};
+
+struct lg_thread {
+    pthread_t thread;
+    int id;
+    int first_conn;
+    int conn_count;
+    struct lg_conn *conns;
+    int epoll_fd;
+    uint64_t rng;
+    struct histogram latency;
+    // 진행 상황. 메인 스레드가 relaxed 로 읽는다.
+    uint64_t msgs_sent;
+    uint64_t msgs_done;
+    uint64_t bytes_rx;
+    uint64_t connect_errors;
+    uint64_t io_errors;
+    uint64_t verify_errors;
+    int connected;
+    struct lg_udp *udp; // UDP 모드에서만
+};
+
+static struct lg_config config = {
+    .host = SERVER_IP,
+    .port = SERVER_PORT,
+    .connections = 100,
+    .threads = 1,
+    .duration = 10,
+    .min_size = 64,
+    .max_size = 64,
+    .depth = 1,
+    .rate = 0,
+    .nodelay = 1,
+    .json_path = NULL,
+    .unix_path = NULL,
+    .udp = 0,
+    .gso = 0,
+};
+
+static char pattern[PATTERN_SIZE * 2];
+static volatile int running = 1;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static uint64_t xorshift64(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+static void init_pattern(void) {
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    for (int i = 0; i < PATTERN_SIZE; i++) {
+        pattern[i] = (char) (xorshift64(&state) & 0xff);
+    }
+    // 뒤쪽 절반을 복사해 두면 PATTERN_SIZE 이하의 어떤 구간도 연속으로 읽을 수 있다
+    memcpy(pattern + PATTERN_SIZE, pattern, PATTERN_SIZE);
+}
+
+static const char *pattern_at(const struct lg_conn *conn, uint64_t offset) {
+    return pattern + ((offset + conn->phase) % PATTERN_SIZE);
+}
+
+static size_t next_size(struct lg_thread *t) {
+    if (config.max_size == config.min_size) {
+        return config.min_size;
+    }
+    return config.min_size + (size_t) (xorshift64(&t->rng) % (config.max_size - config.min_size + 1));
+}
+
+static int update_interest(struct lg_thread *t, struct lg_conn *conn) {
+    int want_write = !conn->connected || conn->tx_offset < conn->tx_target;
+    if (want_write == conn->want_write) {
+        return 1;
+    }
+    struct epoll_event ev = {0};
+    ev.events = EPOLLIN | (want_write ? EPOLLOUT : 0);
+    ev.data.ptr = conn;
+    if (epoll_ctl(t->epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev) == -1) {
+        handle_epoll_error();
+        return 0;
+    }
+    conn->want_write = want_write;
+    return 1;
+}
+
+static void close_conn(struct lg_thread *t, struct lg_conn *conn) {
+    if (conn->closed) {
+        return;
+    }
+    epoll_ctl(t->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    conn->closed = 1;
+    if (conn->connected) {
+        t->connected--;
+    }
+    conn->connected = 0;
+}
+
+// 메시지 하나를 보낼 목록에 올린다. 실제 전송은 flush_conn() 에서 한다.
+static int queue_message(struct lg_conn *conn, size_t size, uint64_t start_ns) {
+    if (conn->msg_count == conn->msg_capacity) {
+        uint32_t new_capacity = conn->msg_capacity ? conn->msg_capacity * 2 : 16;
+        struct lg_msg *new_msgs = (struct lg_msg *) malloc(new_capacity * sizeof(struct lg_msg));
+        if (!new_msgs) {
+            return 0;
+        }
+        for (uint32_t i = 0; i < conn->msg_count; i++) {
+            new_msgs[i] = conn->msgs[(conn->msg_head + i) % conn->msg_capacity];
+        }
+        free(conn->msgs);
+        conn->msgs = new_msgs;
+        conn->msg_head = 0;
+        conn->msg_capacity = new_capacity;
+    }
+
+    conn->tx_target += size;
+    struct lg_msg *msg = &conn->msgs[(conn->msg_head + conn->msg_count) % conn->msg_capacity];
+    msg->end_offset = conn->tx_target;
+    msg->start_ns = start_ns;
+    conn->msg_count++;
+    return 1;
+}
+
+static int flush_conn(struct lg_thread *t, struct lg_conn *conn) {
+    while (conn->tx_offset < conn->tx_target) {
+        size_t len = conn->tx_target - conn->tx_offset;
+        if (len > PATTERN_SIZE) {
+            len = PATTERN_SIZE;
+        }
+        ssize_t sent = send(conn->fd, pattern_at(conn, conn->tx_offset), len, MSG_NOSIGNAL);
+        if (sent > 0) {
+            conn->tx_offset += sent;
+        } else if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            if (!handle_send_error()) {
+                t->io_errors++;
+                return 0;
+            }
+        }
+    }
+    return update_interest(t, conn);
+}
+
+// 받은 바이트를 패턴과 비교하고, 끝난 메시지의 지연 시간을 기록한다
+static int receive_conn(struct lg_thread *t, struct lg_conn *conn, char *buffer, uint64_t now) {
+    int completed = 0;
+
+    while (1) {
+        ssize_t bytes = recv(conn->fd, buffer, BUFFER_SIZE, 0);
+        if (bytes > 0) {
+            if (conn->rx_offset + bytes > conn->tx_offset) {
+                t->verify_errors++; // 보내지 않은 데이터가 돌아왔다
+                return -1;
+            }
+            size_t checked = 0;
+            while (checked < (size_t) bytes) {
+                size_t len = (size_t) bytes - checked;
+                if (len > PATTERN_SIZE) {
+                    len = PATTERN_SIZE;
+                }
+                if (memcmp(buffer + checked, pattern_at(conn, conn->rx_offset + checked), len) != 0) {
+                    t->verify_errors++;
+                    return -1;
+                }
+                checked += len;
+            }
+            conn->rx_offset += bytes;
+            __atomic_fetch_add(&t->bytes_rx, bytes, __ATOMIC_RELAXED);
+
+            while (conn->msg_count > 0 && conn->msgs[conn->msg_head].end_offset <= conn->rx_offset) {
+                histogram_record(&t->latency, now - conn->msgs[conn->msg_head].start_ns);
+                conn->msg_head = (conn->msg_head + 1) % conn->msg_capacity;
+                conn->msg_count--;
+                completed++;
+            }
+        } else if (bytes == 0) {
+            t->io_errors++; // 서버가 연결을 닫음
+            return -1;
+        } else {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            if (!handle_receive_error()) {
+                t->io_errors++;
+                return -1;
+            }
+        }
+    }
+
+    __atomic_fetch_add(&t->msgs_done, completed, __ATOMIC_RELAXED);
+    return completed;
+}
+
+// 논블로킹 connect 를 시작한다. 완료는 EPOLLOUT 으로 알 수 있다.
+static int start_connect(struct lg_thread *t, struct lg_conn *conn, const struct sockaddr *addr, socklen_t addr_len) {
+    conn->fd = socket(addr->sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (conn->fd == -1) {
+        handle_socket_error();
+        return 0;
+    }
+    if (config.nodelay && addr->sa_family == AF_INET) {
+        int opt = 1;
+        setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    }
+
+    // AF_UNIX 는 바로 연결되거나, 서버 대기열이 차 있으면 EAGAIN 으로 실패한다
+    if (connect(conn->fd, addr, addr_len) == -1 && errno != EINPROGRESS) {
+        handle_connect_error();
+        close(conn->fd);
+        return 0;
+    }
+
+    struct epoll_event ev = {0};
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.ptr = conn;
+    if (epoll_ctl(t->epoll_fd, EPOLL_CTL_ADD, conn->fd, &ev) == -1) {
+        handle_epoll_error();
+        close(conn->fd);
+        return 0;
+    }
+    conn->want_write = 1;
+    conn->closed = 0;
+    return 1;
+}
+
+static int finish_connect(struct lg_thread *t, struct lg_conn *conn, uint64_t now) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &err, &len) == -1 || err != 0) {
+        errno = err;
+        handle_connect_error();
+        return 0;
+    }
+    conn->connected = 1;
+    t->connected++;
+
+    // closed-loop: 연결되자마자 depth 만큼 보내 둔다
+    if (config.rate == 0) {
+        for (int i = 0; i < config.depth; i++) {
+            if (!queue_message(conn, next_size(t), now)) {
+                return 0;
+            }
+            __atomic_fetch_add(&t->msgs_sent, 1, __ATOMIC_RELAXED);
+        }
+    }
+    return 1;
+}
+
+static void *thread_main(void *arg) {
+    struct lg_thread *t = (struct lg_thread *) arg;
+    char *buffer = (char *) malloc(BUFFER_SIZE);
+    struct epoll_event events[MAX_EVENTS];
+
+    struct sockaddr_storage addr = {0};
+    socklen_t addr_len = sizeof(struct sockaddr_in);
+    if (config.unix_path) {
+        unix_addr_init(config.unix_path, (struct sockaddr_un *) &addr, &addr_len);
+    } else {
+        struct sockaddr_in *in_addr = (struct sockaddr_in *) &addr;
+        in_addr->sin_family = AF_INET;
+        in_addr->sin_port = htons(config.port);
+        inet_pton(AF_INET, config.host, &in_addr->sin_addr);
+    }
+
+    t->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (t->epoll_fd == -1 || !buffer) {
+        handle_epoll_error();
+        free(buffer);
+        return NULL;
+    }
+
+    for (int i = 0; i < t->conn_count; i++) {
+        struct lg_conn *conn = &t->conns[i];
+        conn->id = t->first_conn + i;
+        conn->phase = (uint32_t) (conn->id * 7919u) % PATTERN_SIZE;
+        conn->closed = 1;
+        if (!start_connect(t, conn, (const struct sockaddr *) &addr, addr_len)) {
+            t->connect_errors++;
+        }
+    }
+
+    // open-loop: 스레드마다 rate / threads 의 일정한 간격으로 메시지를 보낸다
+    double thread_rate = config.rate / config.threads;
+    uint64_t interval_ns = thread_rate > 0 ? (uint64_t) (1e9 / thread_rate) : 0;
+    uint64_t next_send_ns = now_ns();
+    int rr = 0;
+    uint64_t stop_ns = 0;
+
+    while (1) {
+        uint64_t now = now_ns();
+
+        if (!running && stop_ns == 0) {
+            stop_ns = now;
+        }
+        if (stop_ns) {
+            // 새 메시지는 보내지 않고, 남은 응답을 잠시 기다린 뒤 끝낸다
+            int inflight = 0;
+            for (int i = 0; i < t->conn_count; i++) {
+                inflight |= !t->conns[i].closed && t->conns[i].msg_count > 0;
+            }
+            if (!inflight || now - stop_ns > DRAIN_TIMEOUT_NS) {
+                break;
+            }
+        }
+
+        if (interval_ns && !stop_ns && t->connected > 0) {
+            while (next_send_ns <= now) {
+                // 연결된 소켓을 돌아가며 고른다
+                struct lg_conn *conn = NULL;
+                for (int tries = 0; tries < t->conn_count; tries++) {
+                    struct lg_conn *c = &t->conns[rr++ % t->conn_count];
+                    if (c->connected) {
+                        conn = c;
+                        break;
+                    }
+                }
+                if (!conn) {
+                    break;
+                }
+                if (queue_message(conn, next_size(t), next_send_ns)) {
+                    __atomic_fetch_add(&t->msgs_sent, 1, __ATOMIC_RELAXED);
+                    if (!flush_conn(t, conn)) {
+                        close_conn(t, conn);
+                    }
+                }
+                next_send_ns += interval_ns;
+            }
+        }
+
+        struct timespec timeout = {0, 100 * 1000000L};
+        if (interval_ns && !stop_ns && t->connected > 0) {
+            uint64_t wait = next_send_ns > now ? next_send_ns - now : 0;
+            timeout.tv_sec = (time_t) (wait / 1000000000ULL);
+            timeout.tv_nsec = (long) (wait % 1000000000ULL);
+        }
+
+        int rc = epoll_pwait2(t->epoll_fd, events, MAX_EVENTS, &timeout, NULL);
+        if (rc < 0) {
+            if (handle_epoll_error()) {
+                continue;
+            }
+            break;
+        }
+
+        now = now_ns();
+        for (int i = 0; i < rc; i++) {
+            struct lg_conn *conn = (struct lg_conn *) events[i].data.ptr;
+            uint32_t revents = events[i].events;
+
+            if (!conn->connected) {
+                if (!finish_connect(t, conn, now)) {
+                    t->connect_errors++;
+                    close_conn(t, conn);
+                    continue;
+                }
+                if (!flush_conn(t, conn)) {
+                    close_conn(t, conn);
+                }
+                continue;
+            }
+
+            if (revents & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                int completed = receive_conn(t, conn, buffer, now);
+                if (completed < 0) {
+                    close_conn(t, conn);
+                    continue;
+                }
+                // closed-loop: 끝난 만큼 다시 보낸다
+                if (config.rate == 0 && !stop_ns) {
+                    for (int k = 0; k < completed; k++) {
+                        queue_message(conn, next_size(t), now);
+                        __atomic_fetch_add(&t->msgs_sent, 1, __ATOMIC_RELAXED);
+                    }
+                }
+            }
+
+            if (!flush_conn(t, conn)) {
+                close_conn(t, conn);
+            }
+        }
+    }
+
+    for (int i = 0; i < t->conn_count; i++) {
+        close_conn(t, &t->conns[i]);
+        free(t->conns[i].msgs);
+    }
+    close(t->epoll_fd);
+    free(buffer);
+    return NULL;
+}
+
+static int udp_setup(struct lg_thread *t, struct lg_udp *u) {
+    u->rx_buffer = (char *) malloc((size_t) UDP_RX_BATCH * (UDP_MAX_DATAGRAM + 1));
+    u->tx_buffer = (char *) malloc((size_t) UDP_TX_BATCH * config.max_size);
+    if (!u->rx_buffer || !u->tx_buffer) {
+        return 0;
+    }
+    for (int i = 0; i < UDP_RX_BATCH; i++) {
+        u->rx_iov[i].iov_base = u->rx_buffer + (size_t) i * (UDP_MAX_DATAGRAM + 1);
+        u->rx_iov[i].iov_len = UDP_MAX_DATAGRAM + 1;
+        u->rx[i].msg_hdr.msg_iov = &u->rx_iov[i];
+        u->rx[i].msg_hdr.msg_iovlen = 1;
+    }
+    for (int i = 0; i < UDP_TX_BATCH; i++) {
+        u->tx[i].msg_hdr.msg_iov = &u->tx_iov[i];
+        u->tx[i].msg_hdr.msg_iovlen = 1;
+    }
+    u->train = 1;
+    if (config.gso > 1) {
+        u->train = config.gso;
+        if ((size_t) u->train * config.min_size > UDP_MAX_DATAGRAM) {
+            u->train = (int) (UDP_MAX_DATAGRAM / config.min_size);
+        }
+    }
+    t->udp = u;
+    return 1;
+}
+
+static int udp_connect(struct lg_thread *t, struct lg_conn *conn, const struct sockaddr_in *addr) {
+    conn->fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (conn->fd == -1) {
+        handle_socket_error();
+        return 0;
+    }
+    if (config.gso > 0) {
+        int opt = 1;
+        if (setsockopt(conn->fd, IPPROTO_UDP, UDP_GRO, &opt, sizeof(opt)) == -1) {
+            handle_setsockopt_error();
+        }
+    }
+    // 보낼 곳을 고정하고, 다른 곳에서 온 datagram 은 커널이 걸러 낸다
+    if (connect(conn->fd, (const struct sockaddr *) addr, sizeof(*addr)) == -1) {
+        handle_connect_error();
+        close(conn->fd);
+        return 0;
+    }
+
+    struct epoll_event ev = {0};
+    ev.events = EPOLLIN;
+    ev.data.ptr = conn;
+    if (epoll_ctl(t->epoll_fd, EPOLL_CTL_ADD, conn->fd, &ev) == -1) {
+        handle_epoll_error();
+        close(conn->fd);
+        return 0;
+    }
+    conn->closed = 0;
+    conn->connected = 1;
+    t->connected++;
+    return 1;
+}
+
+static void udp_fill(const struct lg_conn *conn, char *out, size_t size, uint64_t seq, uint64_t start_ns) {
+    struct lg_dgram_header header = {seq, start_ns};
+    memcpy(out, &header, sizeof(header));
+    memcpy(out + sizeof(header), pattern_at(conn, seq), size - sizeof(header));
+}
+
+// datagram 을 count 개 보낸다. 보낸 개수를 반환하고, 소켓을 더 쓸 수 없으면 -1.
+// 송신 버퍼가 차면 나머지는 보내지 않는다 (보낸 것만 순번을 쓴다).
+static int udp_send(struct lg_thread *t, struct lg_conn *conn, int count, uint64_t start_ns) {
+    struct lg_udp *u = t->udp;
+    int total = 0;
+
+    while (count > 0) {
+        int n = count < UDP_TX_BATCH ? count : UDP_TX_BATCH;
+        int msgs = 0;
+        char *p = u->tx_buffer;
+        for (int k = 0; k < n; msgs++) {
+            // GSO 를 켜면 같은 크기 datagram 을 이어 붙여 sendmsg 하나에 싣고 커널이 자르게 한다
+            int train = n - k < u->train ? n - k : u->train;
+            size_t size = train > 1 ? config.min_size : next_size(t);
+            for (int j = 0; j < train; j++) {
+                udp_fill(conn, p + j * size, size, conn->next_seq + k + j, start_ns);
+            }
+            struct msghdr *msg = &u->tx[msgs].msg_hdr;
+            u->tx_iov[msgs].iov_base = p;
+            u->tx_iov[msgs].iov_len = size * train;
+            u->tx_segments[msgs] = train;
+            msg->msg_control = NULL;
+            msg->msg_controllen = 0;
+            if (train > 1) {
+                msg->msg_control = u->tx_control[msgs].buf;
+                msg->msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+                struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                uint16_t gso_size = (uint16_t) size;
+                memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+            }
+            p += size * train;
+            k += train;
+        }
+
+        int sent_msgs = 0;
+        int sent = 0;
+        while (sent_msgs < msgs) {
+            int rc = sendmmsg(conn->fd, u->tx + sent_msgs, (unsigned int) (msgs - sent_msgs), 0);
+            if (rc > 0) {
+                for (int i = sent_msgs; i < sent_msgs + rc; i++) {
+                    sent += u->tx_segments[i];
+                }
+                sent_msgs += rc;
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            if (!handle_sendmmsg_error()) {
+                t->io_errors++;
+                return -1;
+            }
+            if (errno != EINTR) {
+                t->io_errors++; // 서버가 없거나 datagram 이 너무 크다. 이번 묶음은 버린다
+                break;
+            }
+        }
+
+        conn->next_seq += sent;
+        conn->inflight += sent;
+        total += sent;
+        __atomic_fetch_add(&t->msgs_sent, sent, __ATOMIC_RELAXED);
+        if (sent_msgs < msgs) {
+            break;
+        }
+        count -= n;
+    }
+    return total;
+}
+
+// 돌아온 datagram 하나를 확인한다. 끝난 메시지면 1, 손실로 처리한 뒤 늦게 온 것이면 0, 잘못된 것이면 -1.
+static int udp_verify(struct lg_thread *t, struct lg_conn *conn, const char *data, size_t len, uint64_t now) {
+    struct lg_dgram_header header;
+    if (len < sizeof(header)) {
+        t->verify_errors++;
+        return -1;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.seq >= conn->next_seq ||
+        memcmp(data + sizeof(header), pattern_at(conn, header.seq), len - sizeof(header)) != 0) {
+        t->verify_errors++;
+        return -1;
+    }
+    if (header.seq < conn->lost_below) {
+        return 0;
+    }
+    if (conn->inflight > 0) {
+        conn->inflight--;
+    }
+    histogram_record(&t->latency, now - header.start_ns);
+    return 1;
+}
+
+static int gro_segment_size(struct msghdr *msg) {
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            int size;
+            memcpy(&size, CMSG_DATA(cmsg), sizeof(size));
+            return size;
+        }
+    }
+    return 0;
+}
+
+// 받을 수 있는 datagram 을 모두 받는다. 끝난 메시지 수를 반환하고, 소켓을 더 쓸 수 없으면 -1.
+static int udp_receive(struct lg_thread *t, struct lg_conn *conn, uint64_t now) {
+    struct lg_udp *u = t->udp;
+    int completed = 0;
+
+    while (1) {
+        if (config.gso > 0) {
+            for (int i = 0; i < UDP_RX_BATCH; i++) {
+                u->rx[i].msg_hdr.msg_control = u->rx_control[i].buf;
+                u->rx[i].msg_hdr.msg_controllen = sizeof(u->rx_control[i].buf);
+            }
+        }
+        int n = recvmmsg(conn->fd, u->rx, UDP_RX_BATCH, MSG_DONTWAIT, NULL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            if (!handle_recvmmsg_error()) {
+                t->io_errors++;
+                return -1;
+            }
+            if (errno != EINTR) {
+                t->io_errors++; // 서버가 아직 없어서 ICMP 로 거부당했다
+            }
+            continue;
+        }
+
+        uint64_t bytes = 0;
+        for (int i = 0; i < n; i++) {
+            const char *data = (const char *) u->rx_iov[i].iov_base;
+            size_t len = u->rx[i].msg_len;
+            size_t segment = config.gso > 0 ? (size_t) gro_segment_size(&u->rx[i].msg_hdr) : 0;
+            if (segment == 0) {
+                segment = len;
+            }
+            for (size_t off = 0; off < len; off += segment) {
+                int rc = udp_verify(t, conn, data + off, len - off < segment ? len - off : segment, now);
+                if (rc < 0) {
+                    return -1;
+                }
+                completed += rc;
+            }
+            bytes += len;
+        }
+        __atomic_fetch_add(&t->bytes_rx, bytes, __ATOMIC_RELAXED);
+        conn->progress_ns = now;
+        if (n < UDP_RX_BATCH) {
+            break;
+        }
+    }
+
+    __atomic_fetch_add(&t->msgs_done, completed, __ATOMIC_RELAXED);
+    return completed;
+}
+
+// closed-loop 에서 depth 만큼 채운다. 응답이 끊긴 지 오래된 것은 손실로 치고 새로 보낸다.
+static int udp_refill(struct lg_thread *t, struct lg_conn *conn, uint64_t now) {
+    if (conn->inflight > 0 && now - conn->progress_ns > UDP_LOSS_TIMEOUT_NS) {
+        conn->lost_below = conn->next_seq;
+        conn->inflight = 0;
+    }
+    if (conn->inflight >= (uint32_t) config.depth) {
+        return 1;
+    }
+    if (conn->inflight == 0) {
+        conn->progress_ns = now;
+    }
+    return udp_send(t, conn, config.depth - (int) conn->inflight, now) >= 0;
+}
+
+static void *udp_thread_main(void *arg) {
+    struct lg_thread *t = (struct lg_thread *) arg;
+    struct lg_udp *u = (struct lg_udp *) calloc(1, sizeof(struct lg_udp));
+    struct epoll_event events[MAX_EVENTS];
+
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config.port);
+    inet_pton(AF_INET, config.host, &addr.sin_addr);
+
+    t->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (t->epoll_fd == -1 || !u || !udp_setup(t, u)) {
+        handle_epoll_error();
+        if (u) {
+            free(u->rx_buffer);
+            free(u->tx_buffer);
+        }
+        free(u);
+        return NULL;
+    }
+
+    uint64_t now = now_ns();
+    for (int i = 0; i < t->conn_count; i++) {
+        struct lg_conn *conn = &t->conns[i];
+        conn->id = t->first_conn + i;
+        conn->phase = (uint32_t) (conn->id * 7919u) % PATTERN_SIZE;
+        conn->closed = 1;
+        if (!udp_connect(t, conn, &addr)) {
+            t->connect_errors++;
+        } else if (config.rate == 0 && !udp_refill(t, conn, now)) {
+            close_conn(t, conn);
+        }
+    }
+
+    double thread_rate = config.rate / config.threads;
+    uint64_t interval_ns = thread_rate > 0 ? (uint64_t) (1e9 / thread_rate) : 0;
+    uint64_t next_send_ns = now_ns();
+    uint64_t next_check_ns = next_send_ns + UDP_LOSS_CHECK_NS;
+    int rr = 0;
+    uint64_t stop_ns = 0;
+
+    while (1) {
+        now = now_ns();
+
+        if (!running && stop_ns == 0) {
+            stop_ns = now;
+        }
+        if (stop_ns) {
+            // 남은 응답을 기다린다. 손실된 것은 UDP_LOSS_TIMEOUT_NS 뒤에 포기한다
+            int inflight = 0;
+            for (int i = 0; i < t->conn_count; i++) {
+                struct lg_conn *conn = &t->conns[i];
+                inflight |= !conn->closed && conn->inflight > 0 && now - conn->progress_ns <= UDP_LOSS_TIMEOUT_NS;
+            }
+            if (!inflight || now - stop_ns > DRAIN_TIMEOUT_NS) {
+                break;
+            }
+        }
+
+        if (interval_ns && !stop_ns && t->connected > 0) {
+            while (next_send_ns <= now) {
+                struct lg_conn *conn = NULL;
+                for (int tries = 0; tries < t->conn_count; tries++) {
+                    struct lg_conn *c = &t->conns[rr++ % t->conn_count];
+                    if (c->connected) {
+                        conn = c;
+                        break;
+                    }
+                }
+                if (!conn) {
+                    break;
+                }
+                if (conn->inflight == 0) {
+                    conn->progress_ns = now;
+                }
+                if (udp_send(t, conn, 1, next_send_ns) < 0) {
+                    close_conn(t, conn);
+                }
+                next_send_ns += interval_ns;
+            }
+        }
+
+        if (config.rate == 0 && !stop_ns && now >= next_check_ns) {
+            next_check_ns = now + UDP_LOSS_CHECK_NS;
+            for (int i = 0; i < t->conn_count; i++) {
+                struct lg_conn *conn = &t->conns[i];
+                if (conn->connected && !udp_refill(t, conn, now)) {
+                    close_conn(t, conn);
+                }
+            }
+        }
+
+        uint64_t wait = UDP_LOSS_CHECK_NS;
+        if (interval_ns && !stop_ns && t->connected > 0) {
+            wait = next_send_ns > now ? next_send_ns - now : 0;
+        }
+        struct timespec timeout = {(time_t) (wait / 1000000000ULL), (long) (wait % 1000000000ULL)};
+
+        int rc = epoll_pwait2(t->epoll_fd, events, MAX_EVENTS, &timeout, NULL);
+        if (rc < 0) {
+            if (handle_epoll_error()) {
+                continue;
+            }
+            break;
+        }
+
+        now = now_ns();
+        for (int i = 0; i < rc; i++) {
+            struct lg_conn *conn = (struct lg_conn *) events[i].data.ptr;
+            if (udp_receive(t, conn, now) < 0) {
+                close_conn(t, conn);
+                continue;
+            }
+            if (config.rate == 0 && !stop_ns && !udp_refill(t, conn, now)) {
+                close_conn(t, conn);
+            }
+        }
+    }
+
+    for (int i = 0; i < t->conn_count; i++) {
+        close_conn(t, &t->conns[i]);
+    }
+    close(t->epoll_fd);
+    free(u->rx_buffer);
+    free(u->tx_buffer);
+    free(u);
+    return NULL;
+}
+
+// "64" 또는 "64-4096" 형식
+static int parse_size_range(const char *str, size_t *min_size, size_t *max_size) {
+    char *end;
+    unsigned long long first = strtoull(str, &end, 10);
+    if (end == str || first == 0) {
+        return 0;
+    }
+    unsigned long long last = first;
+    if (*end == '-') {
+        const char *p = end + 1;
+        last = strtoull(p, &end, 10);
+        if (end == p || last < first) {
+            return 0;
+        }
+    }
+    if (*end != '\0') {
+        return 0;
+    }
+    *min_size = (size_t) first;
+    *max_size = (size_t) last;
+    return 1;
+}
+
+static void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "  -a, --address IP      server address (default: %s)\n", SERVER_IP);
+    fprintf(stderr, "  -p, --port PORT       server port (default: %d)\n", SERVER_PORT);
+    fprintf(stderr, "  -c, --connections N   total connections (default: 100)\n");
+    fprintf(stderr, "  -t, --threads N       worker threads (default: 1)\n");
+    fprintf(stderr, "  -d, --duration SEC    test duration (default: 10)\n");
+    fprintf(stderr, "  -s, --size N[-M]      payload size, fixed or uniform random range (default: 64)\n");
+    fprintf(stderr, "  -D, --depth N         closed-loop messages in flight per connection (default: 1)\n");
+    fprintf(stderr, "  -r, --rate N          open-loop total messages per second (default: closed-loop)\n");
+    fprintf(stderr, "  -N, --no-nodelay      leave Nagle's algorithm enabled\n");
+    fprintf(stderr, "  -j, --json FILE       also write the results as JSON to FILE (- for stdout)\n");
+    fprintf(stderr, "  -U, --unix PATH       connect to the server's unix socket listener (server -U) instead, @name for abstract\n");
+    fprintf(stderr, "  -o, --udp             send datagrams to a server started with -e udp (size >= %zu)\n",
+            sizeof(struct lg_dgram_header));
+    fprintf(stderr, "  -g, --gso N           send N same-size datagrams per syscall with UDP_SEGMENT, receive with UDP_GRO\n");
+}
+
+// 벤치마크 스크립트가 읽는 결과. 지연은 마이크로초.
+static void write_json(FILE *out, double seconds, uint64_t sent, uint64_t done, uint64_t bytes,
+                       uint64_t connect_errors, uint64_t io_errors, uint64_t verify_errors,
+                       const struct histogram *latency) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"transport\": \"%s\",\n", config.udp ? "udp" : config.unix_path ? "unix" : "tcp");
+    fprintf(out, "  \"connections\": %d,\n  \"threads\": %d,\n", config.connections, config.threads);
+    fprintf(out, "  \"min_size\": %zu,\n  \"max_size\": %zu,\n", config.min_size, config.max_size);
+    fprintf(out, "  \"depth\": %d,\n  \"rate\": %.0f,\n  \"seconds\": %.3f,\n", config.depth, config.rate, seconds);
+    fprintf(out, "  \"sent\": %llu,\n  \"completed\": %llu,\n", (unsigned long long) sent, (unsigned long long) done);
+    fprintf(out, "  \"lost\": %llu,\n", (unsigned long long) (config.udp ? sent - done : 0));
+    fprintf(out, "  \"msgs_per_sec\": %.1f,\n  \"mb_per_sec\": %.3f,\n", done / seconds, bytes / seconds / 1e6);
+    fprintf(out, "  \"errors\": {\"connect\": %llu, \"io\": %llu, \"verify\": %llu},\n",
+            (unsigned long long) connect_errors, (unsigned long long) io_errors, (unsigned long long) verify_errors);
+    if (latency->total == 0) {
+        fprintf(out, "  \"latency_us\": null\n");
+    } else {
+        fprintf(out, "  \"latency_us\": {\"min\": %.1f, \"mean\": %.1f, \"p50\": %.1f, \"p90\": %.1f, "
+                     "\"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f}\n",
+                latency->min / 1000.0, histogram_mean(latency) / 1000.0,
+                histogram_percentile(latency, 50.0) / 1000.0, histogram_percentile(latency, 90.0) / 1000.0,
+                histogram_percentile(latency, 99.0) / 1000.0, histogram_percentile(latency, 99.9) / 1000.0,
+                latency->max / 1000.0);
+    }
+    fprintf(out, "}\n");
+}
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        {"address", required_argument, NULL, 'a'},
+        {"port", required_argument, NULL, 'p'},
+        {"connections", required_argument, NULL, 'c'},
+        {"threads", required_argument, NULL, 't'},
+        {"duration", required_argument, NULL, 'd'},
+        {"size", required_argument, NULL, 's'},
+        {"depth", required_argument, NULL, 'D'},
+        {"rate", required_argument, NULL, 'r'},
+        {"no-nodelay", no_argument, NULL, 'N'},
+        {"json", required_argument, NULL, 'j'},
+        {"unix", required_argument, NULL, 'U'},
+        {"udp", no_argument, NULL, 'o'},
+        {"gso", required_argument, NULL, 'g'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    int opt_ch;
+    while ((opt_ch = getopt_long(argc, argv, "a:p:c:t:d:s:D:r:Nj:U:og:h", long_options, NULL)) != -1) {
+        switch (opt_ch) {
+            case 'a':
+                config.host = optarg;
+                break;
+            case 'p':
+                config.port = atoi(optarg);
+                break;
+            case 'c':
+                config.connections = atoi(optarg);
+                break;
+            case 't':
+                config.threads = atoi(optarg);
+                break;
+            case 'd':
+                config.duration = atoi(optarg);
+                break;
+            case 's':
+                if (!parse_size_range(optarg, &config.min_size, &config.max_size)) {
+                    fprintf(stderr, "Invalid size: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'D':
+                config.depth = atoi(optarg);
+                break;
+            case 'r':
+                config.rate = atof(optarg);
+                break;
+            case 'N':
+                config.nodelay = 0;
+                break;
+            case 'j':
+                config.json_path = optarg;
+                break;
+            case 'U':
+                config.unix_path = optarg;
+                break;
+            case 'o':
+                config.udp = 1;
+                break;
+            case 'g':
+                config.gso = atoi(optarg);
+                if (config.gso < 1 || config.gso > UDP_MAX_SEGMENTS) {
+                    fprintf(stderr, "Invalid GSO segment count: %s (1-%d)\n", optarg, UDP_MAX_SEGMENTS);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                exit(EXIT_SUCCESS);
+            default:
+                print_usage(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    struct in_addr probe;
+    if (inet_pton(AF_INET, config.host, &probe) <= 0) {
+        fprintf(stderr, "Invalid address: %s\n", config.host);
+        exit(EXIT_FAILURE);
+    }
+    if (config.port <= 0 || config.port > 65535 || config.connections < 1 || config.threads < 1 ||
+        config.threads > MAX_THREADS || config.duration < 1 || config.depth < 1 || config.rate < 0) {
+        print_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (config.unix_path) {
+        struct sockaddr_un probe_un;
+        socklen_t probe_len;
+        if (config.udp || !unix_addr_init(config.unix_path, &probe_un, &probe_len)) {
+            fprintf(stderr, "Invalid unix socket path (TCP stream mode only): %s\n", config.unix_path);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (config.udp && (config.min_size < sizeof(struct lg_dgram_header) || config.max_size > UDP_MAX_DATAGRAM)) {
+        fprintf(stderr, "UDP payload size must be %zu-%d\n", sizeof(struct lg_dgram_header), UDP_MAX_DATAGRAM);
+        exit(EXIT_FAILURE);
+    }
+    if (config.gso > 0 && (!config.udp || config.min_size != config.max_size)) {
+        fprintf(stderr, "GSO requires UDP mode with a fixed size\n");
+        exit(EXIT_FAILURE);
+    }
+    if (config.threads > config.connections) {
+        config.threads = config.connections;
+    }
+
+    init_pattern();
+
+    struct lg_conn *conns = (struct lg_conn *) calloc(config.connections, sizeof(struct lg_conn));
+    struct lg_thread *threads = (struct lg_thread *) calloc(config.threads, sizeof(struct lg_thread));
+    if (!conns || !threads) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+
+    int next_conn = 0;
+    for (int i = 0; i < config.threads; i++) {
+        struct lg_thread *t = &threads[i];
+        t->id = i;
+        t->first_conn = next_conn;
+        t->conn_count = config.connections / config.threads + (i < config.connections % config.threads);
+        t->conns = conns + next_conn;
+        t->rng = 0x2545f4914f6cdd1dULL ^ ((uint64_t) (i + 1) * 0x9e3779b97f4a7c15ULL);
+        histogram_init(&t->latency);
+        next_conn += t->conn_count;
+    }
+
+    printf("loadgen: %s %s:%d, %d %s, %d threads, size %zu-%zu, %s",
+           config.udp ? "udp" : config.unix_path ? "unix" : "tcp",
+           config.unix_path ? config.unix_path : config.host, config.port, config.connections, config.udp ? "sockets" : "connections", config.threads,
+           config.min_size, config.max_size, config.rate > 0 ? "open-loop" : "closed-loop");
+    if (config.rate > 0) {
+        printf(" %.0f msg/s\n", config.rate);
+    } else {
+        printf(" depth %d\n", config.depth);
+    }
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < config.threads; i++) {
+        int rc = pthread_create(&threads[i].thread, NULL, config.udp ? udp_thread_main : thread_main, &threads[i]);
+        if (rc != 0) {
+            fprintf(stderr, "[Error] pthread_create() failed: %s\n", strerror(rc));
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // 1초마다 진행 상황 출력
+    uint64_t last_done = 0;
+    for (int sec = 1; sec <= config.duration; sec++) {
+        sleep(1);
+        uint64_t done = 0;
+        uint64_t bytes = 0;
+        for (int i = 0; i < config.threads; i++) {
+            done += __atomic_load_n(&threads[i].msgs_done, __ATOMIC_RELAXED);
+            bytes += __atomic_load_n(&threads[i].bytes_rx, __ATOMIC_RELAXED);
+        }
+        printf("[%3ds] %10llu msg/s  %10.2f MB received\n", sec,
+               (unsigned long long) (done - last_done), bytes / 1e6);
+        fflush(stdout);
+        last_done = done;
+    }
+    running = 0;
+    uint64_t elapsed = now_ns() - start;
+
+    for (int i = 0; i < config.threads; i++) {
+        pthread_join(threads[i].thread, NULL);
+    }
+
+    struct histogram total;
+    histogram_init(&total);
+    uint64_t sent = 0, done = 0, bytes = 0, connect_errors = 0, io_errors = 0, verify_errors = 0;
+    for (int i = 0; i < config.threads; i++) {
+        histogram_merge(&total, &threads[i].latency);
+        sent += threads[i].msgs_sent;
+        done += threads[i].msgs_done;
+        bytes += threads[i].bytes_rx;
+        connect_errors += threads[i].connect_errors;
+        io_errors += threads[i].io_errors;
+        verify_errors += threads[i].verify_errors;
+    }
+
+    double seconds = elapsed / 1e9;
+    printf("\n");
+    printf("messages: sent %llu, completed %llu\n", (unsigned long long) sent, (unsigned long long) done);
+    printf("throughput: %.0f msg/s, %.2f MB/s\n", done / seconds, bytes / seconds / 1e6);
+    if (config.udp) {
+        printf("lost: %llu (%.2f%%)\n", (unsigned long long) (sent - done), sent ? (sent - done) * 100.0 / sent : 0.0);
+    }
+    printf("errors: connect %llu, io %llu, verify %llu\n", (unsigned long long) connect_errors,
+           (unsigned long long) io_errors, (unsigned long long) verify_errors);
+    histogram_print_ns(stdout, "latency", &total);
+
+    if (config.json_path) {
+        FILE *out = strcmp(config.json_path, "-") == 0 ? stdout : fopen(config.json_path, "w");
+        if (!out) {
+            perror("Failed to open JSON output");
+        } else {
+            write_json(out, seconds, sent, done, bytes, connect_errors, io_errors, verify_errors, &total);
+            if (out != stdout) {
+                fclose(out);
+            }
+        }
+    }
+
+    free(threads);
+    free(conns);
+
+    return verify_errors == 0 ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,256 @@
+#define _GNU_SOURCE
+#include "../include/log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+#define LOG_RING_SIZE 4096 // 스레드별 레코드 수, 2의 거듭제곱
+#define LOG_BATCH_SIZE (64 * 1024)
+#define LOG_LINE_SIZE 512
+#define LOG_IDLE_SLEEP_NS (1000 * 1000)
+
+// 캐시 라인 하나에 들어가는 고정 크기 레코드
+struct log_record {
+    uint64_t ts_ns;
+    const char *fmt;
+    long long args[LOG_MAX_ARGS];
+    int32_t err;
+    uint8_t level;
+    uint8_t nargs;
+    uint16_t thread_id;
+};
+
+// 생산자 하나(로그를 쓰는 스레드), 소비자 하나(출력 스레드)인 링
+struct log_ring {
+    size_t head __attribute__((aligned(64))); // 소비자가 다음에 읽을 위치
+    size_t tail __attribute__((aligned(64))); // 생산자가 다음에 쓸 위치
+    size_t dropped;
+    size_t reported_dropped;
+    uint16_t thread_id;
+    struct log_ring *next;
+    struct log_record records[LOG_RING_SIZE];
+};
+
+int log_runtime_level = LOG_LEVEL_INFO;
+
+static const char *level_names[] = {"Trace", "Debug", "Info", "Warning", "Error"};
+
+static __thread struct log_ring *thread_ring = NULL;
+static struct log_ring *rings = NULL;
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t writer_thread;
+static int writer_running = 0;
+static int writer_stop = 0;
+static uint16_t next_thread_id = 0;
+
+void log_set_level(int level) {
+    __atomic_store_n(&log_runtime_level, level, __ATOMIC_RELAXED);
+}
+
+int log_parse_level(const char *name) {
+    static const char *names[] = {"trace", "debug", "info", "warn", "error", "off"};
+    for (int i = 0; i <= LOG_LEVEL_OFF; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static uint64_t realtime_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+// 레코드 하나를 한 줄로 포맷한다. 반환값은 쓴 바이트 수.
+static size_t format_record(const struct log_record *rec, char *out, size_t size) {
+    time_t sec = (time_t) (rec->ts_ns / 1000000000ULL);
+    struct tm tm;
+    localtime_r(&sec, &tm);
+
+    int n = (int) strftime(out, size, "%Y-%m-%d %H:%M:%S", &tm);
+    n += snprintf(out + n, size - n, ".%06llu [%s] ", (unsigned long long) (rec->ts_ns % 1000000000ULL) / 1000,
+                  level_names[rec->level]);
+
+    // 남는 인자는 printf 가 무시한다
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+    n += snprintf(out + n, size - n, rec->fmt, rec->args[0], rec->args[1], rec->args[2], rec->args[3]);
+#pragma GCC diagnostic pop
+    if ((size_t) n >= size - 1) {
+        n = (int) size - 2;
+    }
+
+    if (rec->err != 0) {
+        char errbuf[128];
+        const char *msg = strerror_r(rec->err, errbuf, sizeof(errbuf));
+        n += snprintf(out + n, size - n, ": %s", msg);
+        if ((size_t) n >= size - 1) {
+            n = (int) size - 2;
+        }
+    }
+    out[n++] = '\n';
+    return (size_t) n;
+}
+
+static void write_all(const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(STDERR_FILENO, data, len);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        data += written;
+        len -= (size_t) written;
+    }
+}
+
+static struct log_ring *register_thread_ring(void) {
+    struct log_ring *ring = (struct log_ring *) aligned_alloc(64, sizeof(struct log_ring));
+    if (!ring) {
+        return NULL;
+    }
+    memset(ring, 0, sizeof(*ring));
+
+    pthread_mutex_lock(&rings_lock);
+    ring->thread_id = next_thread_id++;
+    ring->next = rings;
+    __atomic_store_n(&rings, ring, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&rings_lock);
+
+    thread_ring = ring;
+    return ring;
+}
+
+void log_write(int level, int err, const char *fmt, int nargs, ...) {
+    struct log_record rec;
+    rec.ts_ns = realtime_ns();
+    rec.fmt = fmt;
+    rec.err = err;
+    rec.level = (uint8_t) level;
+    rec.nargs = (uint8_t) nargs;
+
+    va_list ap;
+    va_start(ap, nargs);
+    for (int i = 0; i < LOG_MAX_ARGS; i++) {
+        rec.args[i] = i < nargs ? va_arg(ap, long long) : 0;
+    }
+    va_end(ap);
+
+    if (!__atomic_load_n(&writer_running, __ATOMIC_ACQUIRE)) {
+        // 출력 스레드가 없으면 바로 쓴다
+        char line[LOG_LINE_SIZE];
+        rec.thread_id = 0;
+        write_all(line, format_record(&rec, line, sizeof(line)));
+        return;
+    }
+
+    struct log_ring *ring = thread_ring ? thread_ring : register_thread_ring();
+    if (!ring) {
+        return;
+    }
+    rec.thread_id = ring->thread_id;
+
+    size_t tail = ring->tail;
+    size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if (tail - head == LOG_RING_SIZE) {
+        // 링이 가득 차면 이벤트 루프를 막지 않고 버린다
+        __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+    ring->records[tail & (LOG_RING_SIZE - 1)] = rec;
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// 모든 스레드의 링을 비우고 배치로 출력한다. 읽은 레코드 수를 반환한다.
+static size_t drain_rings(char *batch) {
+    size_t used = 0;
+    size_t drained = 0;
+
+    for (struct log_ring *ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+        size_t head = ring->head;
+        size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail; head++) {
+            if (used + LOG_LINE_SIZE > LOG_BATCH_SIZE) {
+                write_all(batch, used);
+                used = 0;
+            }
+            used += format_record(&ring->records[head & (LOG_RING_SIZE - 1)], batch + used, LOG_LINE_SIZE);
+            drained++;
+        }
+        __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+
+        size_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+        if (dropped != ring->reported_dropped) {
+            if (used + LOG_LINE_SIZE > LOG_BATCH_SIZE) {
+                write_all(batch, used);
+                used = 0;
+            }
+            used += (size_t) snprintf(batch + used, LOG_LINE_SIZE, "[Warning] log: thread %u dropped %zu records\n",
+                                      ring->thread_id, dropped - ring->reported_dropped);
+            ring->reported_dropped = dropped;
+        }
+    }
+
+    if (used > 0) {
+        write_all(batch, used);
+    }
+    return drained;
+}
+
+static void *writer_main(void *arg) {
+    (void) arg;
+    char *batch = (char *) malloc(LOG_BATCH_SIZE);
+    if (!batch) {
+        return NULL;
+    }
+
+    while (1) {
+        int stop = __atomic_load_n(&writer_stop, __ATOMIC_ACQUIRE);
+        size_t drained = drain_rings(batch);
+        if (stop && drained == 0) {
+            break;
+        }
+        if (drained == 0) {
+            struct timespec ts = {0, LOG_IDLE_SLEEP_NS};
+            nanosleep(&ts, NULL);
+        }
+    }
+
+    free(batch);
+    return NULL;
+}
+
+int log_start(void) {
+    if (writer_running) {
+        return 1;
+    }
+    writer_stop = 0;
+    int rc = pthread_create(&writer_thread, NULL, writer_main, NULL);
+    if (rc != 0) {
+        fprintf(stderr, "[Error] pthread_create() failed for log writer: %s\n", strerror(rc));
+        return 0;
+    }
+    __atomic_store_n(&writer_running, 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+void log_stop(void) {
+    if (!writer_running) {
+        return;
+    }
+    __atomic_store_n(&writer_stop, 1, __ATOMIC_RELEASE);
+    pthread_join(writer_thread, NULL);
+    __atomic_store_n(&writer_running, 0, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,79 @@
+#define _GNU_SOURCE
+#include "../include/pipe_pool.h"
+#include "../include/log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+void pipe_pool_init(struct pipe_pool *pool, size_t max_cached, int pipe_size) {
+    pool->pairs = NULL;
+    pool->count = 0;
+    pool->max_cached = max_cached;
+    pool->pipe_size = pipe_size;
+    pool->warned = 0;
+}
+
+static void close_pair(struct pipe_pair *pair) {
+    close(pair->read_fd);
+    close(pair->write_fd);
+    pair->read_fd = -1;
+    pair->write_fd = -1;
+}
+
+void pipe_pool_destroy(struct pipe_pool *pool) {
+    for (size_t i = 0; i < pool->count; i++) {
+        close_pair(&pool->pairs[i]);
+    }
+    free(pool->pairs);
+    pool->pairs = NULL;
+    pool->count = 0;
+}
+
+int pipe_pool_get(struct pipe_pool *pool, struct pipe_pair *pair) {
+    if (pool->count > 0) {
+        *pair = pool->pairs[--pool->count];
+        return 1;
+    }
+
+    int fds[2];
+    if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) == -1) {
+        LOG_SYSERR("pipe2() failed");
+        return 0;
+    }
+    pair->read_fd = fds[0];
+    pair->write_fd = fds[1];
+
+    if (pool->pipe_size > 0 && fcntl(pair->write_fd, F_SETPIPE_SZ, pool->pipe_size) == -1) {
+        // 비특권 프로세스는 fs.pipe-max-size 를 넘을 수 없다. 기본 크기로 계속 진행한다.
+        if (!pool->warned) {
+            LOG_SYSWARN("fcntl(F_SETPIPE_SZ, %lld) failed, using default pipe size", pool->pipe_size);
+            pool->warned = 1;
+        }
+    }
+    return 1;
+}
+
+void pipe_pool_put(struct pipe_pool *pool, struct pipe_pair *pair, int empty) {
+    if (pair->read_fd == -1) {
+        return;
+    }
+
+    if (!empty || pool->count == pool->max_cached) {
+        close_pair(pair);
+        return;
+    }
+
+    if (pool->pairs == NULL) {
+        pool->pairs = (struct pipe_pair *) malloc(pool->max_cached * sizeof(struct pipe_pair));
+        if (!pool->pairs) {
+            close_pair(pair);
+            return;
+        }
+    }
+    pool->pairs[pool->count++] = *pair;
+    pair->read_fd = -1;
+    pair->write_fd = -1;
+}
@@ -0,0 +1,264 @@
+#include "../include/pubsub.h"
+#include "../include/framing.h"
+#include "../include/log.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define TOPIC_BUCKETS 4096
+
+struct pubsub_msg *pubsub_msg_create(uint8_t type, const char *payload, uint32_t len) {
+    struct pubsub_msg *msg = (struct pubsub_msg *) malloc(sizeof(struct pubsub_msg) + FRAME_HEADER_SIZE + len);
+    if (!msg) {
+        LOG_SYSERR("Memory allocation failed: pubsub message");
+        return NULL;
+    }
+    msg->refs = 1;
+    msg->len = FRAME_HEADER_SIZE + len;
+    frame_encode_header(msg->data, type, len);
+    memcpy(msg->data + FRAME_HEADER_SIZE, payload, len);
+    return msg;
+}
+
+void pubsub_msg_unref(struct pubsub_msg *msg) {
+    if (--msg->refs == 0) {
+        free(msg);
+    }
+}
+
+void msg_queue_init(struct msg_queue *queue) {
+    memset(queue, 0, sizeof(*queue));
+}
+
+void msg_queue_free(struct msg_queue *queue) {
+    for (size_t i = queue->head; i != queue->tail; i++) {
+        pubsub_msg_unref(queue->msgs[i & (queue->capacity - 1)]);
+    }
+    free(queue->msgs);
+    msg_queue_init(queue);
+}
+
+int msg_queue_push(struct msg_queue *queue, struct pubsub_msg *msg) {
+    if (msg_queue_count(queue) == queue->capacity) {
+        size_t new_capacity = queue->capacity ? queue->capacity * 2 : 16;
+        struct pubsub_msg **new_msgs = (struct pubsub_msg **) malloc(new_capacity * sizeof(*new_msgs));
+        if (!new_msgs) {
+            LOG_SYSERR("Memory allocation failed: subscriber queue");
+            return 0;
+        }
+        // 새 배열에 0 부터 다시 깐다
+        size_t count = msg_queue_count(queue);
+        for (size_t i = 0; i < count; i++) {
+            new_msgs[i] = queue->msgs[(queue->head + i) & (queue->capacity - 1)];
+        }
+        free(queue->msgs);
+        queue->msgs = new_msgs;
+        queue->capacity = new_capacity;
+        queue->head = 0;
+        queue->tail = count;
+    }
+
+    pubsub_msg_ref(msg);
+    queue->msgs[queue->tail++ & (queue->capacity - 1)] = msg;
+    queue->bytes += msg->len;
+    return 1;
+}
+
+int msg_queue_fill_iov(const struct msg_queue *queue, struct iovec *iov, int max_iov) {
+    int n = 0;
+    for (size_t i = queue->head; i != queue->tail && n < max_iov; i++, n++) {
+        struct pubsub_msg *msg = queue->msgs[i & (queue->capacity - 1)];
+        size_t skip = i == queue->head ? queue->offset : 0;
+        iov[n].iov_base = msg->data + skip;
+        iov[n].iov_len = msg->len - skip;
+    }
+    return n;
+}
+
+void msg_queue_consume(struct msg_queue *queue, size_t bytes) {
+    queue->bytes -= bytes;
+    while (bytes > 0) {
+        struct pubsub_msg *msg = queue->msgs[queue->head & (queue->capacity - 1)];
+        size_t left = msg->len - queue->offset;
+        if (bytes < left) {
+            queue->offset += bytes;
+            return;
+        }
+        bytes -= left;
+        queue->offset = 0;
+        queue->head++;
+        pubsub_msg_unref(msg);
+    }
+}
+
+size_t msg_queue_drop_oldest(struct msg_queue *queue, size_t limit) {
+    size_t dropped = 0;
+    // 보내는 중인 메시지를 잘라 내면 프레임 경계가 깨지므로 그 다음부터 버린다
+    size_t keep = queue->offset > 0 ? 1 : 0;
+
+    while (queue->bytes > limit && msg_queue_count(queue) > keep) {
+        size_t pos = (queue->head + keep) & (queue->capacity - 1);
+        struct pubsub_msg *msg = queue->msgs[pos];
+        queue->bytes -= msg->len;
+        pubsub_msg_unref(msg);
+        if (keep) {
+            // 맨 앞은 두고 한 칸씩 뒤로 민다
+            queue->msgs[pos] = queue->msgs[queue->head & (queue->capacity - 1)];
+        }
+        queue->head++;
+        dropped++;
+    }
+    return dropped;
+}
+
+// FNV-1a
+static size_t topic_hash(const char *name, size_t len) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char) name[i];
+        hash *= 1099511628211ULL;
+    }
+    return (size_t) hash;
+}
+
+int topic_table_init(struct topic_table *table) {
+    table->buckets = (struct topic **) calloc(TOPIC_BUCKETS, sizeof(struct topic *));
+    if (!table->buckets) {
+        LOG_SYSERR("Memory allocation failed: topic table");
+        return 0;
+    }
+    table->bucket_count = TOPIC_BUCKETS;
+    table->topic_count = 0;
+    return 1;
+}
+
+void topic_table_destroy(struct topic_table *table) {
+    for (size_t i = 0; i < table->bucket_count; i++) {
+        struct topic *topic = table->buckets[i];
+        while (topic) {
+            struct topic *next = topic->next;
+            free(topic->members);
+            free(topic);
+            topic = next;
+        }
+    }
+    free(table->buckets);
+    table->buckets = NULL;
+    table->topic_count = 0;
+}
+
+struct topic *topic_table_find(struct topic_table *table, const char *name, size_t name_len, int create) {
+    if (name_len > PUBSUB_MAX_TOPIC) {
+        return NULL;
+    }
+    struct topic **bucket = &table->buckets[topic_hash(name, name_len) & (table->bucket_count - 1)];
+    for (struct topic *topic = *bucket; topic; topic = topic->next) {
+        if (topic->name_len == name_len && memcmp(topic->name, name, name_len) == 0) {
+            return topic;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+
+    struct topic *topic = (struct topic *) calloc(1, sizeof(struct topic));
+    if (!topic) {
+        LOG_SYSERR("Memory allocation failed: topic");
+        return NULL;
+    }
+    topic->name_len = (uint8_t) name_len;
+    memcpy(topic->name, name, name_len);
+    topic->next = *bucket;
+    *bucket = topic;
+    table->topic_count++;
+    return topic;
+}
+
+// 구독자가 없는 토픽을 테이블에서 지운다
+static void topic_release_if_empty(struct topic_table *table, struct topic *topic) {
+    if (topic->count > 0) {
+        return;
+    }
+    struct topic **link = &table->buckets[topic_hash(topic->name, topic->name_len) & (table->bucket_count - 1)];
+    while (*link != topic) {
+        link = &(*link)->next;
+    }
+    *link = topic->next;
+    table->topic_count--;
+    free(topic->members);
+    free(topic);
+}
+
+size_t subscription_find(const struct subscription_list *list, const struct topic *topic) {
+    size_t slot = 0;
+    while (slot < list->count && list->items[slot].topic != topic) {
+        slot++;
+    }
+    return slot;
+}
+
+int topic_subscribe(struct topic_table *table, struct topic *topic, void *subscriber, struct subscription_list *list) {
+    if (subscription_find(list, topic) < list->count) {
+        return 1;
+    }
+    if (topic->count == topic->capacity) {
+        size_t new_capacity = topic->capacity ? topic->capacity * 2 : 8;
+        struct topic_member *new_members = realloc(topic->members, new_capacity * sizeof(*new_members));
+        if (!new_members) {
+            LOG_SYSERR("Memory allocation failed: topic subscribers");
+            topic_release_if_empty(table, topic);
+            return 0;
+        }
+        topic->members = new_members;
+        topic->capacity = new_capacity;
+    }
+    if (list->count == list->capacity) {
+        size_t new_capacity = list->capacity ? list->capacity * 2 : 4;
+        struct subscription *new_items = realloc(list->items, new_capacity * sizeof(*new_items));
+        if (!new_items) {
+            LOG_SYSERR("Memory allocation failed: subscriptions");
+            topic_release_if_empty(table, topic);
+            return 0;
+        }
+        list->items = new_items;
+        list->capacity = new_capacity;
+    }
+
+    struct topic_member *member = &topic->members[topic->count];
+    member->subscriber = subscriber;
+    member->list = list;
+    member->slot = list->count;
+    list->items[list->count].topic = topic;
+    list->items[list->count].index = topic->count;
+    list->count++;
+    topic->count++;
+    return 1;
+}
+
+void topic_unsubscribe(struct topic_table *table, struct subscription_list *list, size_t slot) {
+    struct topic *topic = list->items[slot].topic;
+    size_t index = list->items[slot].index;
+
+    // 토픽 쪽: 마지막 구독자를 빈 자리로 옮기고, 그 구독자의 목록에 새 위치를 알려 준다
+    struct topic_member *last = &topic->members[--topic->count];
+    if (index != topic->count) {
+        topic->members[index] = *last;
+        last->list->items[last->slot].index = index;
+    }
+
+    // 구독자 쪽: 같은 방법으로 마지막 구독을 빈 자리로 옮긴다
+    struct subscription *moved = &list->items[--list->count];
+    if (slot != list->count) {
+        list->items[slot] = *moved;
+        moved->topic->members[moved->index].slot = slot;
+    }
+
+    topic_release_if_empty(table, topic);
+}
+
+void subscription_list_clear(struct topic_table *table, struct subscription_list *list) {
+    while (list->count > 0) {
+        topic_unsubscribe(table, list, list->count - 1);
+    }
+    free(list->items);
+    subscription_list_init(list);
+}
@@ -0,0 +1,482 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "../include/capture.h"
+#include "../include/histogram.h"
+#include "../include/unix_addr.h"
+
+// 서버가 -w 로 남긴 캡처 파일을 읽어서, 같은 연결들을 같은 시각에 열고 같은 크기(payload 를 기록했으면 같은 바이트)를
+// 보내고 같은 시각에 닫는다. -s 로 시간 간격만 줄일 수 있다. 서버 응답은 읽어서 버리기만 한다.
+// 스레드 하나의 epoll 루프로 돌리고, 예정 시각보다 늦게 낸 정도(schedule lag)를 재서 재생이 정확했는지 보여 준다.
+
+#define SERVER_IP "127.0.0.1"  // 서버 주소
+#define SERVER_PORT 12345       // 서버 포트
+#define BUFFER_SIZE (64 * 1024)
+#define MAX_EVENTS 256
+#define DRAIN_TIMEOUT_NS (2 * 1000000000ULL) // 마지막 이벤트 뒤에 남은 데이터를 보내고 응답을 기다리는 시간
+
+// 캡처에 나온 연결 하나. (worker, conn) 으로 찾는다.
+struct rp_conn {
+    uint64_t key;     // 0 이면 빈 칸
+    int fd;           // 닫았거나 실패했으면 -1
+    int closing;      // CLOSE 를 만났다. 남은 데이터를 다 보내면 송신 쪽을 닫고 서버가 닫기를 기다린다
+    char *pending;    // 아직 못 보낸 데이터
+    size_t pending_len;
+    size_t pending_off;
+    size_t pending_cap;
+};
+
+struct rp_config {
+    const char *host;
+    int port;
+    const char *unix_path; // AF_UNIX 로 들어왔던 연결은 여기로 붙는다 (NULL 이면 모두 TCP)
+    double speed;
+    const char *path;
+};
+
+static struct rp_config config = {
+    .host = SERVER_IP,
+    .port = SERVER_PORT,
+    .unix_path = NULL,
+    .speed = 1.0,
+    .path = NULL,
+};
+
+static struct rp_conn *conns;
+static size_t conn_capacity; // 2의 거듭제곱
+static int epoll_fd;
+static struct sockaddr_storage tcp_addr;
+static socklen_t tcp_addr_len;
+static struct sockaddr_storage unix_addr;
+static socklen_t unix_addr_len;
+static int open_count;       // 아직 닫지 않은 소켓
+static uint64_t connections;
+static uint64_t bytes_tx;
+static uint64_t bytes_rx;
+static uint64_t filler_bytes; // payload 가 없어서 0 으로 채운 바이트
+static uint64_t skipped;      // 연결이 실패했거나 OPEN 이 없어서 낼 수 없었던 이벤트
+static uint64_t errors;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static uint64_t conn_key(const struct capture_record *rec) {
+    return ((uint64_t) rec->worker << 32 | rec->conn) + 1; // 0 은 빈 칸 표시로 쓴다
+}
+
+// splitmix64 의 마무리 단계
+static size_t key_hash(uint64_t key) {
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return (size_t) key;
+}
+
+// create 가 0 이면 없을 때 NULL. 칸은 OPEN 수의 두 배 이상이라 가득 차지 않는다.
+static struct rp_conn *conn_lookup(uint64_t key, int create) {
+    for (size_t i = key_hash(key) & (conn_capacity - 1); ; i = (i + 1) & (conn_capacity - 1)) {
+        if (conns[i].key == key) {
+            return &conns[i];
+        }
+        if (conns[i].key == 0) {
+            if (!create) {
+                return NULL;
+            }
+            conns[i].key = key;
+            return &conns[i];
+        }
+    }
+}
+
+static void close_conn(struct rp_conn *conn) {
+    if (conn->fd == -1) {
+        return;
+    }
+    close(conn->fd); // epoll 에서도 빠진다
+    conn->fd = -1;
+    conn->pending_len = 0;
+    conn->pending_off = 0;
+    open_count--;
+}
+
+static void fail_conn(struct rp_conn *conn, const char *what) {
+    fprintf(stderr, "connection %u/%u: %s: %s\n", (unsigned) ((conn->key - 1) >> 32),
+            (unsigned) ((conn->key - 1) & 0xffffffffu), what, strerror(errno));
+    errors++;
+    close_conn(conn);
+}
+
+static void open_conn(struct rp_conn *conn, uint8_t flags) {
+    int use_unix = (flags & CAPTURE_FLAG_UNIX) && config.unix_path;
+    const struct sockaddr *addr = (const struct sockaddr *) (use_unix ? &unix_addr : &tcp_addr);
+    socklen_t addr_len = use_unix ? unix_addr_len : tcp_addr_len;
+
+    close_conn(conn); // 같은 번호가 다시 나오지는 않지만 앞 연결이 남아 있으면 정리한다
+    int fd = socket(addr->sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        perror("socket() 실패");
+        errors++;
+        return;
+    }
+    if (!use_unix) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // 보낸 시각이 Nagle 에 밀리지 않게
+    }
+    conn->fd = fd;
+    conn->closing = 0;
+    open_count++;
+    connections++;
+    if (connect(fd, addr, addr_len) == -1 && errno != EINPROGRESS && errno != EAGAIN) {
+        fail_conn(conn, "connect() 실패");
+        return;
+    }
+    struct epoll_event ev = {.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data.ptr = conn};
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        fail_conn(conn, "epoll_ctl() 실패");
+    }
+}
+
+// 쌓인 데이터를 EAGAIN 이 날 때까지 보낸다. 남은 것은 EPOLLOUT 에서 이어서 보낸다.
+static void flush_conn(struct rp_conn *conn) {
+    while (conn->fd != -1 && conn->pending_off < conn->pending_len) {
+        ssize_t bytes = send(conn->fd, conn->pending + conn->pending_off, conn->pending_len - conn->pending_off,
+                             MSG_NOSIGNAL);
+        if (bytes > 0) {
+            conn->pending_off += (size_t) bytes;
+            bytes_tx += (uint64_t) bytes;
+        } else if (bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        } else if (bytes == -1 && errno == EINTR) {
+            continue;
+        } else {
+            fail_conn(conn, "send() 실패");
+            return;
+        }
+    }
+    conn->pending_off = 0;
+    conn->pending_len = 0;
+    if (conn->closing == 1) {
+        // FIN 을 보내면 서버는 원래 클라이언트가 닫은 시각에 연결을 닫고, 그 전에 보낸 응답은 끝까지 받는다
+        shutdown(conn->fd, SHUT_WR);
+        conn->closing = 2;
+    }
+}
+
+// 기록된 바이트를 쌓고, 기록되지 않은 나머지는 0 으로 채운다
+static void queue_data(struct rp_conn *conn, const struct capture_record *rec) {
+    if (conn->pending_len + rec->len > conn->pending_cap) {
+        size_t cap = conn->pending_cap ? conn->pending_cap : BUFFER_SIZE;
+        while (cap < conn->pending_len + rec->len) {
+            cap *= 2;
+        }
+        char *grown = (char *) realloc(conn->pending, cap);
+        if (!grown) {
+            fprintf(stderr, "Memory allocation failed: pending data\n");
+            exit(EXIT_FAILURE);
+        }
+        conn->pending = grown;
+        conn->pending_cap = cap;
+    }
+    char *dst = conn->pending + conn->pending_len;
+    memcpy(dst, (const char *) (rec + 1), rec->stored);
+    memset(dst + rec->stored, 0, rec->len - rec->stored);
+    conn->pending_len += rec->len;
+    filler_bytes += rec->len - rec->stored;
+}
+
+static void replay_record(const struct capture_record *rec) {
+    struct rp_conn *conn = conn_lookup(conn_key(rec), rec->type == CAPTURE_OPEN);
+    if (rec->type == CAPTURE_OPEN) {
+        open_conn(conn, rec->flags);
+        return;
+    }
+    if (!conn || conn->fd == -1 || conn->closing) {
+        skipped++;
+        return;
+    }
+    if (rec->type == CAPTURE_DATA) {
+        queue_data(conn, rec);
+        flush_conn(conn);
+    } else if (rec->type == CAPTURE_CLOSE) {
+        conn->closing = 1;
+        flush_conn(conn);
+    }
+}
+
+// timeout_ms 까지 소켓 이벤트를 처리한다. 응답은 읽어서 버린다.
+static void poll_sockets(int timeout_ms) {
+    static char buffer[BUFFER_SIZE];
+    struct epoll_event events[MAX_EVENTS];
+    int count = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout_ms);
+    if (count == -1) {
+        if (errno != EINTR) {
+            perror("epoll_wait() 실패");
+            exit(EXIT_FAILURE);
+        }
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        struct rp_conn *conn = (struct rp_conn *) events[i].data.ptr;
+        if (conn->fd == -1) {
+            continue;
+        }
+        if (events[i].events & EPOLLIN) {
+            while (1) {
+                ssize_t bytes = recv(conn->fd, buffer, sizeof(buffer), 0);
+                if (bytes > 0) {
+                    bytes_rx += (uint64_t) bytes;
+                } else if (bytes == 0) {
+                    close_conn(conn); // CLOSE 전이면 서버가 먼저 닫은 것이다. 남은 이벤트는 건너뛴다
+                    break;
+                } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                } else if (errno != EINTR) {
+                    fail_conn(conn, "recv() 실패");
+                    break;
+                }
+            }
+        }
+        if (conn->fd != -1 && (events[i].events & EPOLLERR)) {
+            int err = 0;
+            socklen_t err_len = sizeof(err);
+            getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &err, &err_len);
+            errno = err;
+            fail_conn(conn, "연결 오류");
+            continue;
+        }
+        if (conn->fd != -1 && (events[i].events & EPOLLOUT)) {
+            flush_conn(conn);
+        }
+    }
+}
+
+// 레코드를 시간 순서로 정렬한다. 같은 시각이면 파일 순서를 지켜서 한 워커 안의 순서가 바뀌지 않게 한다.
+struct rp_event {
+    uint64_t time_ns;
+    size_t index;
+    const struct capture_record *rec;
+};
+
+static int compare_events(const void *a, const void *b) {
+    const struct rp_event *x = (const struct rp_event *) a;
+    const struct rp_event *y = (const struct rp_event *) b;
+    if (x->time_ns != y->time_ns) {
+        return x->time_ns < y->time_ns ? -1 : 1;
+    }
+    return x->index < y->index ? -1 : x->index > y->index;
+}
+
+// 파일을 매핑해서 레코드를 훑는다. 끝이 잘린 레코드(서버가 죽은 경우)는 버린다.
+static struct rp_event *load_capture(const char *path, size_t *event_count, size_t *open_records) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        perror("캡처 파일을 열 수 없습니다");
+        exit(EXIT_FAILURE);
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        perror("fstat() 실패");
+        exit(EXIT_FAILURE);
+    }
+    size_t size = (size_t) st.st_size;
+    struct capture_file_header header;
+    if (size < sizeof(header)) {
+        fprintf(stderr, "Not a capture file: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    const char *data = (const char *) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        perror("mmap() 실패");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+    madvise((void *) data, size, MADV_SEQUENTIAL);
+
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, CAPTURE_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != CAPTURE_FILE_VERSION || header.record_size != sizeof(struct capture_record)) {
+        fprintf(stderr, "Not a capture file or unsupported version: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    size_t capacity = 1024;
+    size_t count = 0;
+    struct rp_event *events = (struct rp_event *) malloc(capacity * sizeof(*events));
+    *open_records = 0;
+    for (size_t offset = sizeof(header); events && offset + sizeof(struct capture_record) <= size; ) {
+        const struct capture_record *rec = (const struct capture_record *) (data + offset);
+        size_t span = capture_record_span(rec);
+        if (rec->stored > rec->len || rec->type > CAPTURE_CLOSE || offset + span > size) {
+            if (offset + span <= size) {
+                fprintf(stderr, "Corrupt record at offset %zu, stopping\n", offset);
+            }
+            break;
+        }
+        if (count == capacity) {
+            capacity *= 2;
+            struct rp_event *grown = (struct rp_event *) realloc(events, capacity * sizeof(*events));
+            if (!grown) {
+                free(events);
+                events = NULL;
+                break;
+            }
+            events = grown;
+        }
+        events[count].time_ns = rec->time_ns;
+        events[count].index = count;
+        events[count].rec = rec;
+        *open_records += rec->type == CAPTURE_OPEN;
+        count++;
+        offset += span;
+    }
+    if (!events) {
+        fprintf(stderr, "Memory allocation failed: capture records\n");
+        exit(EXIT_FAILURE);
+    }
+    qsort(events, count, sizeof(*events), compare_events);
+    *event_count = count;
+    return events;
+}
+
+static void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] FILE\n", prog);
+    fprintf(stderr, "  -a, --address IP      server address (default: %s)\n", SERVER_IP);
+    fprintf(stderr, "  -p, --port PORT       server port (default: %d)\n", SERVER_PORT);
+    fprintf(stderr, "  -U, --unix PATH       replay connections captured on the unix listener to this path, @name for abstract\n");
+    fprintf(stderr, "  -s, --speed X         time scale, 10 replays ten times faster (default: 1)\n");
+}
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        {"address", required_argument, NULL, 'a'},
+        {"port", required_argument, NULL, 'p'},
+        {"unix", required_argument, NULL, 'U'},
+        {"speed", required_argument, NULL, 's'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    int opt_ch;
+    while ((opt_ch = getopt_long(argc, argv, "a:p:U:s:h", long_options, NULL)) != -1) {
+        switch (opt_ch) {
+            case 'a':
+                config.host = optarg;
+                break;
+            case 'p':
+                config.port = atoi(optarg);
+                break;
+            case 'U':
+                config.unix_path = optarg;
+                break;
+            case 's':
+                config.speed = atof(optarg);
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                exit(EXIT_SUCCESS);
+            default:
+                print_usage(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (optind != argc - 1 || config.port <= 0 || config.port > 65535 || !(config.speed > 0)) {
+        print_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    config.path = argv[optind];
+
+    struct sockaddr_in *in_addr = (struct sockaddr_in *) &tcp_addr;
+    in_addr->sin_family = AF_INET;
+    in_addr->sin_port = htons((uint16_t) config.port);
+    if (inet_pton(AF_INET, config.host, &in_addr->sin_addr) <= 0) {
+        fprintf(stderr, "Invalid address: %s\n", config.host);
+        exit(EXIT_FAILURE);
+    }
+    tcp_addr_len = sizeof(*in_addr);
+    if (config.unix_path &&
+        !unix_addr_init(config.unix_path, (struct sockaddr_un *) &unix_addr, &unix_addr_len)) {
+        fprintf(stderr, "Invalid unix socket path: %s\n", config.unix_path);
+        exit(EXIT_FAILURE);
+    }
+
+    size_t event_count;
+    size_t open_records;
+    struct rp_event *events = load_capture(config.path, &event_count, &open_records);
+    conn_capacity = 16;
+    while (conn_capacity < open_records * 2) {
+        conn_capacity *= 2;
+    }
+    conns = (struct rp_conn *) calloc(conn_capacity, sizeof(*conns));
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (!conns || epoll_fd == -1) {
+        perror("초기화 실패");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < conn_capacity; i++) {
+        conns[i].fd = -1; // 빈 칸도 닫힌 연결로 보이게 한다 (fd 0 은 stdin)
+    }
+
+    struct histogram lag;
+    histogram_init(&lag);
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < event_count; i++) {
+        uint64_t due = start + (uint64_t) ((double) events[i].time_ns / config.speed);
+        uint64_t now;
+        // 1ms 보다 많이 남았으면 epoll_wait() 에서 자고, 그 안쪽은 소켓을 돌보며 기다린다 (타이머 해상도 때문)
+        while ((now = now_ns()) < due) {
+            poll_sockets((int) ((due - now) / 1000000));
+        }
+        histogram_record(&lag, now - due);
+        replay_record(events[i].rec);
+    }
+    uint64_t replayed = now_ns();
+
+    // 캡처가 끝날 때까지 열려 있던 연결도 남은 데이터를 보내고 닫는다. 서버가 모두 닫거나 시간이 다 될 때까지 응답을 받는다
+    for (size_t i = 0; i < conn_capacity; i++) {
+        if (conns[i].fd != -1 && !conns[i].closing) {
+            conns[i].closing = 1;
+            flush_conn(&conns[i]);
+        }
+    }
+    uint64_t drain_end = replayed + DRAIN_TIMEOUT_NS;
+    uint64_t now;
+    while (open_count > 0 && (now = now_ns()) < drain_end) {
+        poll_sockets((int) ((drain_end - now + 999999) / 1000000));
+    }
+    for (size_t i = 0; i < conn_capacity; i++) {
+        close_conn(&conns[i]);
+        free(conns[i].pending);
+    }
+
+    double captured = event_count ? events[event_count - 1].time_ns / 1e9 : 0;
+    printf("replayed %zu events on %llu connections in %.3fs (capture %.3fs at %gx)\n", event_count,
+           (unsigned long long) connections, (replayed - start) / 1e9, captured, config.speed);
+    printf("sent %llu bytes (%llu filler), received %llu bytes, skipped %llu events, %llu errors\n",
+           (unsigned long long) bytes_tx, (unsigned long long) filler_bytes, (unsigned long long) bytes_rx,
+           (unsigned long long) skipped, (unsigned long long) errors);
+    histogram_print_ns(stdout, "schedule lag", &lag);
+
+    free(events);
+    free(conns);
+    close(epoll_fd);
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
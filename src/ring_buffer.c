@@ -0,0 +1,66 @@
+#include "../include/ring_buffer.h"
+#include "../include/buffer_pool.h"
+#include <string.h>
+
+void ring_buffer_init(struct ring_buffer *rb) {
+    rb->data = NULL;
+    rb->capacity = 0;
+    rb->head = 0;
+    rb->tail = 0;
+}
+
+void ring_buffer_free(struct ring_buffer *rb) {
+    if (rb->data) {
+        buffer_pool_free(rb->data, rb->capacity);
+    }
+    ring_buffer_init(rb);
+}
+
+// 현재 데이터를 유지한 채 new_capacity 크기의 새 매핑으로 옮긴다
+static int ring_buffer_resize(struct ring_buffer *rb, size_t new_capacity) {
+    size_t length = ring_buffer_length(rb);
+    char *new_data = buffer_pool_alloc(new_capacity);
+    if (!new_data) {
+        return 0;
+    }
+
+    if (length > 0) {
+        memcpy(new_data, ring_buffer_read_ptr(rb), length);
+    }
+    if (rb->data) {
+        buffer_pool_free(rb->data, rb->capacity);
+    }
+
+    rb->data = new_data;
+    rb->capacity = new_capacity;
+    rb->head = 0;
+    rb->tail = length;
+    return 1;
+}
+
+int ring_buffer_reserve(struct ring_buffer *rb, size_t len) {
+    if (ring_buffer_space(rb) >= len) {
+        return 1;
+    }
+
+    // 풀의 크기 등급에 맞춰서 키운다
+    size_t new_capacity = buffer_pool_block_size(ring_buffer_length(rb) + len);
+    return ring_buffer_resize(rb, new_capacity);
+}
+
+int ring_buffer_append(struct ring_buffer *rb, const char *data, size_t len) {
+    if (!ring_buffer_reserve(rb, len)) {
+        return 0;
+    }
+    memcpy(ring_buffer_write_ptr(rb), data, len);
+    ring_buffer_commit(rb, len);
+    return 1;
+}
+
+void ring_buffer_shrink(struct ring_buffer *rb, size_t max_idle_capacity) {
+    if (ring_buffer_length(rb) != 0 || rb->capacity <= max_idle_capacity) {
+        return;
+    }
+    // 비어 있는 블록은 풀에 돌려준다. 다음 쓰기 때 필요한 크기 등급으로 다시 가져온다.
+    ring_buffer_free(rb);
+}
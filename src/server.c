@@ -1,164 +1,1954 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
 #include <netinet/in.h>
-#include <poll.h>
+#include <netinet/tcp.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
 #include "../include/err_handle.h"
+#include "../include/log.h"
+#include "../include/uring_engine.h"
+#include "../include/udp_engine.h"
+#include "../include/ring_buffer.h"
+#include "../include/buffer_pool.h"
+#include "../include/pipe_pool.h"
+#include "../include/conn_table.h"
+#include "../include/framing.h"
+#include "../include/pubsub.h"
+#include "../include/timer_wheel.h"
+#include "../include/stats.h"
+#include "../include/trace.h"
+#include "../include/unix_addr.h"
+#include "../include/shm_ring.h"
+#include "../include/coroutine.h"
+#include "../include/file_cache.h"
+#include "../include/capture.h"
 
 #define PORT 12345
-#define BUFFER_SIZE 4
-#define MAX_CLIENTS 1024
+#define MIN_READ_SIZE 4096
+#define MAX_READ_SIZE (256 * 1024)
+#define DEFAULT_READ_BUDGET (256 * 1024)
+#define MAX_CACHED_PIPES 1024
+#define MAX_EVENTS 256
+#define MAX_WORKERS 256
+#define DEFAULT_HIGH_WATERMARK (1024 * 1024)
+#define DEFAULT_LOW_WATERMARK (256 * 1024)
+#define DEFAULT_SUB_QUEUE_LIMIT (1024 * 1024)
+#define SEND_IOV_MAX 64
+#define TIMER_TICK_MS 10
+#define DEFAULT_SEND_TIMEOUT_MS (60 * 1000)
+#define DEFAULT_BACKLOG 4096   // 커널이 net.core.somaxconn 으로 잘라 낸다
+#define DEFAULT_ACCEPT_BATCH 64 // 한 바퀴에 수락하는 최대 연결 수
+#define ISOLATED_CPUS_PATH "/sys/devices/system/cpu/isolated"
 
-struct client_buffer {
-    char *data;
-    size_t length;
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+
+// epoll 인스턴스별 busy poll 설정 (Linux 6.9). 헤더가 오래됐으면 직접 정의한다.
+#ifndef EPIOCSPARAMS
+struct epoll_params {
+    uint32_t busy_poll_usecs;
+    uint16_t busy_poll_budget;
+    uint8_t prefer_busy_poll;
+    uint8_t __pad;
+};
+#define EPIOCSPARAMS _IOW(0x8A, 0x01, struct epoll_params)
+#endif
+#define EPOLL_BUSY_POLL_BUDGET 64
+
+// 리스닝 소켓은 세대가 0 인 핸들(= 리스너 번호)로 epoll 에 등록한다. 연결 핸들은 세대가 홀수라 겹치지 않는다.
+enum listener_id {
+    LISTENER_TCP,
+    LISTENER_UNIX,
+    LISTENER_COUNT,
+};
+
+// 지연 추적 중인 메시지의 진행 상태
+enum trace_state {
+    TRACE_IDLE,
+    TRACE_RECEIVED, // 표본 수신을 마쳤고 응답을 보내기 전
+    TRACE_SENT,     // 응답을 보냈고 커널 TX 타임스탬프를 기다리는 중
+};
+
+// 코루틴 모드 핸들러가 yield 를 넘어 들고 있는 상태. 연결마다 이것과 타이머 하나가 전부다.
+struct co_frame {
+    struct co co;
+    char header[FRAME_HEADER_SIZE];
+    uint32_t len;
+};
+
+// GET 으로 보낼 파일 하나. 송신 버퍼의 앞선 응답 before 바이트를 보낸 뒤에 offset 부터 이어서 보낸다.
+struct file_send {
+    struct file_send *next;
+    struct file_entry *entry; // 참조를 하나 들고 있다
+    size_t before;
+    size_t offset;
+};
+
+// 연결 상태. event_loop.conns 슬롯에 들어 있고, epoll_event.data.u64 에는 핸들이 담겨서 돌아온다.
+// 이벤트마다 건드리는 필드를 앞쪽에 모았다.
+struct connection {
+    int fd;
+    int read_paused; // 송신 대기 데이터가 high watermark 를 넘어서 읽기를 멈춘 상태
+    int ready_index; // event_loop.ready 안의 위치. 목록에 없으면 -1
+    int write_armed; // EPOLLOUT 을 등록해 둔 상태 (송신이 EAGAIN 으로 멈췄을 때만)
+    size_t read_size; // 한 번에 확보할 수신 공간. 관찰된 메시지 크기에 맞춰 늘고 줄어든다
+    struct ring_buffer buf; // 송신 대기 데이터. 에코 모드에서는 수신 데이터가 바로 여기 쌓인다
+    struct ring_buffer in;  // 프레임 모드의 수신 버퍼. 완성된 프레임은 여기서 바로 파싱된다
+    size_t frame_need;      // 끝에 걸린 미완성 프레임을 채우는 데 더 필요한 바이트
+    uint64_t handle;       // conn_table 핸들
+    struct msg_queue outq; // 구독한 토픽에서 온 메시지. 공유 버퍼를 참조만 한다
+    int flush_pending;     // event_loop.flush 목록에 들어 있음
+    int evict;             // 느린 구독자로 판정되어 다음 flush 때 닫는다
+    int congested;         // block 정책에서 outq 가 한도를 넘은 구독자
+    int publisher;         // PUBLISH 를 보낸 적이 있음
+    int publish_blocked;   // 느린 구독자 때문에 읽기를 멈춘 발행자
+    struct subscription_list subs; // 구독 중인 토픽
+    struct pipe_pair pipe; // splice 에코 모드에서 빌린 파이프 (없으면 -1)
+    size_t pipe_bytes;     // 파이프에 들어 있는 바이트
+    uint64_t last_activity_ms; // 마지막으로 주고받은 시각. 타이머는 만료될 때만 이 값을 보고 다시 건다
+    uint64_t ping_sent_ms;     // keepalive PING 을 보낸 시각 (응답을 기다리지 않으면 0)
+    struct timer idle_timer;   // idle timeout 과 keepalive
+    struct timer send_timer;   // EPOLLOUT 을 건 뒤 송신 버퍼가 비워져야 하는 기한
+    enum trace_state trace_state; // 연결마다 추적하는 메시지는 한 번에 하나
+    struct trace_record trace;
+    struct shm_channel *shm; // 공유 메모리 링 연결이면 링. fd 는 서버 쪽 eventfd 다
+    uint64_t peer_handle;    // 링 연결과 그 링을 붙인 AF_UNIX 연결은 서로를 가리키고, 한쪽이 닫히면 같이 닫힌다
+    int quickack;            // 지연 우선 모드의 TCP 연결. 받을 때마다 TCP_QUICKACK 을 다시 건다
+    int pass_fds;            // recvmsg() 로 SCM_RIGHTS 를 받는 연결 (프레임 모드의 AF_UNIX)
+    int passed_fds[SHM_FD_COUNT]; // 받아 두었지만 아직 SHM_ATTACH 프레임이 가져가지 않은 fd
+    int passed_fd_count;
+    struct file_send *files;      // 보낼 파일 FIFO. 응답 순서를 지키려고 송신 버퍼 사이사이에 끼워 보낸다
+    struct file_send *files_tail;
+    size_t file_bytes;   // files 에 남은 파일 바이트. 송신 대기량에 들어간다
+    size_t files_before; // files 의 before 합. 이보다 뒤에 쌓인 송신 버퍼는 마지막 파일 다음에 나간다
+    uint32_t capture_id;      // 캡처 파일에서 이 연결을 가리키는 번호 (워커 안에서 유일)
+    struct co_frame co_frame; // 코루틴 모드의 핸들러 상태
+    struct timer co_timer;    // co_sleep() 이 끝나면 핸들러를 이어서 실행한다
+};
+
+// 연결 핸들 목록. 처리할 때 conn_table_get() 으로 찾으므로 그 사이 닫힌 연결은 건너뛴다.
+struct handle_list {
+    uint64_t *items;
+    size_t count;
     size_t capacity;
 };
 
-struct client_buffer client_buffers[MAX_CLIENTS] = {0};
-int server_listen_ok = 0;
+// 워커 하나의 epoll 루프 상태
+struct event_loop {
+    int epoll_fd;
+    int listen_fds[LISTENER_COUNT]; // 없는 리스너는 -1
+    // 읽기 예산을 다 써서 EAGAIN 전에 멈춘 연결들. edge 가 다시 오지 않으므로 다음 바퀴에 이어서 읽는다.
+    struct connection **ready;
+    size_t ready_count;
+    size_t ready_capacity;
+    struct pipe_pool pipes;
+    struct conn_table conns;
+    struct topic_table topics;
+    struct file_cache files; // -R 로 파일을 내줄 때만 쓴다
+    struct handle_list flush;   // 다른 연결이 보낼 데이터를 넣어 줘서 루프 끝에 한 번에 보낼 연결
+    struct handle_list blocked; // block 정책으로 읽기를 멈춘 발행자
+    size_t congested;           // outq 가 한도를 넘은 구독자 수
+    struct timer_wheel timers;
+    uint64_t now_ms; // epoll_wait() 에서 돌아올 때마다 갱신하는 단조 시계
+    unsigned accept_pending; // 수락할 연결이 남아 있을 수 있는 리스너 비트 (edge 가 다시 오지 않는다)
+    int spare_fd;       // fd 한도에 닿았을 때 연결을 수락해서 끊으려고 잡아 둔 여분 fd
+    int refusing;       // 수락 거부 중 (로그를 한 번만 남긴다)
+    struct stats_shard *stats; // 이 워커만 쓰는 통계
+    struct tracer *tracer;     // 지연 추적을 켰을 때만 있다
+    uint64_t wake_realtime_ns; // 추적용 epoll_wait() 복귀 시각 (커널 타임스탬프와 같은 시계)
+    struct capture_ring *capture; // 트래픽을 캡처할 때만 있다
+    uint32_t next_capture_id;
+    sig_atomic_t report_seen;
+};
+
+// PUBLISH 를 받은 구독자의 outq 가 한도를 넘었을 때
+enum slow_policy {
+    SLOW_DROP,       // 오래된 메시지부터 버린다
+    SLOW_DISCONNECT, // 구독자 연결을 끊는다
+    SLOW_BLOCK,      // 구독자가 따라올 때까지 발행자의 읽기를 멈춘다
+};
+
+enum engine_type {
+    ENGINE_EPOLL,
+    ENGINE_URING,
+    ENGINE_UDP,
+};
+
+// 서버 실행 옵션
+struct server_config {
+    enum engine_type engine;
+    int threads;
+    int cpus[MAX_WORKERS];
+    int cpu_count;
+    size_t high_watermark; // 송신 대기 데이터가 이만큼 쌓이면 읽기를 멈춘다
+    size_t low_watermark;  // 이만큼 줄어들면 읽기를 다시 시작한다
+    size_t memory_budget;  // 연결 버퍼 전체 메모리 예산 (0 = 무제한)
+    size_t read_budget;    // 한 번 깨어났을 때 연결 하나에서 읽는 최대 바이트 (공정성)
+    int splice_echo;       // 소켓 -> 파이프 -> 소켓으로 user space 복사 없이 에코
+    size_t pipe_size;      // splice 파이프 크기 (0 = 커널 기본값)
+    int framed;            // 길이 접두 프레임 단위로 파싱해서 타입별 핸들러로 넘긴다
+    size_t max_frame;      // 프레임 payload 최대 크기
+    enum slow_policy slow_policy;
+    size_t sub_queue_limit; // 구독자별 outq 한도
+    uint64_t idle_timeout_ms; // 이 시간 동안 주고받은 게 없으면 닫는다 (0 = 끔)
+    uint64_t keepalive_ms;    // 이 시간 동안 조용하면 PING 을 보내고, 다시 이만큼 응답이 없으면 닫는다 (0 = 끔)
+    uint64_t send_timeout_ms; // 송신이 막힌 뒤 이 시간 안에 다 못 보내면 닫는다 (0 = 끔)
+    int backlog;
+    int accept_batch;
+    size_t max_conns;     // 워커당 최대 연결 수 (0 = 무제한)
+    int defer_accept_s;   // TCP_DEFER_ACCEPT: 데이터가 올 때까지 수락을 미루는 시간 (0 = 끔)
+    int fastopen_qlen;    // TCP_FASTOPEN 대기열 길이 (0 = 끔)
+    const char *unix_path;    // TCP 와 함께 받을 AF_UNIX 리스너 경로, '@' 로 시작하면 abstract (NULL = 끔)
+    const char *stats_socket; // 통계를 내보낼 Unix 소켓 경로 (NULL = 끔)
+    uint32_t trace_sample;    // 수신 N 번에 한 번 지연을 추적한다 (0 = 끔)
+    const char *trace_file;   // 추적 기록을 쓸 바이너리 파일 (NULL = 히스토그램만)
+    int trace_fd;
+    struct udp_options udp; // -e udp 일 때만 쓴다
+    uint64_t spin_ns;  // 잠들기 전에 epoll_wait(0) 으로 바쁘게 기다리는 시간. 켜면 지연 우선 모드 (0 = 끔)
+    int busy_poll_us;  // SO_BUSY_POLL 과 epoll busy poll 로 드라이버 큐를 직접 도는 시간 (0 = 끔)
+    const char *file_root;  // GET 으로 내줄 파일이 있는 디렉터리 (NULL = 끔)
+    int file_root_fd;
+    size_t file_cache_size; // 워커마다 캐시해 둘 파일 매핑 크기 합
+    const char *capture_file; // 연결/수신 시각과 크기를 기록할 파일 (NULL = 끔)
+    int capture_payload;      // 받은 바이트도 기록한다
+    int coroutine;     // 프레임을 콜백 대신 연결마다 순서대로 쓴 코루틴 핸들러로 처리한다
+    uint64_t service_time_ms; // 코루틴 핸들러가 응답 전에 co_sleep() 으로 기다리는 시간 (0 = 끔)
+};
+
+// 워커 스레드. 워커끼리 공유하는 상태는 없다.
+struct worker {
+    pthread_t thread;
+    int id;
+    int cpu;
+    int server_fd;
+    int unix_fd; // 모든 워커가 함께 쓰는 AF_UNIX 리스너 (없으면 -1)
+    int ok;
+};
+
+struct server_config config = {
+    .engine = ENGINE_EPOLL,
+    .threads = 1,
+    .cpu_count = 0,
+    .high_watermark = DEFAULT_HIGH_WATERMARK,
+    .low_watermark = DEFAULT_LOW_WATERMARK,
+    .memory_budget = 0,
+    .read_budget = DEFAULT_READ_BUDGET,
+    .splice_echo = 0,
+    .pipe_size = 0,
+    .framed = 0,
+    .max_frame = FRAME_DEFAULT_MAX_PAYLOAD,
+    .slow_policy = SLOW_DROP,
+    .sub_queue_limit = DEFAULT_SUB_QUEUE_LIMIT,
+    .idle_timeout_ms = 0,
+    .keepalive_ms = 0,
+    .send_timeout_ms = DEFAULT_SEND_TIMEOUT_MS,
+    .backlog = DEFAULT_BACKLOG,
+    .accept_batch = DEFAULT_ACCEPT_BATCH,
+    .max_conns = 0,
+    .defer_accept_s = 0,
+    .fastopen_qlen = 0,
+    .unix_path = NULL,
+    .stats_socket = NULL,
+    .trace_sample = 0,
+    .trace_file = NULL,
+    .trace_fd = -1,
+    .udp = {.batch = UDP_DEFAULT_BATCH, .gro = 0},
+    .spin_ns = 0,
+    .busy_poll_us = 0,
+    .file_root = NULL,
+    .file_root_fd = -1,
+    .file_cache_size = FILE_CACHE_DEFAULT_SIZE,
+    .capture_file = NULL,
+    .capture_payload = 0,
+    .coroutine = 0,
+    .service_time_ms = 0,
+};
+
+// 프레임 모드의 타입별 핸들러. main() 에서 채운 뒤에는 읽기만 한다.
+struct frame_dispatcher dispatcher;
+
+// SIGUSR1 을 받으면 다음 루프에서 풀 사용량을 출력한다. 추적 중인 워커는 각자 히스토그램도 출력한다.
+volatile sig_atomic_t pool_report_requested = 0;
+volatile sig_atomic_t report_generation = 0;
+
+void handle_sigusr1(int signo) {
+    (void) signo;
+    pool_report_requested = 1;
+    report_generation++;
+}
+
+uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+// 다음 바퀴에 이어서 읽을 연결로 등록
+int mark_ready(struct event_loop *loop, struct connection *conn) {
+    if (conn->ready_index >= 0) {
+        return 1;
+    }
+    if (loop->ready_count == loop->ready_capacity) {
+        size_t new_capacity = loop->ready_capacity ? loop->ready_capacity * 2 : 64;
+        struct connection **new_ready = realloc(loop->ready, new_capacity * sizeof(*loop->ready));
+        if (!new_ready) {
+            return 0;
+        }
+        loop->ready = new_ready;
+        loop->ready_capacity = new_capacity;
+    }
+    conn->ready_index = (int) loop->ready_count;
+    loop->ready[loop->ready_count++] = conn;
+    return 1;
+}
+
+int handle_list_push(struct handle_list *list, uint64_t handle) {
+    if (list->count == list->capacity) {
+        size_t new_capacity = list->capacity ? list->capacity * 2 : 64;
+        uint64_t *new_items = realloc(list->items, new_capacity * sizeof(*list->items));
+        if (!new_items) {
+            return 0;
+        }
+        list->items = new_items;
+        list->capacity = new_capacity;
+    }
+    list->items[list->count++] = handle;
+    return 1;
+}
+
+// 루프 끝에서 outq 를 보낼 연결로 등록
+int schedule_flush(struct event_loop *loop, struct connection *conn) {
+    if (conn->flush_pending) {
+        return 1;
+    }
+    if (!handle_list_push(&loop->flush, conn->handle)) {
+        return 0;
+    }
+    conn->flush_pending = 1;
+    return 1;
+}
+
+// 한도를 넘었던 구독자가 모두 따라왔으면 멈췄던 발행자들의 읽기를 다시 연다
+void resume_publishers(struct event_loop *loop) {
+    for (size_t i = 0; i < loop->blocked.count; i++) {
+        struct connection *conn = (struct connection *) conn_table_get(&loop->conns, loop->blocked.items[i]);
+        if (conn && conn->publish_blocked) {
+            conn->publish_blocked = 0;
+            mark_ready(loop, conn);
+        }
+    }
+    loop->blocked.count = 0;
+}
+
+void clear_congestion(struct event_loop *loop, struct connection *conn) {
+    if (!conn->congested) {
+        return;
+    }
+    conn->congested = 0;
+    if (--loop->congested == 0) {
+        resume_publishers(loop);
+    }
+}
+
+// 프레임 핸들러에 넘기는 문맥
+struct frame_context {
+    struct event_loop *loop;
+    struct connection *conn;
+};
+
+// 응답 프레임을 송신 버퍼에 넣는다
+int queue_frame(struct connection *conn, uint8_t type, const char *payload, uint32_t len) {
+    struct ring_buffer *out = &conn->buf;
+    if (!ring_buffer_reserve(out, FRAME_HEADER_SIZE + (size_t) len)) {
+        return 0; // 메모리 부족
+    }
+    char *p = ring_buffer_write_ptr(out);
+    frame_encode_header(p, type, len);
+    if (len > 0) {
+        memcpy(p + FRAME_HEADER_SIZE, payload, len);
+    }
+    ring_buffer_commit(out, FRAME_HEADER_SIZE + (size_t) len);
+    return 1;
+}
+
+int handle_echo_frame(void *ctx, const struct frame *frame) {
+    return queue_frame(((struct frame_context *) ctx)->conn, FRAME_TYPE_ECHO, frame->payload, frame->len);
+}
+
+int handle_ping_frame(void *ctx, const struct frame *frame) {
+    (void) frame;
+    return queue_frame(((struct frame_context *) ctx)->conn, FRAME_TYPE_PONG, NULL, 0);
+}
+
+// keepalive 응답. 받은 것 자체로 receive_data() 가 활동 시각을 갱신했으므로 할 일은 없다.
+int handle_pong_frame(void *ctx, const struct frame *frame) {
+    (void) ctx;
+    (void) frame;
+    return 1;
+}
+
+int handle_subscribe_frame(void *ctx, const struct frame *frame) {
+    struct frame_context *fc = (struct frame_context *) ctx;
+    struct connection *conn = fc->conn;
+
+    struct topic *topic = topic_table_find(&fc->loop->topics, frame->payload, frame->len, 1);
+    if (!topic) {
+        return 0; // 이름이 너무 길거나 메모리 부족
+    }
+    return topic_subscribe(&fc->loop->topics, topic, conn, &conn->subs);
+}
+
+int handle_unsubscribe_frame(void *ctx, const struct frame *frame) {
+    struct frame_context *fc = (struct frame_context *) ctx;
+    struct connection *conn = fc->conn;
+
+    struct topic *topic = topic_table_find(&fc->loop->topics, frame->payload, frame->len, 0);
+    if (!topic) {
+        return 1;
+    }
+    size_t slot = subscription_find(&conn->subs, topic);
+    if (slot < conn->subs.count) {
+        topic_unsubscribe(&fc->loop->topics, &conn->subs, slot);
+    }
+    return 1;
+}
+
+// 구독자 하나의 outq 에 메시지 참조를 넣는다. 한도를 넘으면 slow_policy 를 따른다.
+void deliver_message(struct event_loop *loop, struct connection *sub, struct pubsub_msg *msg) {
+    if (sub->evict) {
+        return;
+    }
+
+    if (sub->outq.bytes + msg->len > config.sub_queue_limit) {
+        if (config.slow_policy == SLOW_DISCONNECT) {
+            sub->evict = 1;
+            schedule_flush(loop, sub);
+            return;
+        }
+        if (config.slow_policy == SLOW_DROP) {
+            size_t limit = config.sub_queue_limit > msg->len ? config.sub_queue_limit - msg->len : 0;
+            size_t dropped = msg_queue_drop_oldest(&sub->outq, limit);
+            stats_add(loop->stats, STAT_MESSAGES_DROPPED, dropped);
+            LOG_TRACE("Dropped %lld messages for slow subscriber: %lld", dropped, sub->fd);
+            if (sub->outq.bytes + msg->len > config.sub_queue_limit) {
+                return; // 보내는 중인 메시지만으로 한도가 찼다. 새 메시지를 버린다.
+            }
+        } else if (!sub->congested) {
+            sub->congested = 1;
+            loop->congested++;
+        }
+    }
+
+    if (!msg_queue_push(&sub->outq, msg)) {
+        sub->evict = 1;
+    }
+    schedule_flush(loop, sub);
+}
+
+// payload 를 MESSAGE 프레임으로 한 번만 만들고, 구독자들은 그 버퍼를 참조한다
+int handle_publish_frame(void *ctx, const struct frame *frame) {
+    struct frame_context *fc = (struct frame_context *) ctx;
+
+    if (frame->len < 1 || (size_t) (uint8_t) frame->payload[0] + 1 > frame->len) {
+        return 0; // 형식 오류
+    }
+    fc->conn->publisher = 1;
 
-// 소켓을 논블로킹 모드로 설정
-void set_nonblocking(int sockfd) {
-    int flags = fcntl(sockfd, F_GETFL, 0);
-    fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
+    struct topic *topic = topic_table_find(&fc->loop->topics, frame->payload + 1, (uint8_t) frame->payload[0], 0);
+    if (!topic) {
+        return 1; // 구독자 없음
+    }
+    struct pubsub_msg *msg = pubsub_msg_create(FRAME_TYPE_MESSAGE, frame->payload, frame->len);
+    if (!msg) {
+        return 0;
+    }
+    stats_inc(fc->loop->stats, STAT_MESSAGES_PUBLISHED);
+    for (size_t i = 0; i < topic->count; i++) {
+        deliver_message(fc->loop, (struct connection *) topic->members[i].subscriber, msg);
+    }
+    pubsub_msg_unref(msg);
+    return 1;
 }
 
-void set_cloexec(int sockfd) {
-    int flags = fcntl(sockfd, F_GETFD, 0);
-    fcntl(sockfd, F_SETFD, flags | FD_CLOEXEC);
+// 파일을 FILE 프레임으로 보낸다. 헤더만 송신 버퍼에 넣고, 내용은 보낼 차례가 되면 sendfile() 로 보낸다.
+// 파일이 없거나 root 밖을 가리키거나 프레임 하나에 담을 수 없으면 NOT_FOUND 로 답한다.
+int handle_get_frame(void *ctx, const struct frame *frame) {
+    struct frame_context *fc = (struct frame_context *) ctx;
+    struct event_loop *loop = fc->loop;
+    struct connection *conn = fc->conn;
+
+    int hit;
+    struct file_entry *entry = file_cache_open(&loop->files, frame->payload, frame->len, loop->now_ms, &hit);
+    stats_gauge_set(loop->stats, STAT_GAUGE_FILE_CACHE_BYTES, (int64_t) loop->files.bytes);
+    if (!entry || entry->size > UINT32_MAX) {
+        if (entry) {
+            file_entry_unref(entry);
+        }
+        stats_inc(loop->stats, STAT_FILE_NOT_FOUND);
+        return queue_frame(conn, FRAME_TYPE_NOT_FOUND, frame->payload, frame->len);
+    }
+    stats_inc(loop->stats, hit ? STAT_FILE_CACHE_HITS : STAT_FILE_CACHE_MISSES);
+
+    struct file_send *send = NULL;
+    if (entry->size > 0) {
+        send = (struct file_send *) malloc(sizeof(struct file_send));
+        if (!send) {
+            LOG_SYSERR("Memory allocation failed: file send");
+            file_entry_unref(entry);
+            return 0;
+        }
+    }
+    if (!ring_buffer_reserve(&conn->buf, FRAME_HEADER_SIZE)) {
+        free(send);
+        file_entry_unref(entry);
+        return 0; // 메모리 부족
+    }
+    frame_encode_header(ring_buffer_write_ptr(&conn->buf), FRAME_TYPE_FILE, (uint32_t) entry->size);
+    ring_buffer_commit(&conn->buf, FRAME_HEADER_SIZE);
+    if (!send) {
+        file_entry_unref(entry); // 빈 파일은 헤더가 전부다
+        return 1;
+    }
+
+    send->next = NULL;
+    send->entry = entry;
+    send->before = ring_buffer_length(&conn->buf) - conn->files_before;
+    send->offset = 0;
+    if (conn->files_tail) {
+        conn->files_tail->next = send;
+    } else {
+        conn->files = send;
+    }
+    conn->files_tail = send;
+    conn->files_before += send->before;
+    conn->file_bytes += entry->size;
+    return 1;
 }
 
-// 클라이언트 버퍼 초기화
-int init_client_buffer(int client_fd) {
-    client_buffers[client_fd].data = (char *) malloc(BUFFER_SIZE);
-    if (!client_buffers[client_fd].data) {
+// 수신 버퍼의 완성된 프레임을 모두 처리하고 소비한다. 미완성 프레임은 다음 수신까지 남겨 둔다.
+int dispatch_frames(struct event_loop *loop, struct connection *conn) {
+    struct frame_context ctx = {loop, conn};
+    size_t need;
+    ssize_t used = frame_dispatch(&dispatcher, &ctx, ring_buffer_read_ptr(&conn->in), ring_buffer_length(&conn->in),
+                                  &need);
+    if (used < 0) {
+        return 0; // 프로토콜 오류
+    }
+    ring_buffer_consume(&conn->in, (size_t) used);
+    conn->frame_need = need;
+    return 1;
+}
+
+// 지연 ACK 를 끄고 밀린 ACK 를 바로 보낸다. 커널이 quickack 모드를 스스로 끄므로 한 번 걸어서는 유지되지 않는다.
+void set_quickack(int fd) {
+    int opt = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &opt, sizeof(opt));
+}
+
+// SCM_RIGHTS 로 함께 온 fd 를 passed_fds 에 모으면서 받는다. fd 는 보낸 데이터와 함께 도착하므로
+// 그 데이터(SHM_ATTACH 프레임)를 처리할 때까지 연결에 붙여 둔다. 자리보다 많이 오면 닫고 연결을 끊는다 (0).
+ssize_t recv_with_fds(struct connection *conn, char *data, size_t len) {
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * SHM_FD_COUNT)];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = {data, len};
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    ssize_t bytes = recvmsg(conn->fd, &msg, MSG_CMSG_CLOEXEC);
+    if (bytes <= 0 || msg.msg_controllen == 0) {
+        return bytes;
+    }
+
+    int overflow = (msg.msg_flags & MSG_CTRUNC) != 0; // 넘친 fd 는 커널이 닫았다
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < count; i++) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(fd));
+            if (conn->passed_fd_count < SHM_FD_COUNT) {
+                conn->passed_fds[conn->passed_fd_count++] = fd;
+            } else {
+                close(fd);
+                overflow = 1;
+            }
+        }
+    }
+    if (overflow) {
+        LOG_DEBUG("Too many descriptors passed: %lld", conn->fd);
         return 0;
     }
-    client_buffers[client_fd].length = 0;
-    client_buffers[client_fd].capacity = BUFFER_SIZE;
+    return bytes;
+}
+
+// 캡처 링에 레코드 하나를 넣는다. 캡처 스레드가 밀려도 기다리지 않는다.
+void capture_connection(struct event_loop *loop, struct connection *conn, enum capture_event type, uint8_t flags,
+                        const char *data, size_t len) {
+    enum capture_result result = capture_event(loop->capture, type, conn->capture_id, flags, data, len);
+    if (result == CAPTURE_DROPPED) {
+        stats_inc(loop->stats, STAT_CAPTURE_DROPPED);
+    } else if (result == CAPTURE_TRUNCATED) {
+        stats_inc(loop->stats, STAT_CAPTURE_TRUNCATED);
+    }
+}
+
+// 워터마크와 비교하는 송신 대기량. 보낼 파일도 포함한다.
+size_t queued_output(const struct connection *conn) {
+    return ring_buffer_length(&conn->buf) + conn->file_bytes;
+}
+
+// 클라이언트에서 데이터를 수신해서 송신 버퍼의 빈 공간에 바로 쓴다 (중간 복사 없음)
+// 프레임 모드에서는 수신 버퍼(in)에 쓰고, 읽을 때마다 그 안의 완성된 프레임을 한꺼번에 처리한다.
+// edge-triggered 이므로 EAGAIN 이 나올 때까지 읽되, 한 번에 read_budget 이상은 읽지 않고
+// 나머지는 ready 목록에 넣어 다음 바퀴로 넘긴다.
+// 송신 대기 데이터가 high watermark 를 넘으면 읽기를 멈추고 send_data() 가 풀어줄 때까지 기다린다.
+int receive_data(struct event_loop *loop, struct connection *conn) {
+    struct ring_buffer *buf = config.framed ? &conn->in : &conn->buf;
+    size_t total = 0;
+
+    while (1) {
+        if (queued_output(conn) >= config.high_watermark) {
+            conn->read_paused = 1;
+            return 1;
+        }
+        if (total >= config.read_budget) {
+            return mark_ready(loop, conn);
+        }
+        if (conn->publisher && loop->congested > 0 && config.slow_policy == SLOW_BLOCK) {
+            // 느린 구독자가 따라올 때까지 발행자를 멈춘다. resume_publishers() 가 다시 연다.
+            conn->publish_blocked = 1;
+            return handle_list_push(&loop->blocked, conn->handle);
+        }
+
+        // 큰 프레임이 걸려 있으면 한 번에 다 받을 만큼 잡는다
+        size_t want = conn->frame_need > conn->read_size ? conn->frame_need : conn->read_size;
+        if (!ring_buffer_reserve(buf, want)) {
+            return 0; // 메모리 부족
+        }
+        size_t space = ring_buffer_space(buf);
+
+        ssize_t bytes;
+        if (conn->pass_fds) {
+            bytes = recv_with_fds(conn, ring_buffer_write_ptr(buf), space);
+        } else if (loop->tracer && conn->trace_state == TRACE_IDLE && tracer_should_sample(loop->tracer)) {
+            bytes = trace_recv(conn->fd, ring_buffer_write_ptr(buf), space, &conn->trace.rx_ns);
+            if (bytes > 0 && conn->trace.rx_ns) {
+                conn->trace.wake_ns = loop->wake_realtime_ns;
+                conn->trace.dispatch_ns = realtime_ns();
+                conn->trace_state = TRACE_RECEIVED;
+            } else {
+                tracer_defer_sample(loop->tracer); // 읽은 게 없으면 다음 수신을 표본으로 삼는다
+            }
+        } else {
+            bytes = recv(conn->fd, ring_buffer_write_ptr(buf), space, 0);
+        }
+        stats_inc(loop->stats, STAT_RECV_CALLS);
+
+        if (bytes > 0) {
+            if (loop->capture) {
+                capture_connection(loop, conn, CAPTURE_DATA, 0, ring_buffer_write_ptr(buf), (size_t) bytes);
+            }
+            ring_buffer_commit(buf, bytes);
+            total += bytes;
+            if (conn->quickack && total == (size_t) bytes) {
+                set_quickack(conn->fd); // 깨어날 때마다 한 번
+            }
+            stats_add(loop->stats, STAT_RECV_BYTES, (uint64_t) bytes);
+            conn->last_activity_ms = loop->now_ms;
+            conn->ping_sent_ms = 0;
+            if (config.framed && !dispatch_frames(loop, conn)) {
+                return 0;
+            }
+
+            // 빈 공간을 꽉 채웠으면 다음엔 더 크게, 조금만 찼으면 작게 잡는다
+            if ((size_t) bytes == space && conn->read_size < MAX_READ_SIZE) {
+                conn->read_size *= 2;
+            } else if ((size_t) bytes < conn->read_size / 4 && conn->read_size > MIN_READ_SIZE) {
+                conn->read_size /= 2;
+            }
+        } else if (bytes == 0) {
+            // 클라이언트가 연결 종료
+            // 클라이언트 소켓을 닫고 버퍼를 해제
+            return 0;
+        } else {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                stats_inc(loop->stats, STAT_RECV_EAGAIN);
+                ring_buffer_shrink(buf, 0); // 아무것도 못 읽었다면 빈 블록을 돌려준다
+                return 1; // 소켓을 모두 비움
+            }
+            stats_inc(loop->stats, STAT_RECV_ERRORS);
+            if (!handle_receive_error()) {
+                return 0; // 오류 발생
+            }
+            // 재시도
+        }
+    }
+}
+
+// 보낼 만큼 보낸 뒤. 밀린 양이 줄었으면 멈췄던 읽기와 발행자를 풀어 준다.
+void send_completed(struct event_loop *loop, struct connection *conn) {
+    if (conn->read_paused && queued_output(conn) <= config.low_watermark) {
+        conn->read_paused = 0;
+    }
+    if (conn->congested && conn->outq.bytes <= config.sub_queue_limit / 2) {
+        clear_congestion(loop, conn);
+    }
+
+    // 모두 보냈으면 블록을 풀에 돌려준다. idle 연결은 버퍼 메모리를 잡고 있지 않는다.
+    ring_buffer_shrink(&conn->buf, 0);
+}
+
+// 다 보낸 맨 앞 파일을 놓는다
+void finish_file_send(struct connection *conn) {
+    struct file_send *send = conn->files;
+    conn->files = send->next;
+    if (!conn->files) {
+        conn->files_tail = NULL;
+    }
+    conn->file_bytes -= send->entry->size - send->offset;
+    file_entry_unref(send->entry);
+    free(send);
+}
+
+// 송신 버퍼에서 맨 앞 파일보다 먼저 나가야 할 바이트를 보냈다
+void consume_before_file(struct connection *conn, size_t len) {
+    if (conn->files) {
+        conn->files->before -= len;
+        conn->files_before -= len;
+    }
+}
+
+// 맨 앞 파일을 sendfile() 로 보낸다. 커널이 페이지 캐시에서 소켓으로 바로 옮기므로 user space 를 거치지 않는다.
+// 다 보냈으면 1, 소켓 송신 버퍼가 차서 멈췄으면 0 (다음에 offset 부터 이어진다), 오류면 -1.
+int send_file(struct event_loop *loop, struct connection *conn) {
+    struct file_send *send = conn->files;
+
+    while (send->offset < send->entry->size) {
+        off_t offset = (off_t) send->offset;
+        ssize_t bytes = sendfile(conn->fd, send->entry->fd, &offset, send->entry->size - send->offset);
+        stats_inc(loop->stats, STAT_SEND_CALLS);
+
+        if (bytes > 0) {
+            send->offset += (size_t) bytes;
+            conn->file_bytes -= (size_t) bytes;
+            stats_add(loop->stats, STAT_SEND_BYTES, (uint64_t) bytes);
+            stats_add(loop->stats, STAT_FILE_BYTES, (uint64_t) bytes);
+            conn->last_activity_ms = loop->now_ms;
+        } else if (bytes == 0) {
+            LOG_WARN("Served file was truncated while sending, closing client: %lld", conn->fd);
+            return -1;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            stats_inc(loop->stats, STAT_SEND_EAGAIN);
+            return 0;
+        } else {
+            stats_inc(loop->stats, STAT_SEND_ERRORS);
+            if (!handle_send_error()) {
+                return -1;
+            }
+            // 재시도
+        }
+    }
+
+    finish_file_send(conn);
+    return 1;
+}
+
+// 클라이언트에게 데이터 전송
+// 버퍼가 빌 때까지, 또는 EAGAIN 이 나올 때까지 보낸다. EAGAIN 이면 flush_connection() 이 EPOLLOUT 을 건다.
+// 송신 버퍼 다음에 구독 메시지(outq)를 이어 붙여 sendmsg() 한 번으로 보낸다.
+// GET 한 파일이 있으면 그 앞까지의 응답을 보내고 파일을 sendfile() 로 보낸 뒤 이어 간다.
+int send_data(struct event_loop *loop, struct connection *conn) {
+    struct ring_buffer *buf = &conn->buf;
+
+    while (ring_buffer_length(buf) > 0 || conn->outq.bytes > 0 || conn->files) {
+        if (conn->files && conn->files->before == 0) {
+            int rc = send_file(loop, conn);
+            if (rc < 0) {
+                return 0;
+            }
+            if (rc == 0) {
+                break; // 소켓 송신 버퍼가 가득 참
+            }
+            continue;
+        }
+
+        // 미러링된 매핑 덕분에 링 경계를 넘는 데이터도 iovec 하나로 보낸다
+        struct iovec iov[SEND_IOV_MAX];
+        int iov_count = 0;
+        size_t buffered = conn->files ? conn->files->before : ring_buffer_length(buf);
+        if (buffered > 0) {
+            iov[iov_count].iov_base = ring_buffer_read_ptr(buf);
+            iov[iov_count].iov_len = buffered;
+            iov_count++;
+        }
+        // 파일 앞의 응답만 보낼 때는 구독 메시지를 파일 뒤로 미루고, FILE 헤더가 내용과 같은 세그먼트로 나가게 한다
+        int flags = MSG_NOSIGNAL;
+        if (conn->files) {
+            flags |= MSG_MORE;
+        } else {
+            iov_count += msg_queue_fill_iov(&conn->outq, iov + iov_count, SEND_IOV_MAX - iov_count);
+        }
+
+        struct msghdr msg = {0};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t) iov_count;
+        ssize_t bytes_sent;
+        if (conn->trace_state == TRACE_RECEIVED) {
+            conn->trace.send_ns = realtime_ns();
+            bytes_sent = trace_sendmsg(conn->fd, &msg, flags);
+            if (bytes_sent > 0) {
+                conn->trace_state = TRACE_SENT;
+            }
+        } else {
+            bytes_sent = sendmsg(conn->fd, &msg, flags);
+        }
+        stats_inc(loop->stats, STAT_SEND_CALLS);
+
+        if (bytes_sent > 0) {
+            stats_add(loop->stats, STAT_SEND_BYTES, (uint64_t) bytes_sent);
+            conn->last_activity_ms = loop->now_ms;
+            size_t from_buf = (size_t) bytes_sent < buffered ? (size_t) bytes_sent : buffered;
+            ring_buffer_consume(buf, from_buf);
+            consume_before_file(conn, from_buf);
+            msg_queue_consume(&conn->outq, (size_t) bytes_sent - from_buf);
+        } else if (bytes_sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                stats_inc(loop->stats, STAT_SEND_EAGAIN);
+                break; // 소켓 송신 버퍼가 가득 참
+            }
+            stats_inc(loop->stats, STAT_SEND_ERRORS);
+            if (!handle_send_error()) {
+                return 0; // 오류 발생
+            }
+            // 재시도
+        } else {
+            return 0;
+        }
+    }
+
+    send_completed(loop, conn);
     return 1;
 }
 
-// 클라이언트 버퍼 해제
-void free_client_buffer(int client_fd) {
-    free(client_buffers[client_fd].data);
-    client_buffers[client_fd].data = NULL;
-    client_buffers[client_fd].length = 0;
-    client_buffers[client_fd].capacity = 0;
+// splice 에코 모드의 수신: 소켓 -> 파이프. 데이터는 user space 를 거치지 않는다.
+// 파이프가 가득 차면 읽기를 멈추고, splice_send_data() 가 파이프를 비우면 다시 읽는다.
+int splice_receive_data(struct event_loop *loop, struct connection *conn) {
+    size_t total = 0;
+
+    if (conn->pipe.read_fd == -1 && !pipe_pool_get(&loop->pipes, &conn->pipe)) {
+        return 0;
+    }
+
+    while (1) {
+        if (total >= config.read_budget) {
+            return mark_ready(loop, conn);
+        }
+
+        ssize_t bytes = splice(conn->fd, NULL, conn->pipe.write_fd, NULL, MAX_READ_SIZE,
+                               SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        stats_inc(loop->stats, STAT_RECV_CALLS);
+
+        if (bytes > 0) {
+            stats_add(loop->stats, STAT_RECV_BYTES, (uint64_t) bytes);
+            if (loop->capture) {
+                capture_connection(loop, conn, CAPTURE_DATA, 0, NULL, (size_t) bytes); // 파이프 안의 바이트는 볼 수 없다
+            }
+            conn->pipe_bytes += bytes;
+            total += bytes;
+            conn->last_activity_ms = loop->now_ms;
+        } else if (bytes == 0) {
+            // 클라이언트가 연결 종료
+            return 0;
+        } else {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // 소켓이 비었거나 파이프가 가득 찼다. 파이프에 데이터가 있으면 가득 찬 것으로 보고 멈춘다.
+                stats_inc(loop->stats, STAT_RECV_EAGAIN);
+                if (conn->pipe_bytes > 0) {
+                    conn->read_paused = 1;
+                }
+                return 1;
+            }
+            stats_inc(loop->stats, STAT_RECV_ERRORS);
+            if (!handle_splice_error()) {
+                return 0; // 오류 발생
+            }
+            // 재시도
+        }
+    }
+}
+
+// splice 에코 모드의 송신: 파이프 -> 소켓
+int splice_send_data(struct event_loop *loop, struct connection *conn) {
+    while (conn->pipe_bytes > 0) {
+        ssize_t bytes = splice(conn->pipe.read_fd, NULL, conn->fd, NULL, conn->pipe_bytes,
+                               SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        stats_inc(loop->stats, STAT_SEND_CALLS);
+
+        if (bytes > 0) {
+            stats_add(loop->stats, STAT_SEND_BYTES, (uint64_t) bytes);
+            conn->pipe_bytes -= bytes;
+            conn->last_activity_ms = loop->now_ms;
+        } else if (bytes < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                stats_inc(loop->stats, STAT_SEND_EAGAIN);
+                return 1; // 소켓 송신 버퍼가 가득 참
+            }
+            stats_inc(loop->stats, STAT_SEND_ERRORS);
+            if (!handle_splice_error()) {
+                return 0; // 오류 발생
+            }
+            // 재시도
+        } else {
+            return 0;
+        }
+    }
+
+    // 파이프를 모두 비웠으면 읽기를 다시 열고 파이프는 풀에 돌려준다
+    conn->read_paused = 0;
+    pipe_pool_put(&loop->pipes, &conn->pipe, 1);
+    return 1;
 }
 
-// 데이터를 버퍼에 추가
-int append_to_buffer(int client_fd, const char *data, size_t len, struct pollfd *fds, int nfds) {
-    struct client_buffer *buf = &client_buffers[client_fd];
+// 링 연결의 수신: 클라이언트가 쓴 프레임을 공유 링 안에서 그대로 파싱한다 (복사 없음).
+// 미러링된 매핑이라 링 경계에 걸친 프레임도 연속된 view 로 핸들러에 넘어간다. 공간은 핸들러가
+// 돌아온 뒤에야 클라이언트에 돌려준다. 링을 비웠으면 잠든다고 표시하고, 클라이언트가 쓰면 eventfd 로 깨운다.
+int shm_receive_data(struct event_loop *loop, struct connection *conn) {
+    struct shm_channel *shm = conn->shm;
+    size_t total = 0;
+
+    shm_channel_clear_wakeup(shm);
+    while (1) {
+        if (queued_output(conn) >= config.high_watermark) {
+            conn->read_paused = 1;
+            return 1;
+        }
+        if (total >= config.read_budget) {
+            return mark_ready(loop, conn);
+        }
+        if (conn->publisher && loop->congested > 0 && config.slow_policy == SLOW_BLOCK) {
+            conn->publish_blocked = 1;
+            return handle_list_push(&loop->blocked, conn->handle);
+        }
+
+        size_t len;
+        const char *data = shm_channel_read_ptr(shm, &len);
+        if (!data) {
+            return 0; // 클라이언트가 링 인덱스를 망가뜨렸다
+        }
+
+        struct frame_context ctx = {loop, conn};
+        size_t need = 0;
+        ssize_t used = len > 0 ? frame_dispatch(&dispatcher, &ctx, data, len, &need) : 0;
+        if (used < 0) {
+            return 0; // 프로토콜 오류
+        }
+        if (used == 0) {
+            if (len + need > shm->size) {
+                return 0; // 링에 다 들어갈 수 없는 프레임
+            }
+            // 비었거나 미완성 프레임만 남았다. 그 사이 더 왔으면 이어서 처리한다.
+            if (shm_channel_park_reader(shm, len)) {
+                return 1;
+            }
+            continue;
+        }
+
+        if (shm_channel_consume(shm, (size_t) used)) {
+            stats_inc(loop->stats, STAT_SHM_WAKEUPS);
+        }
+        total += (size_t) used;
+        stats_add(loop->stats, STAT_RECV_BYTES, (uint64_t) used);
+        conn->last_activity_ms = loop->now_ms;
+        conn->ping_sent_ms = 0;
+    }
+}
+
+// 링 연결의 송신: 송신 버퍼와 outq 를 클라이언트 쪽 링에 복사한다. 링이 가득 차면 멈추고,
+// flush_connection() 이 잠든다고 표시해 두면 클라이언트가 읽은 뒤 깨운다.
+// GET 한 파일은 sendfile() 대신 pread() 로 링에 바로 읽어 넣는다.
+int shm_send_data(struct event_loop *loop, struct connection *conn) {
+    struct ring_buffer *buf = &conn->buf;
+
+    while (ring_buffer_length(buf) > 0 || conn->outq.bytes > 0 || conn->files) {
+        size_t space;
+        char *out = shm_channel_write_ptr(conn->shm, queued_output(conn) + conn->outq.bytes, &space);
+        if (!out) {
+            return 0; // 클라이언트가 링 인덱스를 망가뜨렸다
+        }
+        if (space == 0) {
+            break;
+        }
+
+        size_t copied;
+        if (conn->files && conn->files->before == 0) {
+            struct file_send *send = conn->files;
+            size_t left = send->entry->size - send->offset;
+            ssize_t bytes = pread(send->entry->fd, out, left < space ? left : space, (off_t) send->offset);
+            if (bytes <= 0) {
+                if (bytes < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (bytes == 0) {
+                    LOG_WARN("Served file was truncated while sending, closing client: %lld", conn->fd);
+                } else {
+                    LOG_SYSWARN("pread() of a served file failed, closing client: %lld", conn->fd);
+                }
+                return 0;
+            }
+            copied = (size_t) bytes;
+            send->offset += copied;
+            conn->file_bytes -= copied;
+            stats_add(loop->stats, STAT_FILE_BYTES, (uint64_t) copied);
+            if (send->offset == send->entry->size) {
+                finish_file_send(conn);
+            }
+        } else {
+            size_t buffered = conn->files ? conn->files->before : ring_buffer_length(buf);
+            copied = buffered < space ? buffered : space;
+            if (copied > 0) {
+                memcpy(out, ring_buffer_read_ptr(buf), copied);
+                ring_buffer_consume(buf, copied);
+                consume_before_file(conn, copied);
+            }
+        }
+        if (!conn->files && copied < space && conn->outq.bytes > 0) {
+            struct iovec iov[SEND_IOV_MAX];
+            int iov_count = msg_queue_fill_iov(&conn->outq, iov, SEND_IOV_MAX);
+            size_t queued = 0;
+            for (int i = 0; i < iov_count && copied < space; i++) {
+                size_t n = iov[i].iov_len < space - copied ? iov[i].iov_len : space - copied;
+                memcpy(out + copied, iov[i].iov_base, n);
+                copied += n;
+                queued += n;
+            }
+            msg_queue_consume(&conn->outq, queued);
+        }
+
+        if (shm_channel_commit(conn->shm, copied)) {
+            stats_inc(loop->stats, STAT_SHM_WAKEUPS);
+        }
+        stats_add(loop->stats, STAT_SEND_BYTES, (uint64_t) copied);
+        conn->last_activity_ms = loop->now_ms;
+    }
+
+    send_completed(loop, conn);
+    return 1;
+}
+
+// 보낼 데이터가 남아 있는지
+int has_pending_output(const struct connection *conn) {
+    if (config.splice_echo) {
+        return conn->pipe_bytes > 0;
+    }
+    return ring_buffer_length(&conn->buf) > 0 || conn->outq.bytes > 0 || conn->files;
+}
+
+// 쓰기 관심(EPOLLOUT) 등록/해제. EPOLL_CTL_MOD 는 이미 쓸 수 있는 상태면 바로 이벤트를 올려 준다.
+// 송신이 막힌 동안에는 send_timer 를 걸어 두고, 기한 안에 다 보내지 못하면 느린 클라이언트로 보고 닫는다.
+int set_write_interest(struct event_loop *loop, struct connection *conn, int enable) {
+    // 링 연결에는 EPOLLOUT 이 없다. 대신 flush_connection() 이 보낼 때마다 잠든다고 표시한다.
+    struct epoll_event ev = {0};
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET | (enable ? EPOLLOUT : 0);
+    ev.data.u64 = conn->handle;
+    if (!conn->shm && epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev) == -1) {
+        stats_inc(loop->stats, STAT_EPOLL_ERRORS);
+        return handle_epoll_error() ? 1 : 0;
+    }
+    conn->write_armed = enable;
+
+    if (!enable) {
+        timer_cancel(&loop->timers, &conn->send_timer);
+    } else if (config.send_timeout_ms > 0) {
+        timer_arm(&loop->timers, &conn->send_timer, loop->now_ms + config.send_timeout_ms);
+    }
+    return 1;
+}
+
+// 송신 대기열을 보낸다. 소켓이 EAGAIN 을 돌려줬을 때만 EPOLLOUT 을 걸고, 다 보내면 푼다.
+int flush_connection(struct event_loop *loop, struct connection *conn) {
+    int was_paused = conn->read_paused;
+    int ok;
+    if (conn->shm) {
+        ok = shm_send_data(loop, conn);
+    } else {
+        ok = config.splice_echo ? splice_send_data(loop, conn) : send_data(loop, conn);
+    }
+    if (!ok) {
+        return 0;
+    }
+
+    int pending = has_pending_output(conn);
+    if (pending != conn->write_armed && !set_write_interest(loop, conn, pending)) {
+        return 0;
+    }
+    // 링의 잠든 표시는 깨울 때 지워지므로 링이 찰 때마다 다시 건다. 그 사이 공간이 생겼으면 다음 바퀴에 보낸다.
+    if (pending && conn->shm && !shm_channel_park_writer(conn->shm) && !mark_ready(loop, conn)) {
+        return 0;
+    }
+
+    // 멈췄던 읽기가 풀렸다면 그 사이 EPOLLIN edge 는 이미 지나갔으므로 다음 바퀴에 이어서 읽는다
+    if (was_paused && !conn->read_paused) {
+        return mark_ready(loop, conn);
+    }
+    return 1;
+}
+
+// 코루틴 모드의 연결 핸들러. 프레임 하나를 끝까지 읽고, 처리 시간만큼 잠든 뒤, 응답을 다 보내고 다음 프레임으로 간다.
+// 콜백 대신 순서대로 쓴 코드이고, EAGAIN 이나 잠들 때는 이벤트 루프로 돌아갔다가 같은 자리에서 이어진다.
+// 응답은 송신 버퍼에 만들고 payload 도 그 자리로 바로 받는다. 지원하는 타입은 ECHO 와 PING 뿐이다.
+enum co_status co_frame_handler(struct event_loop *loop, struct connection *conn) {
+    struct co_frame *f = &conn->co_frame;
+    struct ring_buffer *out = &conn->buf;
+    struct co_stream io = {conn->fd, &conn->in, conn->read_size, loop->stats};
+    size_t handled = 0; // 이번에 깨어나서 처리한 바이트. 연결 하나가 루프를 독차지하지 않게 한다
+
+    CO_BEGIN(&f->co);
+    while (1) {
+        co_read_exact(&f->co, &io, f->header, FRAME_HEADER_SIZE);
+        f->len = frame_decode_length(f->header);
+        if (f->len > config.max_frame ||
+            (f->header[4] != FRAME_TYPE_ECHO && f->header[4] != FRAME_TYPE_PING)) {
+            LOG_DEBUG("Frame protocol error in coroutine mode: %lld", conn->fd);
+            return CO_ERROR;
+        }
+        if (!ring_buffer_reserve(out, FRAME_HEADER_SIZE + (size_t) f->len)) {
+            return CO_ERROR; // 메모리 부족
+        }
+
+        co_read_exact(&f->co, &io, ring_buffer_write_ptr(out) + FRAME_HEADER_SIZE, f->len);
+        if (f->header[4] == FRAME_TYPE_PING) {
+            frame_encode_header(ring_buffer_write_ptr(out), FRAME_TYPE_PONG, 0);
+            ring_buffer_commit(out, FRAME_HEADER_SIZE);
+        } else {
+            frame_encode_header(ring_buffer_write_ptr(out), FRAME_TYPE_ECHO, f->len);
+            ring_buffer_commit(out, FRAME_HEADER_SIZE + (size_t) f->len);
+        }
+
+        if (config.service_time_ms > 0) {
+            co_sleep(&f->co, loop->now_ms, config.service_time_ms);
+        }
+
+        co_write_all(&f->co, &io, ring_buffer_read_ptr(out), ring_buffer_length(out));
+        ring_buffer_consume(out, ring_buffer_length(out));
+        ring_buffer_shrink(out, 0);
+
+        handled += FRAME_HEADER_SIZE + (size_t) f->len;
+        if (handled >= config.read_budget) {
+            CO_YIELD_STATUS(&f->co, CO_YIELD);
+        }
+    }
+    CO_END(&f->co);
+}
+
+// 코루틴을 이어서 실행하고, 멈춘 이유에 맞춰 다시 깨울 조건을 건다. 0 이면 연결을 닫는다.
+// EPOLLOUT 은 송신을 기다릴 때만 걸어 두고, 그 동안은 send_timer 가 느린 클라이언트를 걸러 낸다.
+int resume_handler(struct event_loop *loop, struct connection *conn) {
+    conn->last_activity_ms = loop->now_ms;
+    switch (co_frame_handler(loop, conn)) {
+        case CO_WAIT_READ:
+            return !conn->write_armed || set_write_interest(loop, conn, 0);
+        case CO_WAIT_WRITE:
+            return conn->write_armed || set_write_interest(loop, conn, 1);
+        case CO_WAIT_TIMER:
+            timer_arm(&loop->timers, &conn->co_timer, conn->co_frame.co.wake_ms);
+            return !conn->write_armed || set_write_interest(loop, conn, 0);
+        case CO_YIELD:
+            return mark_ready(loop, conn);
+        default:
+            return 0; // CO_DONE, CO_ERROR
+    }
+}
+
+// 읽을 수 있는 만큼 읽고, EPOLLOUT 을 기다리지 않고 바로 보낸다.
+// 한 번 읽은 데이터(프레임 여러 개의 응답 포함)는 sendmsg() 한 번으로 나간다.
+// 받은 데이터가 아직 캐시에 있을 때 보내는 게 유리하므로 루프 끝까지 미루지 않는다.
+// 다른 연결이 만든 데이터(발행된 메시지)는 schedule_flush() 로 모아서 루프 끝에 한 번 보낸다.
+int process_io(struct event_loop *loop, struct connection *conn, int readable) {
+    if (config.coroutine) {
+        return resume_handler(loop, conn); // 무엇을 기다리는지는 코루틴이 알고 있다
+    }
+    if (readable && !conn->read_paused && !conn->publish_blocked) {
+        int ok;
+        if (conn->shm) {
+            ok = shm_receive_data(loop, conn);
+        } else {
+            ok = config.splice_echo ? splice_receive_data(loop, conn) : receive_data(loop, conn);
+        }
+        if (!ok) {
+            return 0;
+        }
+    }
+
+    if (has_pending_output(conn) || conn->write_armed || conn->read_paused) {
+        return flush_connection(loop, conn);
+    }
+    return 1;
+}
+
+// 에러 큐에 쌓인 TX 타임스탬프를 꺼내서 추적 중인 메시지를 마무리한다.
+// 타임스탬프가 에러 큐로 오면 EPOLLERR 가 올라오므로, 소켓 자체에 오류가 없으면 1 을 반환해서 연결을 살린다.
+int collect_tx_timestamps(struct event_loop *loop, struct connection *conn) {
+    uint64_t tx_ns;
+    int rc;
+    while ((rc = trace_read_tx(conn->fd, &tx_ns)) > 0) {
+        if (conn->trace_state == TRACE_SENT && tx_ns) {
+            conn->trace.tx_ns = tx_ns;
+            conn->trace.worker = (uint32_t) loop->tracer->worker;
+            conn->trace.conn = conn_handle_index(conn->handle);
+            tracer_complete(loop->tracer, &conn->trace);
+            conn->trace_state = TRACE_IDLE;
+        }
+    }
+
+    int err = 0;
+    socklen_t len = sizeof(err);
+    getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+    return rc == 0 && err == 0;
+}
+
+// 연결 해제
+void close_connection(struct event_loop *loop, struct connection *conn) {
+    timer_cancel(&loop->timers, &conn->idle_timer);
+    timer_cancel(&loop->timers, &conn->send_timer);
+    timer_cancel(&loop->timers, &conn->co_timer);
+    // 발행자를 다시 열면서 ready 목록에 넣을 수 있으므로 ready 정리보다 먼저 한다
+    clear_congestion(loop, conn);
+    subscription_list_clear(&loop->topics, &conn->subs);
+    if (loop->capture && !conn->shm) {
+        capture_connection(loop, conn, CAPTURE_CLOSE, 0, NULL, 0);
+    }
+    msg_queue_free(&conn->outq);
+    while (conn->files) {
+        finish_file_send(conn);
+    }
+
+    // close() 하면 epoll 등록도 함께 해제되지만, dup 된 fd 가 있을 수 있으므로 명시적으로 제거
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    if (conn->ready_index >= 0) {
+        loop->ready[conn->ready_index] = NULL;
+    }
+    if (conn->shm) {
+        shm_channel_close(conn->shm); // conn->fd 인 eventfd 도 여기서 닫힌다
+        free(conn->shm);
+    } else {
+        close(conn->fd);
+    }
+    for (int i = 0; i < conn->passed_fd_count; i++) {
+        close(conn->passed_fds[i]);
+    }
+    ring_buffer_free(&conn->buf);
+    ring_buffer_free(&conn->in);
+    pipe_pool_put(&loop->pipes, &conn->pipe, conn->pipe_bytes == 0);
+    uint64_t peer_handle = conn->peer_handle;
+    conn_table_free(&loop->conns, conn->handle);
+    stats_inc(loop->stats, STAT_CONN_CLOSED);
+    stats_gauge_add(loop->stats, STAT_GAUGE_CONNECTIONS, -1);
+
+    // 링과 제어용 소켓은 같이 닫는다. 이 연결의 핸들은 이미 무효라 짝 쪽에서 다시 돌아오지 않는다.
+    struct connection *peer = (struct connection *) conn_table_get(&loop->conns, peer_handle);
+    if (peer) {
+        close_connection(loop, peer);
+    }
+}
+
+// 다음에 idle_timer 를 봐야 할 시각에 건다. 주고받을 때마다 다시 걸지 않고, 만료됐을 때
+// last_activity_ms 를 보고 아직 기한이 남았으면 그때 다시 건다.
+void arm_idle_timer(struct event_loop *loop, struct connection *conn) {
+    uint64_t deadline = UINT64_MAX;
+    if (config.idle_timeout_ms > 0) {
+        deadline = conn->last_activity_ms + config.idle_timeout_ms;
+    }
+    if (config.keepalive_ms > 0) {
+        uint64_t base = conn->ping_sent_ms ? conn->ping_sent_ms : conn->last_activity_ms;
+        if (base + config.keepalive_ms < deadline) {
+            deadline = base + config.keepalive_ms;
+        }
+    }
+    if (deadline != UINT64_MAX) {
+        timer_arm(&loop->timers, &conn->idle_timer, deadline);
+    }
+}
+
+void idle_timer_expired(struct timer *timer, void *arg) {
+    struct event_loop *loop = (struct event_loop *) arg;
+    struct connection *conn = TIMER_ENTRY(timer, struct connection, idle_timer);
+    int client_fd = conn->fd;
+
+    if (config.idle_timeout_ms > 0 && loop->now_ms - conn->last_activity_ms >= config.idle_timeout_ms) {
+        close_connection(loop, conn);
+        stats_inc(loop->stats, STAT_CONN_TIMED_OUT);
+        LOG_DEBUG("Idle client disconnected: %lld", client_fd);
+        return;
+    }
+
+    if (config.keepalive_ms > 0) {
+        if (conn->ping_sent_ms && loop->now_ms - conn->ping_sent_ms >= config.keepalive_ms) {
+            close_connection(loop, conn);
+            stats_inc(loop->stats, STAT_CONN_TIMED_OUT);
+            LOG_DEBUG("Keepalive timed out: %lld", client_fd);
+            return;
+        }
+        if (!conn->ping_sent_ms && loop->now_ms - conn->last_activity_ms >= config.keepalive_ms) {
+            // 응답(PONG 이든 무엇이든)이 오면 receive_data() 가 ping_sent_ms 를 지운다
+            if (!queue_frame(conn, FRAME_TYPE_PING, NULL, 0) || !schedule_flush(loop, conn)) {
+                close_connection(loop, conn);
+                return;
+            }
+            conn->ping_sent_ms = loop->now_ms;
+        }
+    }
+
+    arm_idle_timer(loop, conn);
+}
+
+void send_timer_expired(struct timer *timer, void *arg) {
+    struct event_loop *loop = (struct event_loop *) arg;
+    struct connection *conn = TIMER_ENTRY(timer, struct connection, send_timer);
+    int client_fd = conn->fd;
+
+    close_connection(loop, conn);
+    stats_inc(loop->stats, STAT_CONN_EVICTED);
+    LOG_DEBUG("Slow client evicted, send buffer not drained: %lld", client_fd);
+}
+
+void co_timer_expired(struct timer *timer, void *arg) {
+    struct event_loop *loop = (struct event_loop *) arg;
+    struct connection *conn = TIMER_ENTRY(timer, struct connection, co_timer);
+    int client_fd = conn->fd;
+
+    if (!resume_handler(loop, conn)) {
+        close_connection(loop, conn);
+        LOG_DEBUG("Client disconnected: %lld", client_fd);
+    }
+}
+
+// 수락한 연결을 RST 로 바로 끊는다. FIN 으로 닫으면 서버 쪽에 TIME_WAIT 이 쌓인다.
+// message 는 LOG_WARN 의 포맷 문자열로 그대로 쓰므로 인자 없는 정적 문자열이어야 한다.
+void refuse_connection(struct event_loop *loop, int client_fd, const char *message) {
+    struct linger lg = {1, 0};
+    setsockopt(client_fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    close(client_fd);
+    stats_inc(loop->stats, STAT_CONN_REFUSED);
+    if (!loop->refusing) {
+        loop->refusing = 1;
+        LOG_WARN(message);
+    }
+}
+
+// 새 연결 하나를 받을 여유가 있는지. 없으면 거부할 때 남길 로그 메시지를 돌려준다.
+const char *admission_check(struct event_loop *loop) {
+    if (config.max_conns > 0 && conn_table_count(&loop->conns) >= config.max_conns) {
+        return "Refusing new connections: connection limit reached";
+    }
+    if (config.memory_budget > 0 && !buffer_pool_has_room(buffer_pool_block_size(MIN_READ_SIZE))) {
+        return "Refusing new connections: memory budget exhausted";
+    }
+    return NULL;
+}
+
+// conn_table 에서 막 잡은 슬롯을 fd 하나짜리 연결로 채운다
+void init_connection(struct event_loop *loop, struct connection *conn, int fd, uint64_t handle) {
+    conn->fd = fd;
+    conn->handle = handle;
+    conn->read_paused = 0;
+    conn->ready_index = -1;
+    conn->read_size = MIN_READ_SIZE;
+    conn->pipe.read_fd = -1;
+    conn->pipe.write_fd = -1;
+    conn->pipe_bytes = 0;
+    // 버퍼 메모리는 처음 데이터가 들어올 때 잡는다
+    ring_buffer_init(&conn->buf);
+    ring_buffer_init(&conn->in);
+    conn->frame_need = 0;
+    msg_queue_init(&conn->outq);
+    subscription_list_init(&conn->subs);
+    conn->last_activity_ms = loop->now_ms;
+    conn->ping_sent_ms = 0;
+    conn->trace_state = TRACE_IDLE;
+    conn->shm = NULL;
+    conn->peer_handle = CONN_HANDLE_NONE;
+    conn->pass_fds = 0;
+    conn->passed_fd_count = 0;
+    conn->files = NULL;
+    conn->files_tail = NULL;
+    conn->file_bytes = 0;
+    conn->files_before = 0;
+    conn->capture_id = loop->next_capture_id++;
+    timer_init(&conn->idle_timer, idle_timer_expired);
+    timer_init(&conn->send_timer, send_timer_expired);
+    co_init(&conn->co_frame.co);
+    timer_init(&conn->co_timer, co_timer_expired);
+}
+
+// 공유 메모리 링으로 옮긴다. 프레임과 함께 온 memfd 와 eventfd 로 링을 붙이고, 서버 쪽 eventfd 를
+// 새 연결로 epoll 에 등록해서 소켓과 똑같이 다룬다. 원래 연결은 그 뒤로 수명 관리에만 쓴다.
+// 빈 SHM_ATTACH 로 응답하면 클라이언트가 링을 쓰기 시작한다.
+int handle_shm_attach_frame(void *ctx, const struct frame *frame) {
+    struct frame_context *fc = (struct frame_context *) ctx;
+    struct event_loop *loop = fc->loop;
+    struct connection *conn = fc->conn;
+    (void) frame;
+
+    if (conn->passed_fd_count != SHM_FD_COUNT || conn->peer_handle != CONN_HANDLE_NONE) {
+        return 0; // fd 없이 왔거나 (TCP, 링 위에서 보냄) 이미 옮겼다
+    }
+    conn->passed_fd_count = 0;
+    struct shm_channel *shm = (struct shm_channel *) malloc(sizeof(*shm));
+    if (!shm) {
+        for (int i = 0; i < SHM_FD_COUNT; i++) {
+            close(conn->passed_fds[i]);
+        }
+        return 0;
+    }
+    if (!shm_channel_attach(shm, conn->passed_fds)) {
+        free(shm);
+        return 0;
+    }
+
+    uint64_t handle;
+    struct connection *ring = (struct connection *) conn_table_alloc(&loop->conns, &handle);
+    if (!ring) {
+        shm_channel_close(shm);
+        free(shm);
+        return 0;
+    }
+    init_connection(loop, ring, shm->wait_fd, handle);
+    ring->shm = shm;
+
+    struct epoll_event ev = {0};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.u64 = handle;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, ring->fd, &ev) == -1) {
+        stats_inc(loop->stats, STAT_EPOLL_ERRORS);
+        handle_epoll_error();
+        shm_channel_close(shm);
+        free(shm);
+        conn_table_free(&loop->conns, handle);
+        return 0;
+    }
+    ring->peer_handle = conn->handle;
+    conn->peer_handle = handle;
+    // 소켓은 조용해지므로 idle/keepalive 는 링 연결이 맡는다
+    timer_cancel(&loop->timers, &conn->idle_timer);
+    arm_idle_timer(loop, ring);
+    stats_inc(loop->stats, STAT_SHM_ATTACHED);
+    stats_gauge_add(loop->stats, STAT_GAUGE_CONNECTIONS, 1);
+    LOG_DEBUG("Client switched to shared memory rings: %lld (%lld bytes each)", conn->fd, shm->size);
+
+    // 한 번 비워 보고 잠들어야 클라이언트가 쓸 때 깨운다
+    return mark_ready(loop, ring) && queue_frame(conn, FRAME_TYPE_SHM_ATTACH, NULL, 0);
+}
+
+// 리스너 하나에서 대기 중인 연결을 accept4() 로 EAGAIN 이 나올 때까지 수락한다 (fcntl 없이 NONBLOCK|CLOEXEC).
+// 한 바퀴에 accept_batch 개까지만 받고, 나머지는 accept_pending 을 세워 다음 바퀴로 넘겨서
+// 연결 폭주 중에도 기존 연결의 I/O 가 밀리지 않게 한다.
+// 연결 수나 메모리 예산이 꽉 찼으면 받자마자 끊어서 클라이언트가 대기열에서 기다리지 않게 한다.
+void accept_connections(struct event_loop *loop, enum listener_id listener) {
+    int listen_fd = loop->listen_fds[listener];
+    loop->accept_pending &= ~(1u << listener);
+
+    for (int accepted = 0; ; accepted++) {
+        if (accepted == config.accept_batch) {
+            loop->accept_pending |= 1u << listener;
+            return;
+        }
+
+        int client_fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_fd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return;
+            }
+            if ((errno == EMFILE || errno == ENFILE) && loop->spare_fd >= 0) {
+                // 여분 fd 를 잠시 내놓고 받아서 끊는다. 그러지 않으면 대기열이 비지 않아 계속 깨어난다.
+                close(loop->spare_fd);
+                client_fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+                if (client_fd >= 0) {
+                    refuse_connection(loop, client_fd, "Refusing new connections: file descriptor limit reached");
+                }
+                loop->spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                continue;
+            }
+            stats_inc(loop->stats, STAT_ACCEPT_ERRORS);
+            if (handle_accept_error()) {
+                continue;
+            }
+            return;
+        }
+
+        const char *reason = admission_check(loop);
+        if (reason) {
+            refuse_connection(loop, client_fd, reason);
+            continue;
+        }
+
+        uint64_t handle;
+        struct connection *conn = (struct connection *) conn_table_alloc(&loop->conns, &handle);
+        if (!conn) {
+            refuse_connection(loop, client_fd, "Refusing new connections: connection table allocation failed");
+            continue;
+        }
+        loop->refusing = 0;
+        init_connection(loop, conn, client_fd, handle);
+        if (loop->tracer && listener == LISTENER_TCP) {
+            trace_enable_socket(client_fd); // AF_UNIX 에는 커널 타임스탬프가 없다
+        }
+        // 공유 메모리 링은 AF_UNIX 로만 넘겨받을 수 있다
+        conn->pass_fds = listener == LISTENER_UNIX && config.framed;
+        conn->quickack = listener == LISTENER_TCP && config.spin_ns > 0;
+        if (conn->quickack) {
+            set_quickack(client_fd);
+        }
+
+        struct epoll_event ev = {0};
+        // EPOLLOUT 은 송신이 EAGAIN 으로 막혔을 때만 건다
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        ev.data.u64 = handle;
+        if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, client_fd, &ev) == -1) {
+            stats_inc(loop->stats, STAT_EPOLL_ERRORS);
+            handle_epoll_error();
+            close(client_fd);
+            conn_table_free(&loop->conns, handle);
+            continue;
+        }
+        if (loop->capture) {
+            capture_connection(loop, conn, CAPTURE_OPEN, listener == LISTENER_UNIX ? CAPTURE_FLAG_UNIX : 0, NULL, 0);
+        }
+        arm_idle_timer(loop, conn);
+        stats_inc(loop->stats, STAT_CONN_ACCEPTED);
+        stats_gauge_add(loop->stats, STAT_GAUGE_CONNECTIONS, 1);
+
+        LOG_DEBUG("New client connected: %lld", client_fd);
+    }
+}
+
+// ready 목록의 연결들을 이어서 처리한다. 처리 중 다시 등록된 연결은 다음 바퀴로 넘어간다.
+void process_ready_list(struct event_loop *loop) {
+    size_t count = loop->ready_count;
+
+    for (size_t i = 0; i < count; i++) {
+        struct connection *conn = loop->ready[i];
+        if (conn == NULL) {
+            continue; // 그 사이 닫힌 연결
+        }
+        conn->ready_index = -1;
+        loop->ready[i] = NULL;
+
+        int client_fd = conn->fd;
+        if (!process_io(loop, conn, 1)) {
+            close_connection(loop, conn);
+            LOG_DEBUG("Client disconnected: %lld", client_fd);
+        }
+    }
+
+    // 새로 등록된 것들을 앞으로 당긴다
+    size_t remaining = loop->ready_count - count;
+    for (size_t i = 0; i < remaining; i++) {
+        loop->ready[i] = loop->ready[count + i];
+        if (loop->ready[i]) {
+            loop->ready[i]->ready_index = (int) i;
+        }
+    }
+    loop->ready_count = remaining;
+}
+
+// 이번 바퀴에 발행된 메시지가 쌓인 연결들을 한 번씩 보낸다. 느린 구독자로 판정된 연결은 여기서 닫는다.
+void flush_connections(struct event_loop *loop) {
+    for (size_t i = 0; i < loop->flush.count; i++) {
+        struct connection *conn = (struct connection *) conn_table_get(&loop->conns, loop->flush.items[i]);
+        if (conn == NULL) {
+            continue; // 그 사이 닫힌 연결
+        }
+        conn->flush_pending = 0;
+
+        int client_fd = conn->fd;
+        if (conn->evict) {
+            close_connection(loop, conn);
+            stats_inc(loop->stats, STAT_CONN_EVICTED);
+            LOG_DEBUG("Slow subscriber disconnected: %lld", client_fd);
+        } else if (!flush_connection(loop, conn)) {
+            close_connection(loop, conn);
+            LOG_DEBUG("Client disconnected: %lld", client_fd);
+        }
+    }
+    loop->flush.count = 0;
+}
+
+// 이벤트를 기다린다. 지연 우선 모드에서는 바로 잠들지 않고 spin_ns 동안 epoll_wait(0) 을 돌려서
+// 그 안에 온 이벤트를 스케줄러 wakeup 없이 처리한다. CPU 를 태우는 대신 꼬리 지연을 줄이는 선택이다.
+int wait_events(struct event_loop *loop, struct epoll_event *events, int timeout) {
+    if (timeout != 0 && config.spin_ns > 0) {
+        uint64_t start = monotonic_ns();
+        uint64_t spin_end = start + config.spin_ns;
+        if (timeout > 0 && start + (uint64_t) timeout * 1000000 < spin_end) {
+            spin_end = start + (uint64_t) timeout * 1000000; // 타이머 시각을 넘겨서 돌지 않는다
+        }
+        uint64_t now;
+        do {
+            int rc = epoll_wait(loop->epoll_fd, events, MAX_EVENTS, 0);
+            now = monotonic_ns();
+            if (rc != 0) {
+                stats_add(loop->stats, STAT_LOOP_SPIN_NS, now - start);
+                if (rc > 0) {
+                    stats_inc(loop->stats, STAT_LOOP_SPIN_HITS);
+                }
+                return rc;
+            }
+        } while (now < spin_end);
+        stats_add(loop->stats, STAT_LOOP_SPIN_NS, now - start);
+
+        if (timeout > 0) {
+            uint64_t spent_ms = (now - start) / 1000000;
+            if (spent_ms >= (uint64_t) timeout) {
+                return 0; // 도는 사이 타이머 시각이 됐다
+            }
+            timeout -= (int) spent_ms;
+        }
+    }
+    if (timeout != 0) {
+        stats_inc(loop->stats, STAT_LOOP_SLEEPS);
+    }
+    return epoll_wait(loop->epoll_fd, events, MAX_EVENTS, timeout);
+}
+
+// 바쁜 대기가 잠을 얼마나 피했는지. 이 비율과 돈 시간을 보고 -y 값을 고른다.
+void report_spin(FILE *out, const struct event_loop *loop) {
+    uint64_t hits = __atomic_load_n(&loop->stats->counters[STAT_LOOP_SPIN_HITS], __ATOMIC_RELAXED);
+    uint64_t sleeps = __atomic_load_n(&loop->stats->counters[STAT_LOOP_SLEEPS], __ATOMIC_RELAXED);
+    uint64_t spin_ns = __atomic_load_n(&loop->stats->counters[STAT_LOOP_SPIN_NS], __ATOMIC_RELAXED);
+    uint64_t waits = hits + sleeps;
+    fprintf(out, "[spin] worker %d: %llu spin hits, %llu sleeps (%.1f%% of waits without sleeping), %.3f s spinning\n",
+            loop->stats->worker, (unsigned long long) hits, (unsigned long long) sleeps,
+            waits ? (double) hits * 100.0 / (double) waits : 0.0, (double) spin_ns / 1e9);
+    fflush(out);
+}
+
+// epoll(EPOLLET) 이벤트 루프
+int run_epoll_engine(int server_fd, int unix_fd, struct stats_shard *stats) {
+    struct event_loop loop = {0};
+    loop.listen_fds[LISTENER_TCP] = server_fd;
+    loop.listen_fds[LISTENER_UNIX] = unix_fd;
+    loop.stats = stats;
+    if (config.trace_sample > 0) {
+        loop.tracer = (struct tracer *) malloc(sizeof(struct tracer));
+        if (!loop.tracer || !tracer_init(loop.tracer, stats->worker, config.trace_sample, config.trace_fd)) {
+            LOG_SYSERR("Memory allocation failed: tracer");
+            free(loop.tracer);
+            return 0;
+        }
+    }
+    loop.now_ms = monotonic_ns() / 1000000;
+    timer_wheel_init(&loop.timers, loop.now_ms, TIMER_TICK_MS);
+    pipe_pool_init(&loop.pipes, MAX_CACHED_PIPES, (int) config.pipe_size);
+    conn_table_init(&loop.conns, sizeof(struct connection), config.max_conns);
+    loop.spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (config.framed && !topic_table_init(&loop.topics)) {
+        return 0;
+    }
+    if (config.file_root && !file_cache_init(&loop.files, config.file_root_fd, config.file_cache_size)) {
+        return 0;
+    }
+    if (config.capture_file && !(loop.capture = capture_register(stats->worker))) {
+        return 0;
+    }
+    loop.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop.epoll_fd == -1) {
+        handle_epoll_error();
+        return 0;
+    }
+    if (config.busy_poll_us > 0) {
+        // epoll_wait() 가 잠들기 전에 연결들이 붙은 NIC 큐를 직접 돈다
+        struct epoll_params params = {0};
+        params.busy_poll_usecs = (uint32_t) config.busy_poll_us;
+        params.busy_poll_budget = EPOLL_BUSY_POLL_BUDGET;
+        params.prefer_busy_poll = 1;
+        if (ioctl(loop.epoll_fd, EPIOCSPARAMS, &params) == -1) {
+            LOG_SYSWARN("ioctl(EPIOCSPARAMS) failed, epoll busy poll falls back to net.core.busy_poll");
+        }
+    }
+
+    for (int i = 0; i < LISTENER_COUNT; i++) {
+        if (loop.listen_fds[i] < 0) {
+            continue;
+        }
+        struct epoll_event listen_ev = {0};
+        listen_ev.events = EPOLLIN | EPOLLET;
+        // AF_UNIX 리스너는 워커들이 하나를 같이 쓰므로 연결마다 워커 하나만 깨운다
+        if (i == LISTENER_UNIX) {
+            listen_ev.events |= EPOLLEXCLUSIVE;
+        }
+        listen_ev.data.u64 = (uint64_t) i;
+        if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, loop.listen_fds[i], &listen_ev) == -1) {
+            handle_epoll_error();
+            close(loop.epoll_fd);
+            return 0;
+        }
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+
+    while (1) {
+        if (pool_report_requested) {
+            pool_report_requested = 0;
+            buffer_pool_report(stdout);
+        }
+        if (loop.report_seen != report_generation) {
+            loop.report_seen = report_generation;
+            if (loop.tracer) {
+                tracer_report(stdout, loop.tracer);
+                tracer_flush(loop.tracer);
+            }
+            if (config.spin_ns > 0) {
+                report_spin(stdout, &loop);
+            }
+        }
+
+        // 이어서 읽을 연결이 남아 있으면 기다리지 않는다. 아니면 다음 타이머까지만 잔다 (타이머가 없으면 무한정).
+        int timeout = loop.ready_count > 0 || loop.accept_pending ? 0 : timer_wheel_timeout_ms(&loop.timers, loop.now_ms);
+
+        const int rc = wait_events(&loop, events, timeout);
+        uint64_t wake_ns = monotonic_ns();
+        loop.now_ms = wake_ns / 1000000;
+        if (loop.tracer) {
+            loop.wake_realtime_ns = realtime_ns();
+        }
+        if (rc < 0) {
+            stats_inc(loop.stats, STAT_EPOLL_ERRORS);
+            if (handle_epoll_error()) {
+                continue;
+            }
+            break;
+        }
+
+        LOG_TRACE("epoll event: %lld fds", rc);
+
+        // 준비된 fd 만 순회 (O(ready))
+        for (int i = 0; i < rc; i++) {
+            uint64_t handle = events[i].data.u64;
+            uint32_t revents = events[i].events;
+
+            if (handle < LISTENER_COUNT) {
+                loop.accept_pending |= 1u << handle; // 기존 연결의 이벤트를 먼저 처리하고 받는다
+                continue;
+            }
+
+            struct connection *conn = (struct connection *) conn_table_get(&loop.conns, handle);
+            if (conn == NULL) {
+                continue; // 이미 닫힌 연결의 이벤트
+            }
+
+            int client_fd = conn->fd;
+            LOG_TRACE("fd=%lld, revents=%llu", client_fd, revents);
+
+            if ((revents & EPOLLERR) && loop.tracer && collect_tx_timestamps(&loop, conn)) {
+                revents &= ~EPOLLERR; // 타임스탬프만 왔다
+            }
+
+            if (revents & (EPOLLIN | EPOLLOUT)) {
+                if (!process_io(&loop, conn, revents & EPOLLIN)) {
+                    close_connection(&loop, conn);
+                    LOG_DEBUG("Client disconnected: %lld", client_fd);
+                    continue;
+                }
+                LOG_TRACE("Processed data for client: %lld", client_fd);
+            }
+
+            if (revents & (EPOLLERR | EPOLLHUP)) {
+                close_connection(&loop, conn);
+                LOG_DEBUG("Client disconnected (error): %lld", client_fd);
+            }
+        }
 
-    if (buf->length + len > buf->capacity) {
-        size_t new_capacity = buf->capacity * 2;
-        char *new_data = (char *) realloc(buf->data, new_capacity);
-        if (!new_data) {
-            return 0;
+        for (int i = 0; i < LISTENER_COUNT; i++) {
+            if (loop.accept_pending & (1u << i)) {
+                accept_connections(&loop, (enum listener_id) i);
+            }
         }
-        buf->data = new_data;
-        buf->capacity = new_capacity;
-    }
+        timer_wheel_advance(&loop.timers, loop.now_ms, &loop);
+        process_ready_list(&loop);
+        flush_connections(&loop);
 
-    // 기존 데이터 뒤에 새로운 데이터 추가
-    memcpy(buf->data + buf->length, data, len);
-    buf->length += len;
+        stats_gauge_set(loop.stats, STAT_GAUGE_TIMERS, (int64_t) loop.timers.count);
+        stats_gauge_set(loop.stats, STAT_GAUGE_TOPICS, (int64_t) loop.topics.topic_count);
+        stats_observe_loop(loop.stats, monotonic_ns() - wake_ns);
+    }
 
-    // 버퍼에 데이터가 존재하므로 POLLOUT 활성화
-    for (int i = 0; i < nfds; i++) {
-        if (fds[i].fd == client_fd) {
-            fds[i].events |= POLLOUT;
-            break;
-        }
+    if (loop.tracer) {
+        tracer_destroy(loop.tracer);
+        free(loop.tracer);
     }
+    free(loop.ready);
+    pipe_pool_destroy(&loop.pipes);
+    conn_table_destroy(&loop.conns);
+    topic_table_destroy(&loop.topics);
+    if (config.file_root) {
+        file_cache_destroy(&loop.files);
+    }
+    free(loop.flush.items);
+    free(loop.blocked.items);
+    if (loop.spare_fd >= 0) {
+        close(loop.spare_fd);
+    }
+    close(loop.epoll_fd);
 
     return 1;
 }
 
-// 클라이언트에서 데이터를 수신하고 버퍼에 저장
-int receive_data(int client_fd, struct pollfd *fds, int nfds) {
-    char buffer[BUFFER_SIZE];
-    ssize_t bytes = recv(client_fd, buffer, sizeof(buffer), 0);
+// 연결 수는 fd 한도가 막는다. soft limit 을 hard limit 까지 올린다.
+void raise_fd_limit(void) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == -1) {
+        LOG_SYSWARN("getrlimit(RLIMIT_NOFILE) failed");
+        return;
+    }
+    if (rl.rlim_cur == rl.rlim_max) {
+        return;
+    }
+    rl.rlim_cur = rl.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &rl) == -1) {
+        LOG_SYSWARN("setrlimit(RLIMIT_NOFILE) failed");
+        return;
+    }
+    LOG_INFO("Open file limit raised to %lld", rl.rlim_cur);
+}
 
-    if (bytes > 0) {
-        if (!append_to_buffer(client_fd, buffer, bytes, fds, nfds)) {
-            return 0; // 메모리 부족
+// 지연 우선 모드의 소켓 옵션. 리스너에 걸면 수락한 소켓이 물려받으므로 연결마다 다시 걸지 않는다.
+void set_latency_options(int fd) {
+    int opt = 1;
+    if (config.spin_ns > 0 && setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt)) < 0) {
+        LOG_SYSWARN("setsockopt(TCP_NODELAY) failed");
+    }
+    if (config.busy_poll_us > 0) {
+        if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &config.busy_poll_us, sizeof(int)) < 0) {
+            LOG_SYSWARN("setsockopt(SO_BUSY_POLL) failed, values above net.core.busy_poll need CAP_NET_ADMIN");
         }
-        return 1;
-    } else if (bytes == 0) {
-        // 클라이언트가 연결 종료
-        // 클라이언트 소켓을 닫고 버퍼를 해제
-        return 0;
-    } else {
-        if (!handle_receive_error()) {
-            return 0; // 오류 발생
-        } else {
-            return 1; // 재시도
+        if (setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &opt, sizeof(opt)) < 0) {
+            LOG_SYSWARN("setsockopt(SO_PREFER_BUSY_POLL) failed");
         }
     }
 }
 
-// 클라이언트에게 데이터 전송
-int send_data(int client_fd, struct pollfd *fds, int nfds) {
-    struct client_buffer *buf = &client_buffers[client_fd];
+// 리스닝 소켓 생성. 실패하면 -1 을 반환한다.
+// reuseport 가 켜져 있으면 워커마다 같은 포트에 소켓을 따로 열고 커널이 연결을 분산한다.
+int create_listen_socket(int reuseport) {
+    int server_fd = -1;
+    int listen_ok = 0;
+
+    do {
+        server_fd = socket(AF_INET, SOCK_STREAM | O_NONBLOCK | O_CLOEXEC, 0);
+        if (server_fd == -1) {
+            if (handle_socket_error()) {
+                continue;
+            }
+            return -1;
+        }
 
-    if (buf->length == 0) return 1; // 보낼 데이터 없음
+        int opt = 1;
+        if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+            if (handle_setsockopt_error()) {
+                close(server_fd);
+                continue;
+            }
+            close(server_fd);
+            return -1;
+        }
 
-    ssize_t bytes_sent = send(client_fd, buf->data, buf->length, 0);
+        if (reuseport && setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+            if (handle_setsockopt_error()) {
+                close(server_fd);
+                continue;
+            }
+            close(server_fd);
+            return -1;
+        }
 
-    if (bytes_sent > 0) {
-        memmove(buf->data, buf->data + bytes_sent, buf->length - bytes_sent);
-        buf->length -= bytes_sent;
+        struct sockaddr_in server_addr = {0};
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_addr.s_addr = INADDR_ANY;
+        server_addr.sin_port = htons(PORT);
 
-        // 데이터가 모두 전송되었으면 POLLOUT 비활성화
-        if (buf->length == 0) {
-            for (int i = 0; i < nfds; i++) {
-                if (fds[i].fd == client_fd) {
-                    fds[i].events &= ~POLLOUT;
-                    // TODO: buf->data 초기화
-                    break;
-                }
+        if (bind(server_fd, (struct sockaddr *) &server_addr, sizeof(server_addr)) == -1) {
+            if (handle_bind_error()) {
+                close(server_fd);
+                continue;
             }
+            close(server_fd);
+            return -1;
         }
-        return 1;
-    } else if (bytes_sent < 0) {
-        if (!handle_send_error()) {
-            return 0; // 오류 발생
-        } else {
-            return 1; // 재시도
+
+        // 둘 다 없어도 동작하므로 실패하면 경고만 남긴다
+        if (config.defer_accept_s > 0 &&
+            setsockopt(server_fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &config.defer_accept_s, sizeof(int)) < 0) {
+            LOG_SYSWARN("setsockopt(TCP_DEFER_ACCEPT) failed");
+        }
+        if (config.fastopen_qlen > 0 &&
+            setsockopt(server_fd, IPPROTO_TCP, TCP_FASTOPEN, &config.fastopen_qlen, sizeof(int)) < 0) {
+            LOG_SYSWARN("setsockopt(TCP_FASTOPEN) failed");
+        }
+
+        if (config.spin_ns > 0 || config.busy_poll_us > 0) {
+            set_latency_options(server_fd);
+        }
+
+        if (listen(server_fd, config.backlog) == -1) {
+            if (handle_listen_error()) {
+                close(server_fd);
+                continue;
+            }
+            close(server_fd);
+            return -1;
         }
-    }
 
-    return 0;
+        // server listen success
+        listen_ok = 1;
+    } while (!listen_ok);
+
+    return server_fd;
 }
 
-int main() {
-    struct pollfd fds[MAX_CLIENTS] = {0};
-    int nfds = -1;
+// UDP 소켓 생성. 실패하면 -1 을 반환한다.
+// reuseport 가 켜져 있으면 워커마다 소켓을 따로 열고 커널이 보내는 쪽 주소/포트로 datagram 을 분산한다.
+int create_udp_socket(int reuseport) {
     int server_fd = -1;
+    int bind_ok = 0;
 
     do {
-        server_fd = socket(AF_INET, SOCK_STREAM | O_NONBLOCK | O_CLOEXEC, 0);
+        server_fd = socket(AF_INET, SOCK_DGRAM | O_NONBLOCK | O_CLOEXEC, 0);
         if (server_fd == -1) {
             if (handle_socket_error()) {
                 continue;
             }
-            exit(EXIT_FAILURE);
+            return -1;
         }
 
         int opt = 1;
-        if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        if (reuseport && setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
             if (handle_setsockopt_error()) {
                 close(server_fd);
                 continue;
             }
             close(server_fd);
-            exit(EXIT_FAILURE);
+            return -1;
         }
 
         struct sockaddr_in server_addr = {0};
@@ -172,120 +1962,750 @@ int main() {
                 continue;
             }
             close(server_fd);
-            exit(EXIT_FAILURE);
+            return -1;
+        }
+
+        bind_ok = 1;
+    } while (!bind_ok);
+
+    return server_fd;
+}
+
+// AF_UNIX 리스닝 소켓 생성. 실패하면 -1 을 반환한다.
+// SO_REUSEPORT 가 없으므로 하나만 열고 모든 워커의 epoll 에 EPOLLEXCLUSIVE 로 등록한다.
+int create_unix_socket(const char *path) {
+    struct sockaddr_un addr;
+    socklen_t addr_len;
+    if (!unix_addr_init(path, &addr, &addr_len)) {
+        LOG_ERROR("Unix socket path too long (max %lld)", sizeof(addr.sun_path) - 1);
+        return -1;
+    }
+    if (!unix_addr_is_abstract(path)) {
+        unlink(path); // 이전 실행이 남긴 소켓 파일
+    }
+
+    int server_fd = -1;
+    int listen_ok = 0;
+
+    do {
+        server_fd = socket(AF_UNIX, SOCK_STREAM | O_NONBLOCK | O_CLOEXEC, 0);
+        if (server_fd == -1) {
+            if (handle_socket_error()) {
+                continue;
+            }
+            return -1;
+        }
+
+        if (bind(server_fd, (struct sockaddr *) &addr, addr_len) == -1) {
+            if (handle_bind_error()) {
+                close(server_fd);
+                continue;
+            }
+            close(server_fd);
+            return -1;
         }
 
-        if (listen(server_fd, 10) == -1) {
+        if (listen(server_fd, config.backlog) == -1) {
             if (handle_listen_error()) {
                 close(server_fd);
                 continue;
             }
             close(server_fd);
-            exit(EXIT_FAILURE);
+            return -1;
         }
 
-        // init fds for server_fd
-        nfds = 1;
-        fds[0].fd = server_fd;
-        fds[0].events = POLLIN;
+        listen_ok = 1;
+    } while (!listen_ok);
 
-        // server listen success
-        server_listen_ok = 1;
-    } while (!server_listen_ok);
+    return server_fd;
+}
 
-    printf("Server listening on port %d\n", PORT);
+// 워커 스레드 본체. 워커마다 자신의 리스닝 소켓, 이벤트 루프, 연결 상태를 가진다.
+void *worker_main(void *arg) {
+    struct worker *w = (struct worker *) arg;
 
-    while (1) {
-        printf("-------------------------------\n");
-        const int rc = poll(fds, nfds, 5000);
-        if (rc < 0) {
-            if (handle_poll_error()) {
-                continue;
+    if (w->cpu >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(w->cpu, &cpuset);
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+        if (rc != 0) {
+            errno = rc;
+            LOG_SYSWARN("worker %lld: failed to pin to CPU %lld", w->id, w->cpu);
+        }
+    }
+
+    struct stats_shard *stats = stats_register(w->id);
+    if (!stats) {
+        w->ok = 0;
+        return NULL;
+    }
+
+    if (config.engine == ENGINE_URING) {
+        w->ok = run_uring_engine(w->server_fd, stats);
+    } else if (config.engine == ENGINE_UDP) {
+        w->ok = run_udp_engine(w->server_fd, stats, &config.udp);
+    } else {
+        w->ok = run_epoll_engine(w->server_fd, w->unix_fd, stats);
+    }
+
+    buffer_pool_thread_release();
+
+    return NULL;
+}
+
+// "0,2,4-7" 형식의 CPU 목록을 파싱
+int parse_cpu_list(const char *str, int *cpus, int max_cpus) {
+    int count = 0;
+    const char *p = str;
+
+    while (*p) {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0) {
+            return -1;
+        }
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first) {
+                return -1;
             }
-            break;
         }
-        if (rc == 0) {
-            printf("poll timeout\n");
-            continue;
+        for (long cpu = first; cpu <= last; cpu++) {
+            if (count == max_cpus) {
+                return -1;
+            }
+            cpus[count++] = (int) cpu;
+        }
+        if (*end == ',') {
+            end++;
+        } else if (*end != '\0') {
+            return -1;
         }
+        p = end;
+    }
 
-        printf("poll event: %d fds\n", rc);
+    return count;
+}
 
-        for (int i = 0; i < nfds; i++) {
-            printf("fd=%d, events=%d, revents=%d\n", fds[i].fd, fds[i].events, fds[i].revents);
+// isolcpus= 로 스케줄러에서 떼어 둔 CPU 목록. 없거나 비었으면 0.
+int read_isolated_cpus(int *cpus, int max_cpus) {
+    FILE *f = fopen(ISOLATED_CPUS_PATH, "r");
+    if (!f) {
+        return 0;
+    }
+    char line[1024];
+    int count = 0;
+    if (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = '\0';
+        if (line[0] != '\0') {
+            count = parse_cpu_list(line, cpus, max_cpus);
+        }
+    }
+    fclose(f);
+    return count > 0 ? count : 0;
+}
 
-            if (fds[i].revents == 0) {
-                // 이벤트 없음
-                continue;
-            }
+// "64K", "1M" 같은 크기 문자열을 파싱. 실패하면 0 을 반환한다.
+size_t parse_size(const char *str) {
+    char *end;
+    unsigned long long value = strtoull(str, &end, 10);
+    if (end == str) {
+        return 0;
+    }
+    switch (*end) {
+        case 'k': case 'K': value *= 1024ULL; end++; break;
+        case 'm': case 'M': value *= 1024ULL * 1024; end++; break;
+        case 'g': case 'G': value *= 1024ULL * 1024 * 1024; end++; break;
+        default: break;
+    }
+    if (*end != '\0') {
+        return 0;
+    }
+    return (size_t) value;
+}
+
+// "500ms", "30s", "5m" 같은 시간 문자열을 ms 로 파싱. 단위가 없으면 ms. 실패하면 0 을 반환한다.
+uint64_t parse_duration(const char *str) {
+    char *end;
+    unsigned long long value = strtoull(str, &end, 10);
+    if (end == str) {
+        return 0;
+    }
+    if (strcmp(end, "s") == 0) {
+        value *= 1000ULL;
+    } else if (strcmp(end, "m") == 0) {
+        value *= 60ULL * 1000;
+    } else if (*end != '\0' && strcmp(end, "ms") != 0) {
+        return 0;
+    }
+    return (uint64_t) value;
+}
+
+void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-e epoll|uring|udp [-u n] [-G]] [-t threads] [-c cpu-list] [-H size] [-L size] [-M size] [-B size] [-S [-P size]] [-F [-m size] [-Q size] [-O policy] [-K time] [-R dir [-Z size]] [-k [-d time]]] [-I time] [-W time] [-b n] [-A n] [-C n] [-D time] [-T n] [-U path] [-s path] [-r n [-x file]] [-w file [-p]] [-y usec] [-Y usec] [-l level]\n", prog);
+    fprintf(stderr, "  -e, --engine   event loop engine (default: epoll), udp for a datagram echo server\n");
+    fprintf(stderr, "  -t, --threads  number of SO_REUSEPORT worker threads (default: 1)\n");
+    fprintf(stderr, "  -c, --cpus     pin worker i to the i-th CPU of the list, e.g. 0,2,4-7\n");
+    fprintf(stderr, "  -H, --high-watermark SIZE  stop reading when this much output is queued (default: 1M)\n");
+    fprintf(stderr, "  -L, --low-watermark SIZE   resume reading below this much queued output (default: 256K)\n");
+    fprintf(stderr, "  -M, --memory-budget SIZE   cap on memory for connection buffers (default: unlimited)\n");
+    fprintf(stderr, "  -B, --read-budget SIZE     max bytes read from one connection per wakeup (default: 256K)\n");
+    fprintf(stderr, "  -S, --splice               zero-copy echo through pooled pipes (epoll engine only)\n");
+    fprintf(stderr, "  -P, --pipe-size SIZE       F_SETPIPE_SZ for splice pipes (default: kernel default)\n");
+    fprintf(stderr, "  -F, --framed               length-prefixed frames dispatched by type (epoll engine only)\n");
+    fprintf(stderr, "  -m, --max-frame SIZE       max frame payload in framed mode (default: 1M)\n");
+    fprintf(stderr, "  -Q, --sub-queue-limit SIZE max queued broadcast bytes per subscriber (default: 1M)\n");
+    fprintf(stderr, "  -O, --slow-policy POLICY   drop|disconnect|block for subscribers over the limit (default: drop)\n");
+    fprintf(stderr, "  -K, --keepalive TIME       PING clients quiet for TIME, close if still quiet after TIME more (framed mode, default: off)\n");
+    fprintf(stderr, "  -R, --file-root DIR        serve GET frames with files under DIR via sendfile() (framed mode)\n");
+    fprintf(stderr, "  -Z, --file-cache SIZE      per-worker LRU cache of mapped hot files, 0 = map per request (default: 64M)\n");
+    fprintf(stderr, "  -k, --coroutine            serve frames with one sequential coroutine handler per connection (ECHO/PING only)\n");
+    fprintf(stderr, "  -d, --service-time TIME    coroutine handlers sleep TIME before each reply to simulate work (default: off)\n");
+    fprintf(stderr, "  -I, --idle-timeout TIME    close connections idle for TIME, e.g. 500ms, 30s, 5m (default: off)\n");
+    fprintf(stderr, "  -W, --send-timeout TIME    close clients whose blocked output does not drain within TIME, 0 = off (default: 60s)\n");
+    fprintf(stderr, "  -b, --backlog N            listen() backlog, capped by net.core.somaxconn (default: %d)\n", DEFAULT_BACKLOG);
+    fprintf(stderr, "  -A, --accept-batch N       max connections accepted per loop iteration (default: %d)\n", DEFAULT_ACCEPT_BATCH);
+    fprintf(stderr, "  -C, --max-conns N          max connections per worker, extra ones are reset (default: unlimited)\n");
+    fprintf(stderr, "  -D, --defer-accept TIME    TCP_DEFER_ACCEPT: wake up only once the client has sent data (default: off)\n");
+    fprintf(stderr, "  -T, --fastopen N           enable TCP_FASTOPEN with a queue of N pending requests (default: off)\n");
+    fprintf(stderr, "  -U, --unix PATH            also accept stream connections on a unix socket, @name for abstract (epoll engine)\n");
+    fprintf(stderr, "                             with -F, unix clients may switch to shared memory rings (SHM_ATTACH frame)\n");
+    fprintf(stderr, "  -s, --stats-socket PATH    serve Prometheus-style counters on a unix socket, @name for abstract\n");
+    fprintf(stderr, "  -r, --trace-sample N       trace kernel rx -> tx latency of 1 in N receives (epoll engine, default: off)\n");
+    fprintf(stderr, "  -x, --trace-file FILE      also append each traced message to a binary trace file\n");
+    fprintf(stderr, "  -w, --capture FILE         record connection opens, receive times/sizes and closes for replay (epoll engine)\n");
+    fprintf(stderr, "  -p, --capture-payload      also record received bytes, needed to replay framed traffic\n");
+    fprintf(stderr, "  -u, --udp-batch N          datagrams per recvmmsg()/sendmmsg() call (udp engine, default: %d)\n", UDP_DEFAULT_BATCH);
+    fprintf(stderr, "  -G, --udp-gro              receive coalesced trains with UDP_GRO and echo them with UDP_SEGMENT (udp engine)\n");
+    fprintf(stderr, "  -y, --spin USEC            latency mode: poll for USEC before sleeping, TCP_NODELAY/TCP_QUICKACK, pin to isolated CPUs\n");
+    fprintf(stderr, "                             (epoll engine, kill -USR1 reports spin hits vs sleeps)\n");
+    fprintf(stderr, "  -Y, --busy-poll USEC       SO_BUSY_POLL/SO_PREFER_BUSY_POLL and epoll busy poll on the NIC queue (epoll engine)\n");
+    fprintf(stderr, "  -l, --log-level LEVEL      trace|debug|info|warn|error|off (default: info)\n");
+    fprintf(stderr, "Send SIGUSR1 to print buffer pool occupancy.\n");
+}
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        {"engine", required_argument, NULL, 'e'},
+        {"threads", required_argument, NULL, 't'},
+        {"cpus", required_argument, NULL, 'c'},
+        {"high-watermark", required_argument, NULL, 'H'},
+        {"low-watermark", required_argument, NULL, 'L'},
+        {"memory-budget", required_argument, NULL, 'M'},
+        {"read-budget", required_argument, NULL, 'B'},
+        {"splice", no_argument, NULL, 'S'},
+        {"pipe-size", required_argument, NULL, 'P'},
+        {"framed", no_argument, NULL, 'F'},
+        {"max-frame", required_argument, NULL, 'm'},
+        {"sub-queue-limit", required_argument, NULL, 'Q'},
+        {"slow-policy", required_argument, NULL, 'O'},
+        {"keepalive", required_argument, NULL, 'K'},
+        {"file-root", required_argument, NULL, 'R'},
+        {"file-cache", required_argument, NULL, 'Z'},
+        {"capture", required_argument, NULL, 'w'},
+        {"capture-payload", no_argument, NULL, 'p'},
+        {"coroutine", no_argument, NULL, 'k'},
+        {"service-time", required_argument, NULL, 'd'},
+        {"idle-timeout", required_argument, NULL, 'I'},
+        {"send-timeout", required_argument, NULL, 'W'},
+        {"backlog", required_argument, NULL, 'b'},
+        {"accept-batch", required_argument, NULL, 'A'},
+        {"max-conns", required_argument, NULL, 'C'},
+        {"defer-accept", required_argument, NULL, 'D'},
+        {"fastopen", required_argument, NULL, 'T'},
+        {"unix", required_argument, NULL, 'U'},
+        {"stats-socket", required_argument, NULL, 's'},
+        {"trace-sample", required_argument, NULL, 'r'},
+        {"trace-file", required_argument, NULL, 'x'},
+        {"udp-batch", required_argument, NULL, 'u'},
+        {"udp-gro", no_argument, NULL, 'G'},
+        {"spin", required_argument, NULL, 'y'},
+        {"busy-poll", required_argument, NULL, 'Y'},
+        {"log-level", required_argument, NULL, 'l'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
 
-            if (fds[i].revents & POLLIN) {
-                if (fds[i].fd == server_fd) {
-                    struct sockaddr_in client_addr;
-                    socklen_t client_len = sizeof(client_addr);
-                    int client_fd = accept(server_fd, (struct sockaddr *) &client_addr, &client_len);
-                    if (client_fd < 0) {
-                        if (handle_accept_error()) {
-                            continue;
-                        }
-                        break;
-                    }
-
-                    set_nonblocking(client_fd);
-                    set_cloexec(client_fd);
-
-                    if (!init_client_buffer(client_fd)) {
-                        perror("Memory allocation failed");
-                        close(client_fd);
-                        continue;
-                    }
-                    fds[nfds].fd = client_fd;
-                    fds[nfds].events = POLLIN;
-                    nfds++;
-
-                    printf("New client connected: %d\n", client_fd);
+    int opt_ch;
+    while ((opt_ch = getopt_long(argc, argv, "e:t:c:H:L:M:B:SP:Fm:Q:O:K:R:Z:kd:w:pI:W:b:A:C:D:T:U:s:r:x:u:Gy:Y:l:h", long_options, NULL)) != -1) {
+        switch (opt_ch) {
+            case 'e':
+                if (strcmp(optarg, "epoll") == 0) {
+                    config.engine = ENGINE_EPOLL;
+                } else if (strcmp(optarg, "uring") == 0) {
+                    config.engine = ENGINE_URING;
+                } else if (strcmp(optarg, "udp") == 0) {
+                    config.engine = ENGINE_UDP;
                 } else {
-                    int client_fd = fds[i].fd;
-                    if (!receive_data(client_fd, fds, nfds)) {
-                        close(client_fd);
-                        free_client_buffer(client_fd);
-                        fds[i] = fds[nfds - 1];
-                        nfds--;
-                        printf("Client disconnected: %d\n", client_fd);
-                    } else {
-                        printf("Received data from client: %d\n", client_fd);
-                        // continue;
-                    }
-                }
-            } else if (fds[i].revents & POLLOUT) {
-                int client_fd = fds[i].fd;
-                if (!send_data(client_fd, fds, nfds)) {
-                    close(client_fd);
-                    free_client_buffer(client_fd);
-                    fds[i] = fds[nfds - 1];
-                    nfds--;
-                    printf("Client disconnected (send error): %d\n", client_fd);
+                    fprintf(stderr, "Unknown engine: %s\n", optarg);
+                    print_usage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 't':
+                config.threads = atoi(optarg);
+                if (config.threads < 1 || config.threads > MAX_WORKERS) {
+                    fprintf(stderr, "Invalid thread count: %s (1-%d)\n", optarg, MAX_WORKERS);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'c':
+                config.cpu_count = parse_cpu_list(optarg, config.cpus, MAX_WORKERS);
+                if (config.cpu_count <= 0) {
+                    fprintf(stderr, "Invalid CPU list: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'H':
+                config.high_watermark = parse_size(optarg);
+                if (config.high_watermark == 0) {
+                    fprintf(stderr, "Invalid high watermark: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'L':
+                config.low_watermark = parse_size(optarg);
+                if (config.low_watermark == 0 && strcmp(optarg, "0") != 0) {
+                    fprintf(stderr, "Invalid low watermark: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'M':
+                config.memory_budget = parse_size(optarg);
+                if (config.memory_budget == 0) {
+                    fprintf(stderr, "Invalid memory budget: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'B':
+                config.read_budget = parse_size(optarg);
+                if (config.read_budget == 0) {
+                    fprintf(stderr, "Invalid read budget: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'S':
+                config.splice_echo = 1;
+                break;
+            case 'P':
+                config.pipe_size = parse_size(optarg);
+                if (config.pipe_size == 0 || config.pipe_size > INT_MAX) {
+                    fprintf(stderr, "Invalid pipe size: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'F':
+                config.framed = 1;
+                break;
+            case 'm':
+                config.max_frame = parse_size(optarg);
+                if (config.max_frame == 0 || config.max_frame > UINT32_MAX) {
+                    fprintf(stderr, "Invalid max frame size: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'Q':
+                config.sub_queue_limit = parse_size(optarg);
+                if (config.sub_queue_limit == 0) {
+                    fprintf(stderr, "Invalid subscriber queue limit: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'O':
+                if (strcmp(optarg, "drop") == 0) {
+                    config.slow_policy = SLOW_DROP;
+                } else if (strcmp(optarg, "disconnect") == 0) {
+                    config.slow_policy = SLOW_DISCONNECT;
+                } else if (strcmp(optarg, "block") == 0) {
+                    config.slow_policy = SLOW_BLOCK;
                 } else {
-                    printf("Sent data to client: %d\n", client_fd);
-                }
-            } else if (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
-                int client_fd = fds[i].fd;
-                close(client_fd);
-                free_client_buffer(client_fd);
-                fds[i] = fds[nfds - 1];
-                nfds--;
-                printf("Client disconnected (error): %d\n", client_fd);
-            } else {
-                printf("Unexpected poll event: %d\n", fds[i].revents);
-                // continue;
+                    fprintf(stderr, "Unknown slow subscriber policy: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'K':
+                config.keepalive_ms = parse_duration(optarg);
+                if (config.keepalive_ms == 0 && strcmp(optarg, "0") != 0) {
+                    fprintf(stderr, "Invalid keepalive interval: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'R':
+                config.file_root = optarg;
+                break;
+            case 'Z':
+                config.file_cache_size = parse_size(optarg);
+                if (config.file_cache_size == 0 && strcmp(optarg, "0") != 0) {
+                    fprintf(stderr, "Invalid file cache size: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'w':
+                config.capture_file = optarg;
+                break;
+            case 'p':
+                config.capture_payload = 1;
+                break;
+            case 'k':
+                config.coroutine = 1;
+                break;
+            case 'd':
+                config.service_time_ms = parse_duration(optarg);
+                if (config.service_time_ms == 0 && strcmp(optarg, "0") != 0) {
+                    fprintf(stderr, "Invalid service time: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'I':
+                config.idle_timeout_ms = parse_duration(optarg);
+                if (config.idle_timeout_ms == 0 && strcmp(optarg, "0") != 0) {
+                    fprintf(stderr, "Invalid idle timeout: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'W':
+                config.send_timeout_ms = parse_duration(optarg);
+                if (config.send_timeout_ms == 0 && strcmp(optarg, "0") != 0) {
+                    fprintf(stderr, "Invalid send timeout: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'b':
+                config.backlog = atoi(optarg);
+                if (config.backlog < 1) {
+                    fprintf(stderr, "Invalid backlog: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'A':
+                config.accept_batch = atoi(optarg);
+                if (config.accept_batch < 1) {
+                    fprintf(stderr, "Invalid accept batch: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'C':
+                config.max_conns = (size_t) atol(optarg);
+                if (config.max_conns == 0) {
+                    fprintf(stderr, "Invalid connection limit: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'D': {
+                // 커널은 초 단위로 받는다. 1초 미만은 1초로 올린다.
+                uint64_t defer_ms = parse_duration(optarg);
+                if (defer_ms == 0 || defer_ms > (uint64_t) INT_MAX * 1000) {
+                    fprintf(stderr, "Invalid defer accept timeout: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                config.defer_accept_s = (int) ((defer_ms + 999) / 1000);
+                break;
+            }
+            case 'T':
+                config.fastopen_qlen = atoi(optarg);
+                if (config.fastopen_qlen < 1) {
+                    fprintf(stderr, "Invalid fastopen queue length: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'U':
+                config.unix_path = optarg;
+                break;
+            case 's':
+                config.stats_socket = optarg;
+                break;
+            case 'r': {
+                long sample = atol(optarg);
+                if (sample < 1 || sample > UINT32_MAX) {
+                    fprintf(stderr, "Invalid trace sample rate: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                config.trace_sample = (uint32_t) sample;
+                break;
+            }
+            case 'x':
+                config.trace_file = optarg;
+                break;
+            case 'u':
+                config.udp.batch = atoi(optarg);
+                if (config.udp.batch < 1 || config.udp.batch > UDP_MAX_BATCH) {
+                    fprintf(stderr, "Invalid UDP batch: %s (1-%d)\n", optarg, UDP_MAX_BATCH);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'G':
+                config.udp.gro = 1;
+                break;
+            case 'y': {
+                long spin_us = atol(optarg);
+                if (spin_us <= 0 || spin_us > 1000000) {
+                    fprintf(stderr, "Invalid spin time: %s (1-1000000 us)\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                config.spin_ns = (uint64_t) spin_us * 1000;
+                break;
+            }
+            case 'Y':
+                config.busy_poll_us = atoi(optarg);
+                if (config.busy_poll_us <= 0) {
+                    fprintf(stderr, "Invalid busy poll time: %s (us)\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'l': {
+                int level = log_parse_level(optarg);
+                if (level < 0) {
+                    fprintf(stderr, "Invalid log level: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                if (level < LOG_COMPILE_LEVEL) {
+                    fprintf(stderr, "Log level %s is compiled out of this build\n", optarg);
+                }
+                log_set_level(level);
+                break;
+            }
+            case 'h':
+                print_usage(argv[0]);
+                exit(EXIT_SUCCESS);
+            default:
+                print_usage(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    if (config.low_watermark >= config.high_watermark) {
+        fprintf(stderr, "Low watermark must be below high watermark\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (config.splice_echo && config.engine != ENGINE_EPOLL) {
+        fprintf(stderr, "Splice echo mode requires the epoll engine\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (config.framed && (config.engine != ENGINE_EPOLL || config.splice_echo)) {
+        fprintf(stderr, "Framed mode requires the epoll engine without splice\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (config.trace_sample > 0 && (config.engine != ENGINE_EPOLL || config.splice_echo)) {
+        fprintf(stderr, "Tracing requires the epoll engine without splice\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (config.trace_file && config.trace_sample == 0) {
+        fprintf(stderr, "Trace file requires a trace sample rate (-r)\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (config.keepalive_ms > 0 && !config.framed) {
+        fprintf(stderr, "Keepalive requires framed mode\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (config.coroutine && (!config.framed || config.keepalive_ms > 0 || config.trace_sample > 0)) {
+        fprintf(stderr, "Coroutine handlers require framed mode without keepalive or tracing\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (config.service_time_ms > 0 && !config.coroutine) {
+        fprintf(stderr, "Service time requires coroutine handlers (-k)\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (config.capture_file && (config.engine != ENGINE_EPOLL || config.coroutine)) {
+        fprintf(stderr, "Capture requires the epoll engine without coroutine handlers\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (config.capture_payload && !config.capture_file) {
+        fprintf(stderr, "Capturing payloads requires a capture file (-w)\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (config.file_root && !config.framed) {
+        fprintf(stderr, "File serving requires framed mode\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (config.file_cache_size != FILE_CACHE_DEFAULT_SIZE && !config.file_root) {
+        fprintf(stderr, "File cache size requires a file root (-R)\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (config.engine == ENGINE_UDP &&
+        (config.idle_timeout_ms > 0 || config.max_conns > 0 || config.defer_accept_s > 0 || config.fastopen_qlen > 0)) {
+        fprintf(stderr, "Connection options do not apply to the udp engine\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // uring 엔진은 연결당 버퍼 수로만 읽기를 멈춘다 (URING_CONN_MAX_BUFS). 타이머와 연결/메모리 한도는 없다.
+    if (config.engine == ENGINE_URING &&
+        (config.idle_timeout_ms > 0 || config.max_conns > 0 || config.send_timeout_ms != DEFAULT_SEND_TIMEOUT_MS ||
+         config.high_watermark != DEFAULT_HIGH_WATERMARK || config.low_watermark != DEFAULT_LOW_WATERMARK ||
+         config.memory_budget > 0 || config.read_budget != DEFAULT_READ_BUDGET)) {
+        fprintf(stderr, "Timeouts, connection limits and buffer options do not apply to the uring engine\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (config.unix_path && config.engine != ENGINE_EPOLL) {
+        fprintf(stderr, "Unix socket listener requires the epoll engine\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (config.udp.gro && config.engine != ENGINE_UDP) {
+        fprintf(stderr, "UDP GRO requires the udp engine\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if ((config.spin_ns > 0 || config.busy_poll_us > 0) && config.engine != ENGINE_EPOLL) {
+        fprintf(stderr, "Spinning and busy polling require the epoll engine\n");
+        exit(EXIT_FAILURE);
+    }
+
+    frame_dispatcher_init(&dispatcher, config.max_frame);
+    frame_register(&dispatcher, FRAME_TYPE_ECHO, handle_echo_frame);
+    frame_register(&dispatcher, FRAME_TYPE_PING, handle_ping_frame);
+    frame_register(&dispatcher, FRAME_TYPE_PONG, handle_pong_frame);
+    frame_register(&dispatcher, FRAME_TYPE_SUBSCRIBE, handle_subscribe_frame);
+    frame_register(&dispatcher, FRAME_TYPE_UNSUBSCRIBE, handle_unsubscribe_frame);
+    frame_register(&dispatcher, FRAME_TYPE_PUBLISH, handle_publish_frame);
+    if (config.unix_path) {
+        frame_register(&dispatcher, FRAME_TYPE_SHM_ATTACH, handle_shm_attach_frame);
+    }
+    if (config.file_root) {
+        frame_register(&dispatcher, FRAME_TYPE_GET, handle_get_frame);
+    }
+
+    // 이후 로그는 백그라운드 스레드가 출력한다
+    if (!log_start()) {
+        exit(EXIT_FAILURE);
+    }
+
+    raise_fd_limit();
+    buffer_pool_set_budget(config.memory_budget);
+
+    // 도는 워커는 코어를 혼자 써야 한다. CPU 목록을 안 줬으면 isolcpus 로 떼어 둔 코어에 고정한다.
+    if (config.spin_ns > 0 && config.cpu_count == 0) {
+        config.cpu_count = read_isolated_cpus(config.cpus, MAX_WORKERS);
+        if (config.cpu_count > 0) {
+            LOG_INFO("Pinning spinning workers to %lld isolated CPUs", config.cpu_count);
+        } else {
+            LOG_WARN("Spinning workers are not pinned; isolate cores (isolcpus=) or pass -c");
+        }
+    }
+    if (config.spin_ns > 0 && config.cpu_count > 0 && config.threads > config.cpu_count) {
+        LOG_WARN("More spinning workers than CPUs (%lld > %lld), workers will share cores", config.threads,
+                 config.cpu_count);
+    }
+
+    if (config.stats_socket && !stats_start(config.stats_socket)) {
+        log_stop();
+        exit(EXIT_FAILURE);
+    }
+
+    if (config.trace_file) {
+        config.trace_fd = trace_open_file(config.trace_file);
+        if (config.trace_fd == -1) {
+            log_stop();
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (config.capture_file && !capture_start(config.capture_file, config.capture_payload)) {
+        log_stop();
+        exit(EXIT_FAILURE);
+    }
+
+    if (config.file_root) {
+        // 워커들이 같이 쓴다. 파일은 모두 이 fd 기준으로 연다
+        config.file_root_fd = open(config.file_root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (config.file_root_fd == -1) {
+            LOG_SYSERR("Cannot open file root directory");
+            log_stop();
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    struct sigaction sa = {0};
+    sa.sa_handler = handle_sigusr1;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, NULL);
+
+    struct worker *workers = (struct worker *) calloc(config.threads, sizeof(struct worker));
+    if (!workers) {
+        LOG_SYSERR("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+
+    int unix_fd = -1;
+    if (config.unix_path) {
+        unix_fd = create_unix_socket(config.unix_path);
+        if (unix_fd == -1) {
+            exit(EXIT_FAILURE);
+        }
+        LOG_INFO("Server listening on unix socket too");
+    }
+
+    for (int i = 0; i < config.threads; i++) {
+        workers[i].id = i;
+        workers[i].unix_fd = unix_fd;
+        workers[i].cpu = config.cpu_count > 0 ? config.cpus[i % config.cpu_count] : -1;
+        if (config.engine == ENGINE_UDP) {
+            workers[i].server_fd = create_udp_socket(config.threads > 1);
+        } else {
+            workers[i].server_fd = create_listen_socket(config.threads > 1);
+        }
+        if (workers[i].server_fd == -1) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    LOG_INFO(config.engine == ENGINE_UDP ? "Server listening on UDP port %lld (workers: %lld)"
+                                         : "Server listening on port %lld (workers: %lld)",
+             PORT, config.threads);
+
+    int ok = 1;
+    if (config.threads == 1) {
+        // 단일 워커는 메인 스레드에서 그대로 돈다
+        worker_main(&workers[0]);
+    } else {
+        for (int i = 0; i < config.threads; i++) {
+            int rc = pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+            if (rc != 0) {
+                errno = rc;
+                LOG_SYSERR("pthread_create() failed");
+                exit(EXIT_FAILURE);
             }
         }
+        for (int i = 0; i < config.threads; i++) {
+            pthread_join(workers[i].thread, NULL);
+        }
     }
 
-    for (int i = 0; i < nfds; i++) {
-        close(fds[i].fd);
-        free_client_buffer(fds[i].fd);
+    for (int i = 0; i < config.threads; i++) {
+        ok &= workers[i].ok;
+        close(workers[i].server_fd);
+    }
+    free(workers);
+    if (unix_fd >= 0) {
+        close(unix_fd);
+        if (!unix_addr_is_abstract(config.unix_path)) {
+            unlink(config.unix_path);
+        }
+    }
+    if (config.file_root_fd >= 0) {
+        close(config.file_root_fd);
+    }
+    if (config.trace_fd >= 0) {
+        close(config.trace_fd);
     }
+    capture_stop();
+    stats_stop();
+    log_stop();
 
-    return 0;
+    return ok ? 0 : EXIT_FAILURE;
 }
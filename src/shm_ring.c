@@ -0,0 +1,293 @@
+#define _GNU_SOURCE
+#include "../include/shm_ring.h"
+#include "../include/log.h"
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+
+// 헤더는 페이지 하나에 들어가야 한다
+_Static_assert(sizeof(struct shm_header) <= SHM_HEADER_SIZE, "shm header does not fit in its page");
+
+// fd 의 offset 부터 size 바이트를 두 번 이어서 매핑한다. 실패하면 NULL.
+static char *map_mirror(int fd, uint64_t offset, uint64_t size) {
+    char *base = mmap(NULL, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        LOG_SYSERR("mmap() failed: shm ring reservation");
+        return NULL;
+    }
+    if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, (off_t) offset) == MAP_FAILED ||
+        mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, (off_t) offset) == MAP_FAILED) {
+        LOG_SYSERR("mmap() failed: shm ring mirror");
+        munmap(base, size * 2);
+        return NULL;
+    }
+    return base;
+}
+
+static int valid_ring_size(uint64_t size) {
+    return size >= SHM_RING_MIN_SIZE && size <= SHM_RING_MAX_SIZE && (size & (size - 1)) == 0 &&
+           size % (uint64_t) sysconf(_SC_PAGESIZE) == 0;
+}
+
+// 헤더와 두 링을 매핑하고 방향을 정한다. 링 0 은 클라이언트 -> 서버다.
+static int map_channel(struct shm_channel *channel, int memfd, uint64_t size, enum shm_side side) {
+    channel->header = mmap(NULL, SHM_HEADER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (channel->header == MAP_FAILED) {
+        LOG_SYSERR("mmap() failed: shm header");
+        channel->header = NULL;
+        return 0;
+    }
+    channel->size = size;
+
+    char *rings[2];
+    rings[0] = map_mirror(memfd, SHM_HEADER_SIZE, size);
+    rings[1] = rings[0] ? map_mirror(memfd, SHM_HEADER_SIZE + size, size) : NULL;
+    if (!rings[1]) {
+        if (rings[0]) {
+            munmap(rings[0], size * 2);
+        }
+        munmap(channel->header, SHM_HEADER_SIZE);
+        channel->header = NULL;
+        return 0;
+    }
+
+    int rx = side == SHM_SIDE_SERVER ? 0 : 1;
+    channel->rx.ctrl = &channel->header->rings[rx];
+    channel->rx.data = rings[rx];
+    channel->tx.ctrl = &channel->header->rings[1 - rx];
+    channel->tx.data = rings[1 - rx];
+    // 새 링이거나 방금 만든 링이므로 인덱스는 0 에서 시작한다
+    channel->rx.pos = 0;
+    channel->rx.peer_pos = 0;
+    channel->tx.pos = 0;
+    channel->tx.peer_pos = 0;
+    return 1;
+}
+
+int shm_channel_create(struct shm_channel *channel, size_t ring_size, int fds[SHM_FD_COUNT]) {
+    memset(channel, 0, sizeof(*channel));
+    channel->wait_fd = -1;
+    channel->peer_fd = -1;
+    for (int i = 0; i < SHM_FD_COUNT; i++) {
+        fds[i] = -1;
+    }
+    if (!valid_ring_size(ring_size)) {
+        LOG_ERROR("Invalid shm ring size: %lld", ring_size);
+        return 0;
+    }
+
+    int memfd = memfd_create("shm_ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (memfd == -1) {
+        LOG_SYSERR("memfd_create() failed");
+        return 0;
+    }
+    uint64_t total = SHM_HEADER_SIZE + 2 * (uint64_t) ring_size;
+    // 크기를 봉인해야 서버가 받아들인다. 매핑 중에 파일이 줄면 상대 쪽이 SIGBUS 를 맞는다.
+    if (ftruncate(memfd, (off_t) total) == -1 ||
+        fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) == -1) {
+        LOG_SYSERR("Failed to size and seal shm memfd");
+        close(memfd);
+        return 0;
+    }
+    if (!map_channel(channel, memfd, ring_size, SHM_SIDE_CLIENT)) {
+        close(memfd);
+        return 0;
+    }
+    channel->header->magic = SHM_RING_MAGIC;
+    channel->header->version = SHM_RING_VERSION;
+    channel->header->ring_size = ring_size;
+
+    int server_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int client_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (server_wake == -1 || client_wake == -1) {
+        LOG_SYSERR("eventfd() failed");
+        if (server_wake != -1) {
+            close(server_wake);
+        }
+        if (client_wake != -1) {
+            close(client_wake);
+        }
+        shm_channel_close(channel);
+        close(memfd);
+        return 0;
+    }
+    channel->wait_fd = client_wake;
+    channel->peer_fd = server_wake;
+    fds[SHM_FD_MEMORY] = memfd;
+    fds[SHM_FD_SERVER_WAKE] = server_wake;
+    fds[SHM_FD_CLIENT_WAKE] = client_wake;
+    return 1;
+}
+
+int shm_channel_attach(struct shm_channel *channel, const int fds[SHM_FD_COUNT]) {
+    memset(channel, 0, sizeof(*channel));
+    channel->wait_fd = fds[SHM_FD_SERVER_WAKE];
+    channel->peer_fd = fds[SHM_FD_CLIENT_WAKE];
+    int memfd = fds[SHM_FD_MEMORY];
+    int ok = 0;
+
+    do {
+        // 상대가 보낸 fd 는 믿지 않는다. 크기가 봉인된 파일이어야 하고, eventfd 쓰기가 막히면 안 된다.
+        struct stat st;
+        if (fstat(memfd, &st) == -1 || !S_ISREG(st.st_mode) || st.st_size < SHM_HEADER_SIZE) {
+            LOG_DEBUG("shm attach rejected: not a memory file");
+            break;
+        }
+        int seals = fcntl(memfd, F_GET_SEALS);
+        if (seals == -1 || !(seals & F_SEAL_SHRINK)) {
+            LOG_DEBUG("shm attach rejected: memfd size is not sealed");
+            break;
+        }
+        int wait_flags = fcntl(channel->wait_fd, F_GETFL);
+        int peer_flags = fcntl(channel->peer_fd, F_GETFL);
+        if (wait_flags == -1 || peer_flags == -1 || !(wait_flags & O_NONBLOCK) || !(peer_flags & O_NONBLOCK)) {
+            LOG_DEBUG("shm attach rejected: wakeup descriptors must be non-blocking");
+            break;
+        }
+
+        struct shm_header header;
+        if (pread(memfd, &header, sizeof(header), 0) != (ssize_t) sizeof(header)) {
+            LOG_DEBUG("shm attach rejected: short header");
+            break;
+        }
+        if (header.magic != SHM_RING_MAGIC || header.version != SHM_RING_VERSION ||
+            !valid_ring_size(header.ring_size) ||
+            (uint64_t) st.st_size != SHM_HEADER_SIZE + 2 * header.ring_size) {
+            LOG_DEBUG("shm attach rejected: bad header (ring size %lld, file size %lld)", header.ring_size,
+                      st.st_size);
+            break;
+        }
+        if (header.rings[0].head != 0 || header.rings[0].tail != 0 || header.rings[1].head != 0 ||
+            header.rings[1].tail != 0) {
+            LOG_DEBUG("shm attach rejected: rings already in use");
+            break;
+        }
+        // 검증한 크기로 매핑한다. 이후 헤더의 ring_size 는 다시 읽지 않는다.
+        ok = map_channel(channel, memfd, header.ring_size, SHM_SIDE_SERVER);
+    } while (0);
+
+    close(memfd);
+    if (!ok) {
+        close(channel->wait_fd);
+        close(channel->peer_fd);
+        channel->wait_fd = -1;
+        channel->peer_fd = -1;
+    }
+    return ok;
+}
+
+void shm_channel_close(struct shm_channel *channel) {
+    if (channel->header) {
+        // 두 링은 서로 다른 예약 구간에 있다
+        munmap(channel->rx.data, channel->size * 2);
+        munmap(channel->tx.data, channel->size * 2);
+        munmap(channel->header, SHM_HEADER_SIZE);
+        channel->header = NULL;
+    }
+    if (channel->wait_fd >= 0) {
+        close(channel->wait_fd);
+        channel->wait_fd = -1;
+    }
+    if (channel->peer_fd >= 0) {
+        close(channel->peer_fd);
+        channel->peer_fd = -1;
+    }
+}
+
+static void wake_peer(struct shm_channel *channel) {
+    uint64_t one = 1;
+    // 카운터가 넘칠 일은 없으므로 EAGAIN 은 무시한다. 상대가 닫았어도 소켓 쪽에서 알게 된다.
+    ssize_t rc = write(channel->peer_fd, &one, sizeof(one));
+    (void) rc;
+}
+
+// 잠들었다는 표시가 있으면 거두고 깨운다. 표시를 거두는 쪽이 둘일 수 있으므로 exchange 로 한 번만 깨운다.
+static int wake_if_parked(struct shm_channel *channel, uint32_t *parked) {
+    // 인덱스 store 와 parked load 사이의 순서. park 쪽의 fence 와 짝을 이룬다.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(parked, __ATOMIC_RELAXED) && __atomic_exchange_n(parked, 0, __ATOMIC_ACQ_REL)) {
+        wake_peer(channel);
+        return 1;
+    }
+    return 0;
+}
+
+const char *shm_channel_read_ptr(struct shm_channel *channel, size_t *len) {
+    struct shm_ring *ring = &channel->rx;
+    uint64_t tail = __atomic_load_n(&ring->ctrl->tail, __ATOMIC_ACQUIRE);
+    uint64_t available = tail - ring->pos;
+    if (available > channel->size) {
+        return NULL; // 생산자가 인덱스를 망가뜨렸다
+    }
+    ring->peer_pos = tail;
+    *len = (size_t) available;
+    return ring->data + (ring->pos & (channel->size - 1));
+}
+
+int shm_channel_consume(struct shm_channel *channel, size_t len) {
+    struct shm_ring *ring = &channel->rx;
+    ring->pos += len;
+    __atomic_store_n(&ring->ctrl->head, ring->pos, __ATOMIC_RELEASE);
+    return wake_if_parked(channel, &ring->ctrl->producer_parked);
+}
+
+char *shm_channel_write_ptr(struct shm_channel *channel, size_t want, size_t *space) {
+    struct shm_ring *ring = &channel->tx;
+    uint64_t free_space = channel->size - (ring->pos - ring->peer_pos);
+    if (free_space < want) {
+        uint64_t head = __atomic_load_n(&ring->ctrl->head, __ATOMIC_ACQUIRE);
+        if (ring->pos - head > channel->size) {
+            return NULL; // 소비자가 인덱스를 망가뜨렸다
+        }
+        ring->peer_pos = head;
+        free_space = channel->size - (ring->pos - head);
+    }
+    *space = (size_t) free_space;
+    return ring->data + (ring->pos & (channel->size - 1));
+}
+
+int shm_channel_commit(struct shm_channel *channel, size_t len) {
+    struct shm_ring *ring = &channel->tx;
+    ring->pos += len;
+    __atomic_store_n(&ring->ctrl->tail, ring->pos, __ATOMIC_RELEASE);
+    return wake_if_parked(channel, &ring->ctrl->consumer_parked);
+}
+
+int shm_channel_park_reader(struct shm_channel *channel, size_t seen) {
+    struct shm_ring *ring = &channel->rx;
+    channel->sleeping = 1;
+    __atomic_store_n(&ring->ctrl->consumer_parked, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->ctrl->tail, __ATOMIC_ACQUIRE) - ring->pos == seen) {
+        return 1;
+    }
+    // 표시를 거두지 못했다면 생산자가 이미 거두고 깨웠다. 그 eventfd 는 다음 clear_wakeup() 이 비운다.
+    __atomic_store_n(&ring->ctrl->consumer_parked, 0, __ATOMIC_RELAXED);
+    return 0;
+}
+
+int shm_channel_park_writer(struct shm_channel *channel) {
+    struct shm_ring *ring = &channel->tx;
+    channel->sleeping = 1;
+    __atomic_store_n(&ring->ctrl->producer_parked, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    uint64_t head = __atomic_load_n(&ring->ctrl->head, __ATOMIC_ACQUIRE);
+    if (ring->pos - head >= channel->size) {
+        return 1;
+    }
+    __atomic_store_n(&ring->ctrl->producer_parked, 0, __ATOMIC_RELAXED);
+    return 0;
+}
+
+void shm_channel_clear_wakeup(struct shm_channel *channel) {
+    if (!channel->sleeping) {
+        return;
+    }
+    channel->sleeping = 0;
+    uint64_t count;
+    ssize_t rc = read(channel->wait_fd, &count, sizeof(count));
+    (void) rc;
+}
@@ -0,0 +1,230 @@
+#define _GNU_SOURCE
+#include "../include/stats.h"
+#include "../include/buffer_pool.h"
+#include "../include/err_handle.h"
+#include "../include/log.h"
+#include "../include/unix_addr.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+struct stat_desc {
+    const char *name;
+    const char *help;
+};
+
+static const struct stat_desc counter_descs[STAT_COUNTER_COUNT] = {
+    [STAT_CONN_ACCEPTED] = {"server_connections_accepted_total", "Connections accepted"},
+    [STAT_CONN_REFUSED] = {"server_connections_refused_total", "Connections reset by admission control"},
+    [STAT_CONN_CLOSED] = {"server_connections_closed_total", "Connections closed"},
+    [STAT_CONN_EVICTED] = {"server_connections_evicted_total", "Slow clients disconnected"},
+    [STAT_CONN_TIMED_OUT] = {"server_connections_timed_out_total", "Connections closed by idle or keepalive timeout"},
+    [STAT_RECV_CALLS] = {"server_recv_calls_total", "Receive system calls"},
+    [STAT_RECV_BYTES] = {"server_recv_bytes_total", "Bytes received"},
+    [STAT_RECV_EAGAIN] = {"server_recv_eagain_total", "Receive calls that returned EAGAIN"},
+    [STAT_SEND_CALLS] = {"server_send_calls_total", "Send system calls"},
+    [STAT_SEND_BYTES] = {"server_send_bytes_total", "Bytes sent"},
+    [STAT_SEND_EAGAIN] = {"server_send_eagain_total", "Send calls that returned EAGAIN"},
+    [STAT_ACCEPT_ERRORS] = {"server_accept_errors_total", "accept() failures other than EAGAIN"},
+    [STAT_RECV_ERRORS] = {"server_recv_errors_total", "Receive failures other than EAGAIN"},
+    [STAT_SEND_ERRORS] = {"server_send_errors_total", "Send failures other than EAGAIN"},
+    [STAT_EPOLL_ERRORS] = {"server_epoll_errors_total", "epoll_wait() and epoll_ctl() failures"},
+    [STAT_MESSAGES_PUBLISHED] = {"server_messages_published_total", "PUBLISH frames with at least one subscriber"},
+    [STAT_MESSAGES_DROPPED] = {"server_messages_dropped_total", "Messages dropped for slow subscribers"},
+    [STAT_DATAGRAMS_RECEIVED] = {"server_datagrams_received_total", "UDP datagrams received"},
+    [STAT_DATAGRAMS_SENT] = {"server_datagrams_sent_total", "UDP datagrams sent"},
+    [STAT_DATAGRAMS_DROPPED] = {"server_datagrams_dropped_total", "UDP replies dropped on a full socket buffer or a peer error"},
+    [STAT_SHM_ATTACHED] = {"server_shm_attached_total", "Connections switched to shared memory rings"},
+    [STAT_SHM_WAKEUPS] = {"server_shm_wakeups_total", "Eventfd wakeups sent to parked shared memory clients"},
+    [STAT_FILE_CACHE_HITS] = {"server_file_cache_hits_total", "GET requests served from a cached mapping"},
+    [STAT_FILE_CACHE_MISSES] = {"server_file_cache_misses_total", "GET requests that opened and mapped the file"},
+    [STAT_FILE_NOT_FOUND] = {"server_file_not_found_total", "GET requests answered with NOT_FOUND"},
+    [STAT_FILE_BYTES] = {"server_file_bytes_total", "File bytes sent with sendfile() or read into shared memory rings"},
+    [STAT_CAPTURE_TRUNCATED] = {"server_capture_truncated_total", "Capture records stored without payload on a full capture ring"},
+    [STAT_CAPTURE_DROPPED] = {"server_capture_dropped_total", "Capture records dropped on a full capture ring"},
+    [STAT_LOOP_ITERATIONS] = {"server_loop_iterations_total", "Event loop iterations"},
+    [STAT_LOOP_BUSY_NS] = {NULL, NULL}, // server_loop_busy_seconds 히스토그램의 _sum 으로 나간다
+    [STAT_LOOP_SPIN_HITS] = {"server_loop_spin_hits_total", "Waits satisfied while busy-polling, without sleeping"},
+    [STAT_LOOP_SLEEPS] = {"server_loop_sleeps_total", "Waits that blocked in epoll_wait()"},
+    [STAT_LOOP_SPIN_NS] = {NULL, NULL}, // server_loop_spin_seconds_total 로 나간다
+};
+
+static const struct stat_desc gauge_descs[STAT_GAUGE_COUNT] = {
+    [STAT_GAUGE_CONNECTIONS] = {"server_connections", "Open connections"},
+    [STAT_GAUGE_TIMERS] = {"server_timers", "Armed timers"},
+    [STAT_GAUGE_TOPICS] = {"server_topics", "Topics with at least one subscriber"},
+    [STAT_GAUGE_FILE_CACHE_BYTES] = {"server_file_cache_bytes", "Bytes of files mapped in the file caches"},
+};
+
+static struct stats_shard *shards = NULL;
+static pthread_mutex_t shards_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t server_thread;
+static int server_fd = -1;
+static int server_running = 0;
+static char server_path[sizeof(((struct sockaddr_un *) 0)->sun_path)];
+
+struct stats_shard *stats_register(int worker) {
+    struct stats_shard *shard = (struct stats_shard *) aligned_alloc(64, sizeof(struct stats_shard));
+    if (!shard) {
+        LOG_SYSERR("Memory allocation failed: stats shard");
+        return NULL;
+    }
+    memset(shard, 0, sizeof(*shard));
+    shard->worker = worker;
+
+    pthread_mutex_lock(&shards_lock);
+    shard->next = shards;
+    __atomic_store_n(&shards, shard, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&shards_lock);
+    return shard;
+}
+
+void stats_write(FILE *out) {
+    uint64_t counters[STAT_COUNTER_COUNT] = {0};
+    int64_t gauges[STAT_GAUGE_COUNT] = {0};
+    uint64_t buckets[STATS_LOOP_BUCKETS + 1] = {0};
+    int workers = 0;
+
+    for (struct stats_shard *s = __atomic_load_n(&shards, __ATOMIC_ACQUIRE); s; s = s->next) {
+        for (int i = 0; i < STAT_COUNTER_COUNT; i++) {
+            counters[i] += __atomic_load_n(&s->counters[i], __ATOMIC_RELAXED);
+        }
+        for (int i = 0; i < STAT_GAUGE_COUNT; i++) {
+            gauges[i] += __atomic_load_n(&s->gauges[i], __ATOMIC_RELAXED);
+        }
+        for (int i = 0; i <= STATS_LOOP_BUCKETS; i++) {
+            buckets[i] += __atomic_load_n(&s->loop_buckets[i], __ATOMIC_RELAXED);
+        }
+        workers++;
+    }
+
+    fprintf(out, "# HELP server_workers Worker event loops\n# TYPE server_workers gauge\nserver_workers %d\n", workers);
+    for (int i = 0; i < STAT_COUNTER_COUNT; i++) {
+        if (counter_descs[i].name) {
+            fprintf(out, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n", counter_descs[i].name, counter_descs[i].help,
+                    counter_descs[i].name, counter_descs[i].name, (unsigned long long) counters[i]);
+        }
+    }
+    for (int i = 0; i < STAT_GAUGE_COUNT; i++) {
+        fprintf(out, "# HELP %s %s\n# TYPE %s gauge\n%s %lld\n", gauge_descs[i].name, gauge_descs[i].help,
+                gauge_descs[i].name, gauge_descs[i].name, (long long) gauges[i]);
+    }
+
+    // 버킷은 누적 개수로 내보낸다
+    fprintf(out, "# HELP server_loop_busy_seconds Time spent per event loop iteration outside epoll_wait()\n");
+    fprintf(out, "# TYPE server_loop_busy_seconds histogram\n");
+    uint64_t cumulative = 0;
+    for (int i = 0; i < STATS_LOOP_BUCKETS; i++) {
+        cumulative += buckets[i];
+        fprintf(out, "server_loop_busy_seconds_bucket{le=\"%g\"} %llu\n", (double) (1ULL << i) / 1e6,
+                (unsigned long long) cumulative);
+    }
+    cumulative += buckets[STATS_LOOP_BUCKETS];
+    fprintf(out, "server_loop_busy_seconds_bucket{le=\"+Inf\"} %llu\n", (unsigned long long) cumulative);
+    fprintf(out, "server_loop_busy_seconds_sum %.9f\n", (double) counters[STAT_LOOP_BUSY_NS] / 1e9);
+    fprintf(out, "server_loop_busy_seconds_count %llu\n", (unsigned long long) counters[STAT_LOOP_ITERATIONS]);
+    fprintf(out, "# HELP server_loop_spin_seconds_total Time spent busy-polling before sleeping\n");
+    fprintf(out, "# TYPE server_loop_spin_seconds_total counter\n");
+    fprintf(out, "server_loop_spin_seconds_total %.9f\n", (double) counters[STAT_LOOP_SPIN_NS] / 1e9);
+
+    struct buffer_pool_stats pool;
+    buffer_pool_get_stats(&pool);
+    fprintf(out, "# HELP server_buffer_pool_blocks Ring buffer blocks by size class\n");
+    fprintf(out, "# TYPE server_buffer_pool_blocks gauge\n");
+    for (int cls = 0; cls < BUFFER_POOL_CLASS_COUNT; cls++) {
+        fprintf(out, "server_buffer_pool_blocks{class=\"%zu\",state=\"in_use\"} %zu\n", pool.class_size[cls],
+                pool.in_use[cls]);
+        fprintf(out, "server_buffer_pool_blocks{class=\"%zu\",state=\"cached\"} %zu\n", pool.class_size[cls],
+                pool.cached[cls]);
+    }
+    fprintf(out, "server_buffer_pool_blocks{class=\"large\",state=\"in_use\"} %zu\n", pool.large_in_use);
+    fprintf(out, "# HELP server_buffer_pool_reserved_bytes Bytes mapped for ring buffers, in use or cached\n");
+    fprintf(out, "# TYPE server_buffer_pool_reserved_bytes gauge\nserver_buffer_pool_reserved_bytes %zu\n",
+            pool.reserved_bytes);
+    fprintf(out, "# HELP server_buffer_pool_budget_bytes Memory budget for ring buffers (0 = unlimited)\n");
+    fprintf(out, "# TYPE server_buffer_pool_budget_bytes gauge\nserver_buffer_pool_budget_bytes %zu\n",
+            pool.budget_bytes);
+}
+
+// 요청 내용은 보지 않는다. 연결하면 스냅샷을 한 번 쓰고 닫는다.
+static void *server_main(void *arg) {
+    (void) arg;
+
+    while (1) {
+        int client_fd = accept4(server_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client_fd < 0) {
+            if (!__atomic_load_n(&server_running, __ATOMIC_ACQUIRE)) {
+                break; // stats_stop() 이 소켓을 shutdown 했다
+            }
+            if (handle_accept_error()) {
+                continue;
+            }
+            break;
+        }
+
+        FILE *out = fdopen(client_fd, "w");
+        if (!out) {
+            close(client_fd);
+            continue;
+        }
+        stats_write(out);
+        fclose(out);
+    }
+    return NULL;
+}
+
+int stats_start(const char *path) {
+    struct sockaddr_un addr;
+    socklen_t addr_len;
+    if (!unix_addr_init(path, &addr, &addr_len)) {
+        LOG_ERROR("Stats socket path too long (max %lld)", sizeof(addr.sun_path) - 1);
+        return 0;
+    }
+    if (!unix_addr_is_abstract(path)) {
+        unlink(path); // 이전 실행이 남긴 소켓 파일
+    }
+
+    server_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server_fd == -1) {
+        handle_socket_error();
+        return 0;
+    }
+    if (bind(server_fd, (struct sockaddr *) &addr, addr_len) == -1) {
+        handle_bind_error();
+        close(server_fd);
+        return 0;
+    }
+    if (listen(server_fd, 16) == -1) {
+        handle_listen_error();
+        close(server_fd);
+        return 0;
+    }
+    strcpy(server_path, path);
+
+    __atomic_store_n(&server_running, 1, __ATOMIC_RELEASE);
+    int rc = pthread_create(&server_thread, NULL, server_main, NULL);
+    if (rc != 0) {
+        errno = rc;
+        LOG_SYSERR("pthread_create() failed for stats server");
+        __atomic_store_n(&server_running, 0, __ATOMIC_RELEASE);
+        close(server_fd);
+        return 0;
+    }
+    LOG_INFO("Stats available on unix socket");
+    return 1;
+}
+
+void stats_stop(void) {
+    if (!__atomic_load_n(&server_running, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    __atomic_store_n(&server_running, 0, __ATOMIC_RELEASE);
+    shutdown(server_fd, SHUT_RDWR); // 막혀 있는 accept() 를 깨운다
+    pthread_join(server_thread, NULL);
+    close(server_fd);
+    if (!unix_addr_is_abstract(server_path)) {
+        unlink(server_path);
+    }
+}
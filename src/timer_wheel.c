@@ -0,0 +1,156 @@
+#include "../include/timer_wheel.h"
+#include <string.h>
+#include <limits.h>
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TOP_LEVEL (TIMER_WHEEL_LEVELS - 1)
+#define TOP_SHIFT (TIMER_WHEEL_BITS * TOP_LEVEL)
+
+void timer_wheel_init(struct timer_wheel *wheel, uint64_t now_ms, uint64_t tick_ms) {
+    memset(wheel->slots, 0, sizeof(wheel->slots));
+    wheel->tick_ms = tick_ms ? tick_ms : 1;
+    wheel->current = now_ms / wheel->tick_ms;
+    wheel->count = 0;
+}
+
+void timer_init(struct timer *timer, timer_fn fn) {
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->fn = fn;
+}
+
+static void link_timer(struct timer **head, struct timer *timer) {
+    timer->next = *head;
+    if (*head) {
+        (*head)->pprev = &timer->next;
+    }
+    *head = timer;
+    timer->pprev = head;
+}
+
+static void unlink_timer(struct timer *timer) {
+    *timer->pprev = timer->next;
+    if (timer->next) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+// 만료 tick 과 현재 tick 이 처음 달라지는 6비트 묶음의 단에 넣는다.
+// 최상위 단은 원형으로 돌려 쓰므로 현재 칸에서 63칸 앞까지 담을 수 있다.
+static void insert_timer(struct timer_wheel *wheel, struct timer *timer) {
+    uint64_t current_block = wheel->current >> TOP_SHIFT;
+    if ((timer->expires >> TOP_SHIFT) - current_block >= TIMER_WHEEL_SLOTS) {
+        // 범위를 넘으면 마지막 칸의 끝으로 당긴다
+        timer->expires = ((current_block + TIMER_WHEEL_SLOTS) << TOP_SHIFT) - 1;
+    }
+
+    uint64_t diff = timer->expires ^ wheel->current;
+    int level = 0;
+    while (level < TOP_LEVEL && (diff >> (TIMER_WHEEL_BITS * (level + 1))) != 0) {
+        level++;
+    }
+    size_t slot = (size_t) (timer->expires >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK;
+    link_timer(&wheel->slots[level][slot], timer);
+}
+
+void timer_arm(struct timer_wheel *wheel, struct timer *timer, uint64_t expires_ms) {
+    if (timer_pending(timer)) {
+        unlink_timer(timer);
+    } else {
+        wheel->count++;
+    }
+
+    // 일찍 만료되지 않도록 올림하고, 지난 시각이면 다음 tick 에 만료시킨다
+    uint64_t expires = (expires_ms + wheel->tick_ms - 1) / wheel->tick_ms;
+    if (expires <= wheel->current) {
+        expires = wheel->current + 1;
+    }
+    timer->expires = expires;
+    insert_timer(wheel, timer);
+}
+
+void timer_cancel(struct timer_wheel *wheel, struct timer *timer) {
+    if (!timer_pending(timer)) {
+        return;
+    }
+    unlink_timer(timer);
+    wheel->count--;
+}
+
+// 위 단의 칸 하나를 통째로 꺼내 아래 단에 다시 넣는다
+static void cascade(struct timer_wheel *wheel, int level, size_t slot) {
+    struct timer *timer = wheel->slots[level][slot];
+    wheel->slots[level][slot] = NULL;
+    while (timer) {
+        struct timer *next = timer->next;
+        timer->next = NULL;
+        timer->pprev = NULL;
+        insert_timer(wheel, timer);
+        timer = next;
+    }
+}
+
+void timer_wheel_advance(struct timer_wheel *wheel, uint64_t now_ms, void *arg) {
+    uint64_t target = now_ms / wheel->tick_ms;
+
+    while (wheel->current < target) {
+        if (wheel->count == 0) {
+            wheel->current = target; // 돌려 볼 타이머가 없다
+            return;
+        }
+        wheel->current++;
+
+        for (int level = TIMER_WHEEL_LEVELS - 1; level >= 1; level--) {
+            uint64_t below = (1ULL << (TIMER_WHEEL_BITS * level)) - 1;
+            if ((wheel->current & below) == 0) {
+                cascade(wheel, level, (size_t) (wheel->current >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK);
+            }
+        }
+
+        // 콜백이 다시 등록하는 타이머는 다음 tick 이후 칸으로 가므로 이 칸은 반드시 빈다
+        struct timer **head = &wheel->slots[0][wheel->current & SLOT_MASK];
+        while (*head) {
+            struct timer *timer = *head;
+            unlink_timer(timer);
+            wheel->count--;
+            timer->fn(timer, arg);
+        }
+    }
+}
+
+int timer_wheel_timeout_ms(const struct timer_wheel *wheel, uint64_t now_ms) {
+    if (wheel->count == 0) {
+        return -1;
+    }
+
+    // 단마다 현재 칸 다음의 첫 번째 비어 있지 않은 칸이 시작되는 tick. 0단이면 만료, 위 단이면 cascade 시각이다.
+    // 아래 단은 현재 칸 뒤쪽만, 최상위 단은 한 바퀴를 돌아서 본다.
+    uint64_t next = UINT64_MAX;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        int shift = TIMER_WHEEL_BITS * level;
+        uint64_t block = wheel->current >> shift;
+        uint64_t steps = level == TOP_LEVEL ? TIMER_WHEEL_SLOTS : TIMER_WHEEL_SLOTS - (block & SLOT_MASK);
+        for (uint64_t step = 1; step < steps; step++) {
+            if (wheel->slots[level][(block + step) & SLOT_MASK]) {
+                uint64_t tick = (block + step) << shift;
+                if (tick < next) {
+                    next = tick;
+                }
+                break;
+            }
+        }
+    }
+
+    if (next == UINT64_MAX) {
+        return 0;
+    }
+    uint64_t due_ms = next * wheel->tick_ms;
+    if (due_ms <= now_ms) {
+        return 0;
+    }
+    uint64_t timeout = due_ms - now_ms;
+    return timeout > INT_MAX ? INT_MAX : (int) timeout;
+}
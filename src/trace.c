@@ -0,0 +1,180 @@
+#define _GNU_SOURCE
+#include "../include/trace.h"
+#include "../include/log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+
+#define TRACE_BUFFER_RECORDS 256
+
+static const char *stage_names[TRACE_STAGE_COUNT] = {
+    [TRACE_RX_TO_WAKE] = "rx-kernel -> loop wake",
+    [TRACE_WAKE_TO_DISPATCH] = "loop wake -> dispatch",
+    [TRACE_DISPATCH_TO_SEND] = "dispatch -> send syscall",
+    [TRACE_SEND_TO_TX] = "send syscall -> tx-kernel",
+    [TRACE_TOTAL] = "rx-kernel -> tx-kernel",
+};
+
+uint64_t realtime_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+int trace_open_file(const char *path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        LOG_SYSERR("Failed to open trace file");
+        return -1;
+    }
+    struct trace_file_header header = {0};
+    memcpy(header.magic, TRACE_FILE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_FILE_VERSION;
+    header.record_size = sizeof(struct trace_record);
+    if (write(fd, &header, sizeof(header)) != (ssize_t) sizeof(header)) {
+        LOG_SYSERR("Failed to write trace file header");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int tracer_init(struct tracer *tracer, int worker, uint32_t sample_every, int fd) {
+    memset(tracer, 0, sizeof(*tracer));
+    for (int i = 0; i < TRACE_STAGE_COUNT; i++) {
+        histogram_init(&tracer->stages[i]);
+    }
+    if (fd >= 0) {
+        tracer->records = (struct trace_record *) malloc(TRACE_BUFFER_RECORDS * sizeof(struct trace_record));
+        if (!tracer->records) {
+            LOG_SYSERR("Memory allocation failed: trace buffer");
+            return 0;
+        }
+    }
+    tracer->fd = fd;
+    tracer->worker = worker;
+    tracer->sample_every = sample_every ? sample_every : 1;
+    tracer->countdown = tracer->sample_every;
+    return 1;
+}
+
+void tracer_destroy(struct tracer *tracer) {
+    tracer_flush(tracer);
+    free(tracer->records);
+    tracer->records = NULL;
+}
+
+void tracer_flush(struct tracer *tracer) {
+    if (tracer->record_count == 0) {
+        return;
+    }
+    // 워커들이 같은 파일에 O_APPEND 로 쓰므로 한 번의 write() 로 기록이 섞이지 않게 한다
+    size_t bytes = tracer->record_count * sizeof(struct trace_record);
+    if (write(tracer->fd, tracer->records, bytes) != (ssize_t) bytes) {
+        LOG_SYSWARN("Failed to write trace records");
+    }
+    tracer->record_count = 0;
+}
+
+static uint64_t elapsed(uint64_t from, uint64_t to) {
+    return to > from ? to - from : 0;
+}
+
+void tracer_complete(struct tracer *tracer, const struct trace_record *record) {
+    histogram_record(&tracer->stages[TRACE_RX_TO_WAKE], elapsed(record->rx_ns, record->wake_ns));
+    histogram_record(&tracer->stages[TRACE_WAKE_TO_DISPATCH], elapsed(record->wake_ns, record->dispatch_ns));
+    histogram_record(&tracer->stages[TRACE_DISPATCH_TO_SEND], elapsed(record->dispatch_ns, record->send_ns));
+    histogram_record(&tracer->stages[TRACE_SEND_TO_TX], elapsed(record->send_ns, record->tx_ns));
+    histogram_record(&tracer->stages[TRACE_TOTAL], elapsed(record->rx_ns, record->tx_ns));
+    tracer->completed++;
+
+    if (tracer->records) {
+        tracer->records[tracer->record_count++] = *record;
+        if (tracer->record_count == TRACE_BUFFER_RECORDS) {
+            tracer_flush(tracer);
+        }
+    }
+}
+
+void tracer_report(FILE *out, const struct tracer *tracer) {
+    fprintf(out, "[trace] worker %d: %llu sampled messages\n", tracer->worker,
+            (unsigned long long) tracer->completed);
+    for (int i = 0; i < TRACE_STAGE_COUNT; i++) {
+        char label[64];
+        snprintf(label, sizeof(label), "[trace] %s", stage_names[i]);
+        histogram_print_ns(out, label, &tracer->stages[i]);
+    }
+    fflush(out);
+}
+
+int trace_enable_socket(int fd) {
+    // TSONLY: 에러 큐에 보낸 데이터 사본을 붙이지 않는다
+    int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_OPT_TSONLY;
+    if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == -1) {
+        LOG_SYSWARN("setsockopt(SO_TIMESTAMPING) failed");
+        return 0;
+    }
+    return 1;
+}
+
+// 제어 메시지에서 소프트웨어 타임스탬프(ts[0])를 찾는다
+static uint64_t find_timestamp(struct msghdr *msg) {
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMPING) {
+            struct scm_timestamping *tss = (struct scm_timestamping *) CMSG_DATA(cmsg);
+            return (uint64_t) tss->ts[0].tv_sec * 1000000000 + (uint64_t) tss->ts[0].tv_nsec;
+        }
+    }
+    return 0;
+}
+
+ssize_t trace_recv(int fd, void *buf, size_t len, uint64_t *rx_ns) {
+    char control[CMSG_SPACE(sizeof(struct scm_timestamping))];
+    struct iovec iov = {buf, len};
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t bytes = recvmsg(fd, &msg, 0);
+    *rx_ns = bytes > 0 ? find_timestamp(&msg) : 0;
+    return bytes;
+}
+
+ssize_t trace_sendmsg(int fd, struct msghdr *msg, int flags) {
+    union {
+        char buf[CMSG_SPACE(sizeof(uint32_t))];
+        struct cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof(control));
+    msg->msg_control = control.buf;
+    msg->msg_controllen = sizeof(control.buf);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SO_TIMESTAMPING;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint32_t));
+    *(uint32_t *) CMSG_DATA(cmsg) = SOF_TIMESTAMPING_TX_SOFTWARE;
+
+    ssize_t bytes = sendmsg(fd, msg, flags);
+    msg->msg_control = NULL;
+    msg->msg_controllen = 0;
+    return bytes;
+}
+
+int trace_read_tx(int fd, uint64_t *tx_ns) {
+    char control[512];
+    struct msghdr msg = {0};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+    *tx_ns = find_timestamp(&msg);
+    return 1;
+}
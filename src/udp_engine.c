@@ -0,0 +1,277 @@
+#define _GNU_SOURCE
+#include "../include/udp_engine.h"
+#include "../include/err_handle.h"
+#include "../include/log.h"
+#include "../include/stats.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+#define UDP_SLOT_SIZE (64 * 1024) // GRO 로 뭉친 datagram 도 64K 를 넘지 않는다
+#define UDP_ROUNDS 16             // 한 번 깨어났을 때 recvmmsg() 를 부르는 최대 횟수
+
+// datagram 하나 분량의 제어 메시지 공간 (수신 UDP_GRO int, 송신 UDP_SEGMENT uint16_t)
+union udp_control {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+};
+
+struct udp_loop {
+    int fd;
+    int epoll_fd;
+    int batch;
+    int gro;
+    char *buffers; // batch 개의 UDP_SLOT_SIZE 슬롯. 받은 슬롯을 그대로 돌려보낸다
+    struct mmsghdr *rx;
+    struct mmsghdr *tx;
+    struct iovec *rx_iov;
+    struct iovec *tx_iov;
+    struct sockaddr_storage *addrs;
+    union udp_control *rx_control;
+    union udp_control *tx_control;
+    uint16_t *segments; // tx[i] 에 담긴 datagram 수
+    struct stats_shard *stats;
+};
+
+static void udp_loop_destroy(struct udp_loop *loop) {
+    free(loop->buffers);
+    free(loop->rx);
+    free(loop->tx);
+    free(loop->rx_iov);
+    free(loop->tx_iov);
+    free(loop->addrs);
+    free(loop->rx_control);
+    free(loop->tx_control);
+    free(loop->segments);
+    if (loop->epoll_fd >= 0) {
+        close(loop->epoll_fd);
+    }
+}
+
+static int udp_loop_init(struct udp_loop *loop, int fd, struct stats_shard *stats, const struct udp_options *options) {
+    memset(loop, 0, sizeof(*loop));
+    loop->fd = fd;
+    loop->epoll_fd = -1;
+    loop->batch = options->batch;
+    loop->stats = stats;
+
+    size_t n = (size_t) loop->batch;
+    loop->buffers = (char *) malloc(n * UDP_SLOT_SIZE);
+    loop->rx = (struct mmsghdr *) calloc(n, sizeof(struct mmsghdr));
+    loop->tx = (struct mmsghdr *) calloc(n, sizeof(struct mmsghdr));
+    loop->rx_iov = (struct iovec *) calloc(n, sizeof(struct iovec));
+    loop->tx_iov = (struct iovec *) calloc(n, sizeof(struct iovec));
+    loop->addrs = (struct sockaddr_storage *) calloc(n, sizeof(struct sockaddr_storage));
+    loop->rx_control = (union udp_control *) calloc(n, sizeof(union udp_control));
+    loop->tx_control = (union udp_control *) calloc(n, sizeof(union udp_control));
+    loop->segments = (uint16_t *) calloc(n, sizeof(uint16_t));
+    if (!loop->buffers || !loop->rx || !loop->tx || !loop->rx_iov || !loop->tx_iov || !loop->addrs ||
+        !loop->rx_control || !loop->tx_control || !loop->segments) {
+        LOG_SYSERR("Memory allocation failed: udp batch");
+        udp_loop_destroy(loop);
+        return 0;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        loop->rx_iov[i].iov_base = loop->buffers + i * UDP_SLOT_SIZE;
+        loop->rx_iov[i].iov_len = UDP_SLOT_SIZE;
+        loop->rx[i].msg_hdr.msg_iov = &loop->rx_iov[i];
+        loop->rx[i].msg_hdr.msg_iovlen = 1;
+        loop->rx[i].msg_hdr.msg_name = &loop->addrs[i];
+        loop->tx_iov[i].iov_base = loop->rx_iov[i].iov_base;
+        loop->tx[i].msg_hdr.msg_iov = &loop->tx_iov[i];
+        loop->tx[i].msg_hdr.msg_iovlen = 1;
+        loop->tx[i].msg_hdr.msg_name = &loop->addrs[i];
+    }
+
+    if (options->gro) {
+        int opt = 1;
+        if (setsockopt(fd, IPPROTO_UDP, UDP_GRO, &opt, sizeof(opt)) == 0) {
+            loop->gro = 1;
+        } else {
+            LOG_SYSWARN("setsockopt(UDP_GRO) failed, receiving datagrams one by one");
+        }
+    }
+
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll_fd == -1) {
+        handle_epoll_error();
+        udp_loop_destroy(loop);
+        return 0;
+    }
+    // 소켓이 하나뿐이므로 level-triggered 로 두고, 다 못 읽었으면 epoll_wait() 가 바로 돌아오게 한다
+    struct epoll_event ev = {0};
+    ev.events = EPOLLIN;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        handle_epoll_error();
+        udp_loop_destroy(loop);
+        return 0;
+    }
+    return 1;
+}
+
+// GRO 가 뭉쳐 준 datagram 의 원래 크기. 뭉치지 않았으면 0.
+static int gro_segment_size(struct msghdr *msg) {
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            int size;
+            memcpy(&size, CMSG_DATA(cmsg), sizeof(size));
+            return size;
+        }
+    }
+    return 0;
+}
+
+// 받은 datagram i 를 돌려보낼 tx[i] 를 채운다. 뭉쳐 받은 것은 같은 크기로 잘라 보내도록 UDP_SEGMENT 를 붙인다.
+static void prepare_reply(struct udp_loop *loop, int i) {
+    struct msghdr *in = &loop->rx[i].msg_hdr;
+    struct msghdr *out = &loop->tx[i].msg_hdr;
+    size_t len = loop->rx[i].msg_len;
+
+    loop->tx_iov[i].iov_len = len;
+    out->msg_namelen = in->msg_namelen;
+    out->msg_control = NULL;
+    out->msg_controllen = 0;
+    loop->segments[i] = 1;
+
+    int segment = loop->gro ? gro_segment_size(in) : 0;
+    if (segment > 0 && len > (size_t) segment) {
+        out->msg_control = loop->tx_control[i].buf;
+        out->msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(out);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        uint16_t gso_size = (uint16_t) segment;
+        memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+        loop->segments[i] = (uint16_t) ((len + segment - 1) / segment);
+    }
+}
+
+static uint64_t count_segments(const struct udp_loop *loop, int from, int to) {
+    uint64_t datagrams = 0;
+    for (int i = from; i < to; i++) {
+        datagrams += loop->segments[i];
+    }
+    return datagrams;
+}
+
+// tx[0..count) 를 보낸다. 소켓을 더 쓸 수 없으면 0.
+static int send_replies(struct udp_loop *loop, int count) {
+    int sent = 0;
+    while (sent < count) {
+        int rc = sendmmsg(loop->fd, loop->tx + sent, (unsigned int) (count - sent), 0);
+        stats_inc(loop->stats, STAT_SEND_CALLS);
+        if (rc > 0) {
+            uint64_t bytes = 0;
+            for (int i = sent; i < sent + rc; i++) {
+                bytes += loop->tx[i].msg_len;
+            }
+            stats_add(loop->stats, STAT_SEND_BYTES, bytes);
+            stats_add(loop->stats, STAT_DATAGRAMS_SENT, count_segments(loop, sent, sent + rc));
+            sent += rc;
+            continue;
+        }
+
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            // 송신 버퍼가 찼다. 기다리지 않고 나머지 응답을 버린다
+            stats_inc(loop->stats, STAT_SEND_EAGAIN);
+            stats_add(loop->stats, STAT_DATAGRAMS_DROPPED, count_segments(loop, sent, count));
+            return 1;
+        }
+        stats_inc(loop->stats, STAT_SEND_ERRORS);
+        if (!handle_sendmmsg_error()) {
+            return 0;
+        }
+        if (errno != EINTR) {
+            // sendmmsg() 는 첫 datagram 이 실패했을 때만 오류를 돌려준다. 그것만 버리고 이어서 보낸다
+            stats_add(loop->stats, STAT_DATAGRAMS_DROPPED, loop->segments[sent]);
+            sent++;
+        }
+    }
+    return 1;
+}
+
+// 받을 것이 없을 때까지 (최대 UDP_ROUNDS 번) 받아서 돌려준다. 소켓을 더 쓸 수 없으면 0.
+static int echo_datagrams(struct udp_loop *loop) {
+    for (int round = 0; round < UDP_ROUNDS; round++) {
+        // 커널이 덮어쓴 길이를 되돌린다
+        for (int i = 0; i < loop->batch; i++) {
+            loop->rx[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+            if (loop->gro) {
+                loop->rx[i].msg_hdr.msg_control = loop->rx_control[i].buf;
+                loop->rx[i].msg_hdr.msg_controllen = sizeof(loop->rx_control[i].buf);
+            }
+        }
+
+        int n = recvmmsg(loop->fd, loop->rx, (unsigned int) loop->batch, MSG_DONTWAIT, NULL);
+        stats_inc(loop->stats, STAT_RECV_CALLS);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                stats_inc(loop->stats, STAT_RECV_EAGAIN);
+                return 1;
+            }
+            stats_inc(loop->stats, STAT_RECV_ERRORS);
+            if (handle_recvmmsg_error()) {
+                continue;
+            }
+            return 0;
+        }
+
+        uint64_t bytes = 0;
+        for (int i = 0; i < n; i++) {
+            prepare_reply(loop, i);
+            bytes += loop->rx[i].msg_len;
+        }
+        stats_add(loop->stats, STAT_RECV_BYTES, bytes);
+        stats_add(loop->stats, STAT_DATAGRAMS_RECEIVED, count_segments(loop, 0, n));
+
+        if (!send_replies(loop, n)) {
+            return 0;
+        }
+        if (n < loop->batch) {
+            return 1; // 수신 큐를 비웠을 가능성이 높다. 확인은 epoll_wait() 에 맡긴다
+        }
+    }
+    return 1;
+}
+
+int run_udp_engine(int server_fd, struct stats_shard *stats, const struct udp_options *options) {
+    struct udp_loop loop;
+    if (!udp_loop_init(&loop, server_fd, stats, options)) {
+        return 0;
+    }
+
+    LOG_INFO("UDP engine running (batch %lld, gro %lld)", loop.batch, loop.gro);
+
+    struct epoll_event event;
+    while (1) {
+        int rc = epoll_wait(loop.epoll_fd, &event, 1, -1);
+        if (rc < 0) {
+            stats_inc(loop.stats, STAT_EPOLL_ERRORS);
+            if (handle_epoll_error()) {
+                continue;
+            }
+            break;
+        }
+        if (!echo_datagrams(&loop)) {
+            break;
+        }
+        stats_inc(loop.stats, STAT_LOOP_ITERATIONS);
+    }
+
+    udp_loop_destroy(&loop);
+    return 1;
+}
@@ -0,0 +1,646 @@
+#include "../include/uring_engine.h"
+#include "../include/err_handle.h"
+#include "../include/log.h"
+#include "../include/conn_table.h"
+#include "../include/stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#define URING_ENTRIES 4096
+#define URING_CQ_ENTRIES (URING_ENTRIES * 4)
+#define URING_BUF_GROUP 0
+#define URING_BUF_COUNT 4096 // 2의 거듭제곱이어야 함
+#define URING_BUF_SIZE 4096
+#define URING_CONN_MAX_BUFS 64    // 연결 하나가 들고 있을 수 있는 버퍼 수. 넘으면 recv 를 거둔다
+#define URING_CONN_RESUME_BUFS 16 // 이만큼 줄어들면 recv 를 다시 건다
+#define URING_SEND_IOVS URING_CONN_MAX_BUFS // sendmsg 한 번에 묶는 버퍼 수
+
+// user_data 인코딩: 하위 3비트는 op, 그 위 32비트는 연결 테이블 인덱스, 상위 16비트는 buffer id
+#define OP_ACCEPT 1
+#define OP_RECV 2
+#define OP_SEND 3
+#define OP_CANCEL 4
+#define UD_OP_MASK 0x7ULL
+#define UD_INDEX_SHIFT 3
+#define UD_BID_SHIFT 48
+
+#define BID_NONE 0xffff
+
+struct uring {
+    int fd;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr;
+    size_t sq_map_size;
+    void *cq_ptr;
+    size_t cq_map_size;
+    size_t sqes_map_size;
+    unsigned sq_local_tail; // 아직 커널에 알리지 않은 tail
+    unsigned to_submit;
+    struct stats_shard *stats;
+
+    struct io_uring_buf_ring *buf_ring;
+    size_t buf_ring_size;
+    char *buf_base;
+    unsigned short buf_tail;
+    uint16_t buf_next[URING_BUF_COUNT]; // 연결별 송신 대기열 (buffer id 연결 리스트)
+    uint32_t buf_len[URING_BUF_COUNT];
+
+    // 완료 처리 중 손댄 연결들. 루프 끝에서 한 번에 sendmsg 를 낸다.
+    struct uring_conn **dirty;
+    size_t dirty_count;
+    size_t dirty_capacity;
+
+    // 연결 슬롯. 요청이 커널에 걸려 있는 동안(refs > 0)은 해제하지 않으므로
+    // 완료 이벤트는 세대 확인 없이 인덱스로 찾는다.
+    struct conn_table conns;
+};
+
+struct uring_conn {
+    int fd;
+    int refs;           // 커널에 걸려 있는 요청 수 (recv 1 + sendmsg 1)
+    int recv_armed;
+    int closing;
+    int sending;        // 진행 중인 sendmsg 가 들고 있는 버퍼 수
+    int dirty;          // ring->dirty 목록에 들어 있음
+    int paused;         // 보낼 버퍼가 너무 많이 쌓여서 recv 를 거뒀다
+    uint32_t held;      // 대기열과 진행 중인 send 가 들고 있는 버퍼 수
+    uint16_t pending_head;
+    uint16_t pending_tail;
+    uint16_t sending_head; // 진행 중인 sendmsg 의 첫 버퍼. buf_next 로 sending 개를 따라간다
+    uint32_t sending_len;  // 진행 중인 sendmsg 의 총 바이트 수
+    uint64_t handle;    // conn_table 핸들
+    // sendmsg 가 끝날 때까지 커널이 읽으므로 연결 슬롯 안에 둔다 (슬롯은 옮겨지지 않는다)
+    struct msghdr msg;
+    struct iovec iov[URING_SEND_IOVS];
+};
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int) syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static uint64_t make_user_data(struct uring_conn *conn, int op, uint16_t bid) {
+    uint64_t index = conn ? conn_handle_index(conn->handle) : 0;
+    return ((uint64_t) bid << UD_BID_SHIFT) | (index << UD_INDEX_SHIFT) | (uint64_t) op;
+}
+
+static int uring_init(struct uring *ring) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = URING_CQ_ENTRIES;
+
+    ring->fd = sys_io_uring_setup(URING_ENTRIES, &params);
+    if (ring->fd < 0) {
+        handle_io_uring_error();
+        return 0;
+    }
+
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_map_size > ring->sq_map_size) {
+            ring->sq_map_size = ring->cq_map_size;
+        }
+        ring->cq_map_size = ring->sq_map_size;
+    }
+
+    ring->sq_ptr = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        LOG_SYSERR("mmap() failed: io_uring SQ ring");
+        close(ring->fd);
+        return 0;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) {
+            LOG_SYSERR("mmap() failed: io_uring CQ ring");
+            munmap(ring->sq_ptr, ring->sq_map_size);
+            close(ring->fd);
+            return 0;
+        }
+    }
+
+    ring->sqes_map_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        LOG_SYSERR("mmap() failed: io_uring SQEs");
+        if (ring->cq_ptr != ring->sq_ptr) {
+            munmap(ring->cq_ptr, ring->cq_map_size);
+        }
+        munmap(ring->sq_ptr, ring->sq_map_size);
+        close(ring->fd);
+        return 0;
+    }
+
+    char *sq = (char *) ring->sq_ptr;
+    char *cq = (char *) ring->cq_ptr;
+    ring->sq_head = (unsigned *) (sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *) (sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *) (sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *) (sq + params.sq_off.array);
+    ring->cq_head = (unsigned *) (cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *) (cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+    ring->sq_local_tail = *ring->sq_tail;
+    ring->to_submit = 0;
+
+    return 1;
+}
+
+// 버퍼를 커널 제공 버퍼 링에 돌려준다. 실제 공개는 buf_ring_publish() 에서 한 번에 한다.
+static void buf_ring_recycle(struct uring *ring, uint16_t bid) {
+    struct io_uring_buf *buf = &ring->buf_ring->bufs[ring->buf_tail & (URING_BUF_COUNT - 1)];
+    buf->addr = (uint64_t) (uintptr_t) (ring->buf_base + (size_t) bid * URING_BUF_SIZE);
+    buf->len = URING_BUF_SIZE;
+    buf->bid = bid;
+    ring->buf_tail++;
+}
+
+static void buf_ring_publish(struct uring *ring) {
+    __atomic_store_n(&ring->buf_ring->tail, ring->buf_tail, __ATOMIC_RELEASE);
+}
+
+static int buf_ring_init(struct uring *ring) {
+    ring->buf_ring_size = URING_BUF_COUNT * sizeof(struct io_uring_buf);
+    ring->buf_ring = mmap(NULL, ring->buf_ring_size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring->buf_ring == MAP_FAILED) {
+        LOG_SYSERR("mmap() failed: provided buffer ring");
+        return 0;
+    }
+
+    ring->buf_base = mmap(NULL, (size_t) URING_BUF_COUNT * URING_BUF_SIZE, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring->buf_base == MAP_FAILED) {
+        LOG_SYSERR("mmap() failed: provided buffers");
+        munmap(ring->buf_ring, ring->buf_ring_size);
+        return 0;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t) (uintptr_t) ring->buf_ring;
+    reg.ring_entries = URING_BUF_COUNT;
+    reg.bgid = URING_BUF_GROUP;
+    if (sys_io_uring_register(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        handle_io_uring_error();
+        munmap(ring->buf_base, (size_t) URING_BUF_COUNT * URING_BUF_SIZE);
+        munmap(ring->buf_ring, ring->buf_ring_size);
+        return 0;
+    }
+
+    ring->buf_tail = 0;
+    for (uint16_t bid = 0; bid < URING_BUF_COUNT; bid++) {
+        buf_ring_recycle(ring, bid);
+    }
+    buf_ring_publish(ring);
+
+    return 1;
+}
+
+static void uring_destroy(struct uring *ring) {
+    munmap(ring->buf_base, (size_t) URING_BUF_COUNT * URING_BUF_SIZE);
+    munmap(ring->buf_ring, ring->buf_ring_size);
+    munmap(ring->sqes, ring->sqes_map_size);
+    if (ring->cq_ptr != ring->sq_ptr) {
+        munmap(ring->cq_ptr, ring->cq_map_size);
+    }
+    munmap(ring->sq_ptr, ring->sq_map_size);
+    close(ring->fd);
+}
+
+// 모아둔 SQE 를 커널에 알리고, min_complete 개의 완료를 기다린다.
+static int uring_submit_and_wait(struct uring *ring, unsigned min_complete) {
+    __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+
+    while (1) {
+        unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+        int ret = sys_io_uring_enter(ring->fd, ring->to_submit, min_complete, flags);
+        if (ret >= 0) {
+            ring->to_submit -= (unsigned) ret < ring->to_submit ? (unsigned) ret : ring->to_submit;
+            return 1;
+        }
+        if (!handle_io_uring_error()) {
+            return 0;
+        }
+        if (errno == EBUSY) {
+            return 1; // 완료 큐를 먼저 비운다
+        }
+    }
+}
+
+static struct io_uring_sqe *uring_get_sqe(struct uring *ring) {
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sq_local_tail - head >= URING_ENTRIES) {
+        // SQ 가 가득 차면 완료를 기다리지 않고 제출만 한다
+        if (!uring_submit_and_wait(ring, 0)) {
+            return NULL;
+        }
+        head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        if (ring->sq_local_tail - head >= URING_ENTRIES) {
+            return NULL;
+        }
+    }
+
+    unsigned idx = ring->sq_local_tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[idx] = idx;
+    ring->sq_local_tail++;
+    ring->to_submit++;
+    return sqe;
+}
+
+static int prep_accept(struct uring *ring, int server_fd) {
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    if (!sqe) {
+        return 0;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = server_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = make_user_data(NULL, OP_ACCEPT, BID_NONE);
+    return 1;
+}
+
+static int prep_recv(struct uring *ring, struct uring_conn *conn) {
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    if (!sqe) {
+        return 0;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUF_GROUP;
+    sqe->user_data = make_user_data(conn, OP_RECV, BID_NONE);
+    conn->recv_armed = 1;
+    conn->refs++;
+    return 1;
+}
+
+// 걸려 있는 multishot recv 를 취소한다. 취소된 recv 는 -ECANCELED 로 끝난다.
+static int prep_cancel_recv(struct uring *ring, struct uring_conn *conn) {
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    if (!sqe) {
+        return 0;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = make_user_data(conn, OP_RECV, BID_NONE);
+    sqe->user_data = make_user_data(conn, OP_CANCEL, BID_NONE);
+    return 1;
+}
+
+// 대기 중인 버퍼들을 iovec 으로 묶어 sendmsg 하나로 제출한다.
+// 버퍼마다 send 를 따로 내면 응답 하나가 여러 세그먼트로 쪼개져 Nagle 과 delayed ACK 에 걸린다.
+// 같은 연결에 대해서는 sendmsg 가 하나만 진행되도록 해서 순서를 보장한다.
+static void flush_pending_sends(struct uring *ring, struct uring_conn *conn) {
+    if (conn->sending || conn->pending_head == BID_NONE || conn->closing) {
+        return;
+    }
+
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    if (!sqe) {
+        if (!uring_submit_and_wait(ring, 0)) {
+            return;
+        }
+        sqe = uring_get_sqe(ring);
+        if (!sqe) {
+            return;
+        }
+    }
+
+    uint16_t bid = conn->pending_head;
+    int count = 0;
+    uint32_t total = 0;
+    while (bid != BID_NONE && count < URING_SEND_IOVS) {
+        conn->iov[count].iov_base = ring->buf_base + (size_t) bid * URING_BUF_SIZE;
+        conn->iov[count].iov_len = ring->buf_len[bid];
+        total += ring->buf_len[bid];
+        count++;
+        bid = ring->buf_next[bid];
+    }
+
+    memset(&conn->msg, 0, sizeof(conn->msg));
+    conn->msg.msg_iov = conn->iov;
+    conn->msg.msg_iovlen = (size_t) count;
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = conn->fd;
+    sqe->addr = (uint64_t) (uintptr_t) &conn->msg;
+    sqe->len = 1;
+    // MSG_WAITALL: 커널이 부분 전송을 이어서 처리하므로 짧은 완료는 곧 오류다
+    sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+    sqe->user_data = make_user_data(conn, OP_SEND, BID_NONE);
+    conn->sending_head = conn->pending_head;
+    conn->sending_len = total;
+    conn->sending = count;
+    conn->refs++;
+
+    conn->pending_head = bid;
+    if (bid == BID_NONE) {
+        conn->pending_tail = BID_NONE;
+    }
+}
+
+static void release_conn_if_done(struct uring *ring, struct uring_conn *conn) {
+    if (conn->closing && conn->refs == 0 && !conn->dirty) {
+        close(conn->fd);
+        conn_table_free(&ring->conns, conn->handle);
+    }
+}
+
+// 루프 끝에서 처리할 연결로 표시한다. 표시된 동안에는 해제되지 않는다.
+static void mark_dirty(struct uring *ring, struct uring_conn *conn) {
+    if (conn->dirty) {
+        return;
+    }
+    if (ring->dirty_count == ring->dirty_capacity) {
+        size_t new_capacity = ring->dirty_capacity ? ring->dirty_capacity * 2 : 64;
+        struct uring_conn **new_dirty = realloc(ring->dirty, new_capacity * sizeof(*ring->dirty));
+        if (!new_dirty) {
+            LOG_SYSERR("Memory allocation failed");
+            return;
+        }
+        ring->dirty = new_dirty;
+        ring->dirty_capacity = new_capacity;
+    }
+    conn->dirty = 1;
+    ring->dirty[ring->dirty_count++] = conn;
+}
+
+static void begin_close(struct uring *ring, struct uring_conn *conn) {
+    if (conn->closing) {
+        return;
+    }
+    conn->closing = 1;
+    // 걸려 있는 recv/send 를 끝내기 위해 shutdown 한다. fd 는 모든 요청이 끝난 뒤에 닫는다.
+    shutdown(conn->fd, SHUT_RDWR);
+
+    uint16_t bid = conn->pending_head;
+    while (bid != BID_NONE) {
+        uint16_t next = ring->buf_next[bid];
+        buf_ring_recycle(ring, bid);
+        conn->held--;
+        bid = next;
+    }
+    conn->pending_head = BID_NONE;
+    conn->pending_tail = BID_NONE;
+    stats_inc(ring->stats, STAT_CONN_CLOSED);
+    stats_gauge_add(ring->stats, STAT_GAUGE_CONNECTIONS, -1);
+    LOG_DEBUG("Client disconnected: %lld", conn->fd);
+    release_conn_if_done(ring, conn);
+}
+
+static void handle_accept_cqe(struct uring *ring, int server_fd, struct io_uring_cqe *cqe) {
+    if (cqe->res >= 0) {
+        uint64_t handle;
+        struct uring_conn *conn = (struct uring_conn *) conn_table_alloc(&ring->conns, &handle);
+        if (!conn) {
+            LOG_ERROR("Connection table full, dropping client: %lld", cqe->res);
+            close(cqe->res);
+            stats_inc(ring->stats, STAT_CONN_REFUSED);
+        } else {
+            conn->fd = cqe->res;
+            conn->handle = handle;
+            conn->pending_head = BID_NONE;
+            conn->pending_tail = BID_NONE;
+            conn->paused = 0;
+            conn->held = 0;
+            // sendmsg 사이의 작은 꼬리가 앞 세그먼트의 ACK 를 기다리지 않게 한다. AF_UNIX 면 실패하므로 결과는 보지 않는다.
+            int one = 1;
+            setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            if (!prep_recv(ring, conn)) {
+                close(conn->fd);
+                conn_table_free(&ring->conns, handle);
+            } else {
+                stats_inc(ring->stats, STAT_CONN_ACCEPTED);
+                stats_gauge_add(ring->stats, STAT_GAUGE_CONNECTIONS, 1);
+                LOG_DEBUG("New client connected: %lld", conn->fd);
+            }
+        }
+    } else {
+        errno = -cqe->res;
+        stats_inc(ring->stats, STAT_ACCEPT_ERRORS);
+        handle_accept_error();
+    }
+
+    // multishot 이 끝났으면 다시 건다
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        prep_accept(ring, server_fd);
+    }
+}
+
+static void handle_recv_cqe(struct uring *ring, struct uring_conn *conn, struct io_uring_cqe *cqe) {
+    int more = cqe->flags & IORING_CQE_F_MORE;
+
+    if (!more) {
+        conn->recv_armed = 0;
+        conn->refs--;
+    }
+
+    if (conn->closing) {
+        if (cqe->flags & IORING_CQE_F_BUFFER) {
+            buf_ring_recycle(ring, (uint16_t) (cqe->flags >> IORING_CQE_BUFFER_SHIFT));
+        }
+        release_conn_if_done(ring, conn);
+        return;
+    }
+
+    stats_inc(ring->stats, STAT_RECV_CALLS);
+    if (cqe->res > 0 && (cqe->flags & IORING_CQE_F_BUFFER)) {
+        stats_add(ring->stats, STAT_RECV_BYTES, (uint64_t) cqe->res);
+        uint16_t bid = (uint16_t) (cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        ring->buf_len[bid] = (uint32_t) cqe->res;
+        ring->buf_next[bid] = BID_NONE;
+        if (conn->pending_tail == BID_NONE) {
+            conn->pending_head = bid;
+        } else {
+            ring->buf_next[conn->pending_tail] = bid;
+        }
+        conn->pending_tail = bid;
+        conn->held++;
+        mark_dirty(ring, conn);
+
+        // 보내기만 하고 응답을 읽지 않는 상대가 공용 버퍼를 다 가져가면 다른 연결이 모두 ENOBUFS 로 멈춘다.
+        // recv 를 거두면 데이터는 소켓 수신 버퍼에 남고 TCP 흐름 제어가 상대를 멈춘다.
+        if (conn->held >= URING_CONN_MAX_BUFS && !conn->paused) {
+            conn->paused = 1;
+            if (more) {
+                prep_cancel_recv(ring, conn);
+            }
+        }
+    }
+
+    if (!more) {
+        if (cqe->res == 0) {
+            begin_close(ring, conn); // 클라이언트가 연결 종료
+            return;
+        }
+        if (cqe->res < 0 && cqe->res != -ENOBUFS && cqe->res != -ECANCELED) {
+            errno = -cqe->res;
+            stats_inc(ring->stats, STAT_RECV_ERRORS);
+            if (!handle_receive_error()) {
+                begin_close(ring, conn);
+                return;
+            }
+        }
+        // 버퍼 고갈(ENOBUFS)이나 취소로 multishot 이 끝났다. 버퍼를 돌려준 뒤 루프 끝에서 (멈춘 게 아니면) 다시 건다.
+        mark_dirty(ring, conn);
+    }
+}
+
+static void handle_send_cqe(struct uring *ring, struct uring_conn *conn, struct io_uring_cqe *cqe) {
+    uint32_t len = conn->sending_len;
+    uint16_t bid = conn->sending_head;
+    for (int i = 0; i < conn->sending; i++) {
+        uint16_t next = ring->buf_next[bid];
+        buf_ring_recycle(ring, bid);
+        bid = next;
+    }
+    conn->held -= (uint32_t) conn->sending;
+    conn->sending = 0;
+    conn->refs--;
+    stats_inc(ring->stats, STAT_SEND_CALLS);
+    if (cqe->res > 0) {
+        stats_add(ring->stats, STAT_SEND_BYTES, (uint64_t) cqe->res);
+    }
+
+    if (conn->closing) {
+        release_conn_if_done(ring, conn);
+        return;
+    }
+
+    if (cqe->res < 0 || (uint32_t) cqe->res < len) {
+        if (cqe->res < 0 && cqe->res != -ECANCELED) {
+            errno = -cqe->res;
+            stats_inc(ring->stats, STAT_SEND_ERRORS);
+            handle_send_error();
+        }
+        begin_close(ring, conn);
+        return;
+    }
+
+    if (conn->paused && conn->held <= URING_CONN_RESUME_BUFS) {
+        conn->paused = 0;
+        mark_dirty(ring, conn); // 루프 끝에서 recv 를 다시 건다
+    }
+    flush_pending_sends(ring, conn);
+}
+
+int run_uring_engine(int server_fd, struct stats_shard *stats) {
+    struct uring *ring = (struct uring *) calloc(1, sizeof(struct uring));
+    if (!ring) {
+        LOG_SYSERR("Memory allocation failed");
+        return 0;
+    }
+    ring->stats = stats;
+
+    conn_table_init(&ring->conns, sizeof(struct uring_conn), 0);
+    if (!uring_init(ring)) {
+        free(ring);
+        return 0;
+    }
+    if (!buf_ring_init(ring)) {
+        munmap(ring->sqes, ring->sqes_map_size);
+        if (ring->cq_ptr != ring->sq_ptr) {
+            munmap(ring->cq_ptr, ring->cq_map_size);
+        }
+        munmap(ring->sq_ptr, ring->sq_map_size);
+        close(ring->fd);
+        free(ring);
+        return 0;
+    }
+
+    if (!prep_accept(ring, server_fd)) {
+        uring_destroy(ring);
+        free(ring);
+        return 0;
+    }
+
+    LOG_INFO("io_uring engine running");
+
+    while (1) {
+        // 루프 한 바퀴당 io_uring_enter() 한 번: 제출과 대기를 함께 한다
+        if (!uring_submit_and_wait(ring, 1)) {
+            break;
+        }
+
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail; head++) {
+            struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+            uint64_t ud = cqe->user_data;
+            int op = (int) (ud & UD_OP_MASK);
+            uint32_t index = (uint32_t) (ud >> UD_INDEX_SHIFT);
+
+            if (op == OP_ACCEPT) {
+                handle_accept_cqe(ring, server_fd, cqe);
+            } else if (op == OP_RECV) {
+                handle_recv_cqe(ring, (struct uring_conn *) conn_table_at(&ring->conns, index), cqe);
+            } else if (op == OP_SEND) {
+                handle_send_cqe(ring, (struct uring_conn *) conn_table_at(&ring->conns, index), cqe);
+            }
+            // OP_CANCEL: 결과는 recv 완료로 온다. 이미 끝난 recv 였으면 -ENOENT 라 할 일이 없다.
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+        // 이번 바퀴에 돌려받은 버퍼를 먼저 공개하고, 연결별로 sendmsg 와 recv 재등록을 만든다
+        buf_ring_publish(ring);
+        for (size_t i = 0; i < ring->dirty_count; i++) {
+            struct uring_conn *conn = ring->dirty[i];
+            conn->dirty = 0;
+            if (conn->closing) {
+                release_conn_if_done(ring, conn);
+                continue;
+            }
+            flush_pending_sends(ring, conn);
+            if (!conn->recv_armed && !conn->paused && !prep_recv(ring, conn)) {
+                begin_close(ring, conn);
+            }
+        }
+        ring->dirty_count = 0;
+        stats_inc(ring->stats, STAT_LOOP_ITERATIONS);
+    }
+
+    free(ring->dirty);
+    conn_table_destroy(&ring->conns);
+    uring_destroy(ring);
+    free(ring);
+    return 1;
+}